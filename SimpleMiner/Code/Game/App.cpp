@@ -2,11 +2,13 @@
 
 #include "GameCommon.hpp"
 #include "Game.hpp"
+#include "WorldCommands.hpp"
 
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Core/Clock.hpp"
 #include "Engine/Core/DevConsole.hpp"
 #include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/EventSystem.hpp"
 #include "Engine/Core/NamedStrings.hpp"
 #include "Engine/Core/Time.hpp"
@@ -20,6 +22,8 @@
 
 #include <math.h>
 #include <vcruntime_string.h>
+#include <string>
+#include <vector>
 
 App* g_theApp = nullptr;                      // Created and owned by Main_Windows.cpp
 InputSystem* g_theInput = nullptr;            // Created and owned by the App
@@ -94,6 +98,51 @@ void App::RunMainLoop()
     }
 }
 
+// RunCommandLine: Run a world command named by -run= in place of the game, the other key=value tokens are its args,
+// e.g. "SimpleMiner.exe -run=PregenerateWorld radius=32" warms a world and exits. anything else starts the game
+bool App::RunCommandLine(const char* commandLine)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    for (const char* c = commandLine; c && *c; c++)
+    {
+        if (*c == ' ' || *c == '\t')
+        {
+            if (!token.empty())
+                tokens.push_back(token);
+            token.clear();
+        }
+        else
+        {
+            token += *c;
+        }
+    }
+    if (!token.empty())
+        tokens.push_back(token);
+
+    const std::string runFlag = "-run=";
+    std::string command;
+    EventArgs args;
+    for (const std::string& arg : tokens)
+    {
+        size_t split = arg.find('=');
+        if (arg.compare(0, runFlag.size(), runFlag) == 0)
+            command = arg.substr(runFlag.size());
+        else if (split != std::string::npos)
+            args.SetValue(arg.substr(0, split), arg.substr(split + 1));
+    }
+    if (command.empty())
+        return false;
+    if (!IsWorldCommand(command))
+    {
+        DebuggerPrintf("Unknown command \"%s\" on the command line, starting the game\n", command.c_str());
+        return false;
+    }
+
+    g_theEventSystem->FireEvent(command, args);
+    return true;
+}
+
 void App::Shutdown()
 {
     g_theGame->Shutdown();
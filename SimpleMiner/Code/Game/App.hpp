@@ -15,6 +15,7 @@ public:
     // lifecycle
     void Startup();
     void RunMainLoop();
+    bool RunCommandLine(const char* commandLine); // false if no known command is given by -run=
     void Shutdown();
     void RunFrame();
 
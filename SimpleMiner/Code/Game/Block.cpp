@@ -64,26 +64,11 @@ void Block::SetBlockId(const BlockDef* blockDef)
 	SetBlockId(blockDef->m_blockId);
 }
 
-LightLevel Block::GetSkyLight() const
-{
-	return IsSky() ? 15 : 0;
-}
-
 LightLevel Block::GetGlowLight() const
 {
 	return GetBlockDef()->m_lightLevel;
 }
 
-LightLevel Block::GetIndoorLightInfluence() const
-{
-	return (m_lightBits & BLOCK_LIGHT_BITS_INDOOR) >> BLOCK_LIGHT_BITSHIFT_INDOOR;
-}
-
-LightLevel Block::GetOutdoorLightInfluence() const
-{
-	return (m_lightBits & BLOCK_LIGHT_BITS_OUTDOOR) >> BLOCK_LIGHT_BITSHIFT_OUTDOOR;
-}
-
 unsigned char Block::GetIndoorLightInfluenceNormalized() const
 {
 	return NormalizeLightInfluence(GetIndoorLightInfluence());
@@ -93,15 +78,3 @@ unsigned char Block::GetOutdoorLightInfluenceNormalized() const
 {
 	return NormalizeLightInfluence(GetOutdoorLightInfluence());
 }
-
-void Block::SetIndoorLightInfluence(LightLevel intensity)
-{
-	m_lightBits &= ~BLOCK_LIGHT_BITS_INDOOR;
-	m_lightBits |= BLOCK_LIGHT_BITS_INDOOR & (intensity << BLOCK_LIGHT_BITSHIFT_INDOOR);
-}
-
-void Block::SetOutdoorLightInfluence(LightLevel intensity)
-{
-	m_lightBits &= ~BLOCK_LIGHT_BITS_OUTDOOR;
-	m_lightBits |= BLOCK_LIGHT_BITS_OUTDOOR & (intensity << BLOCK_LIGHT_BITSHIFT_OUTDOOR);
-}
@@ -22,9 +22,7 @@ constexpr int BLOCK_LIGHT_BITS_INDOOR         = 0x0F;
 constexpr int BLOCK_LIGHT_BITS_OUTDOOR        = 0xF0;
 constexpr int BLOCK_LIGHT_BITSHIFT_INDOOR     = 0;
 constexpr int BLOCK_LIGHT_BITSHIFT_OUTDOOR    = 4;
-constexpr int BLOCK_FLAG_BIT_IS_SKY           = 1 << 0;
 constexpr int BLOCK_FLAG_BIT_INVALID          = 1 << 1;
-constexpr int BLOCK_FLAG_BIT_LIGHT_DIRTY      = 1 << 2;
 constexpr int BLOCK_FLAG_BIT_IS_SOLID         = 1 << 3;
 constexpr int BLOCK_FLAG_BIT_IS_OPAQUE        = 1 << 4;
 
@@ -66,15 +64,14 @@ public:
 	void SetBlockId(BlockId blockId);
 	void SetBlockId(const BlockDef* blockDef);
 
-	LightLevel GetSkyLight() const;
 	LightLevel GetGlowLight() const;
-	LightLevel GetIndoorLightInfluence() const;
-	LightLevel GetOutdoorLightInfluence() const;
+	inline LightLevel GetIndoorLightInfluence() const;
+	inline LightLevel GetOutdoorLightInfluence() const;
 	unsigned char GetIndoorLightInfluenceNormalized() const;
 	unsigned char GetOutdoorLightInfluenceNormalized() const;
 
-	void SetIndoorLightInfluence(LightLevel intensity);
-	void SetOutdoorLightInfluence(LightLevel intensity);
+	inline void SetIndoorLightInfluence(LightLevel intensity);
+	inline void SetOutdoorLightInfluence(LightLevel intensity);
 
 	inline bool GetFlag(int bit) const;
 	inline void SetFlag(int bit, bool val);
@@ -82,11 +79,6 @@ public:
 	inline bool IsValid() const;
 	inline bool IsOpaque() const;
 	inline bool IsSolid() const;
-	inline bool IsSky() const;
-	inline bool IsLightDirty() const;
-
-	inline void SetSky(bool val = true);
-	inline void SetLightDirty(bool val = true);
 
 private:
 	unsigned char m_blockId = 0;
@@ -114,6 +106,28 @@ unsigned char Block::NormalizeLightInfluence(unsigned char influence)
 	return (influence << 4) + influence; // accelerated?: influence * 17 
 }
 
+LightLevel Block::GetIndoorLightInfluence() const
+{
+	return (m_lightBits & BLOCK_LIGHT_BITS_INDOOR) >> BLOCK_LIGHT_BITSHIFT_INDOOR;
+}
+
+LightLevel Block::GetOutdoorLightInfluence() const
+{
+	return (m_lightBits & BLOCK_LIGHT_BITS_OUTDOOR) >> BLOCK_LIGHT_BITSHIFT_OUTDOOR;
+}
+
+void Block::SetIndoorLightInfluence(LightLevel intensity)
+{
+	m_lightBits &= ~BLOCK_LIGHT_BITS_INDOOR;
+	m_lightBits |= BLOCK_LIGHT_BITS_INDOOR & (intensity << BLOCK_LIGHT_BITSHIFT_INDOOR);
+}
+
+void Block::SetOutdoorLightInfluence(LightLevel intensity)
+{
+	m_lightBits &= ~BLOCK_LIGHT_BITS_OUTDOOR;
+	m_lightBits |= BLOCK_LIGHT_BITS_OUTDOOR & (intensity << BLOCK_LIGHT_BITSHIFT_OUTDOOR);
+}
+
 bool Block::GetFlag(int bit) const
 {
 	return (m_flagBits & bit) == bit;
@@ -142,23 +156,3 @@ bool Block::IsSolid() const
 	return GetFlag(BLOCK_FLAG_BIT_IS_SOLID); 
 }
 
-bool Block::IsSky() const 
-{
-	return GetFlag(BLOCK_FLAG_BIT_IS_SKY); 
-}
-
-bool Block::IsLightDirty() const 
-{
-	return GetFlag(BLOCK_FLAG_BIT_LIGHT_DIRTY); 
-}
-
-void Block::SetSky(bool val/* = true*/) 
-{
-	SetFlag(BLOCK_FLAG_BIT_IS_SKY, val); 
-}
-
-void Block::SetLightDirty(bool val/* = true*/) 
-{
-	SetFlag(BLOCK_FLAG_BIT_LIGHT_DIRTY, val); 
-}
-
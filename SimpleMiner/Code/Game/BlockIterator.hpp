@@ -18,7 +18,9 @@ public:
 
 	inline bool IsValid() const;
 	inline Chunk* GetChunk() const;
+	inline int GetBlockIndex() const;
 	inline Block* GetBlock() const;
+	inline bool IsSky() const;
 	inline LocalCoords GetLocalCoords() const;
 	inline WorldCoords GetWorldCoords() const;
 
@@ -70,6 +72,11 @@ Chunk* BlockIterator::GetChunk() const
 	return m_chunk;
 }
 
+int BlockIterator::GetBlockIndex() const
+{
+	return m_blockIndex;
+}
+
 Block* BlockIterator::GetBlock() const
 {
 	if (!IsValid())
@@ -80,6 +87,11 @@ Block* BlockIterator::GetBlock() const
 	return &m_chunk->GetBlock(coords);
 }
 
+bool BlockIterator::IsSky() const
+{
+	return IsValid() && m_chunk->IsSkyExposed(m_blockIndex);
+}
+
 LocalCoords BlockIterator::GetLocalCoords() const
 {
 	return Chunk::GetLocalCoords(m_blockIndex);
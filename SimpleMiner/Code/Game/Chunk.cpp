@@ -16,6 +16,8 @@
 #include "Engine/Renderer/IndexBuffer.hpp"
 #include "Engine/Renderer/DebugRender.hpp"
 
+#include <algorithm>
+
 Chunk::Chunk(World* world, const ChunkCoords& chunkCoords)
 	: m_world(world)
 	, m_chunkCoords(chunkCoords)
@@ -33,18 +35,6 @@ Chunk::~Chunk()
 	delete m_blockArray;
 }
 
-void Chunk::Update()
-{
-	if (m_meshDirty)
-	{
-		for (auto& neighbor : m_neighbors)
-			if (!neighbor)
-				return;
-		if (m_world->GetChunkManager()->GetRebuildMeshTicket())
-			RebuildMesh();
-	}
-}
-
 void Chunk::UpdateRandomTick(size_t rndSize, const float* rndSource, size_t offset)
 {
 	if (rndSource[offset] > 0.25f)
@@ -118,57 +108,188 @@ void Chunk::RebuildMesh()
 
 void Chunk::MarkDirty()
 {
-	m_meshDirty = true;
+	MarkMeshDirty();
 	m_blocksDirty = true;
 }
 
-void Chunk::PopulateSkyLight()
+void Chunk::MarkMeshDirty()
 {
-	LocalCoords coords = IntVec3::ZERO;
-	BlockIterator ite = BlockIterator(this, CHUNK_SIZE_BLOCKS);
-	for (coords.z = CHUNK_MAX_Z; coords.z >= 0; coords.z--)
-		for (coords.y = CHUNK_MAX_Y; coords.y >= 0; coords.y--)
-			for (coords.x = CHUNK_MAX_X; coords.x >= 0; coords.x--)
-			{
-				ite--;
-				Block* blk = ite.GetBlock();
-				if (blk->IsSolid())
-					continue;
-				
-				if (coords.z == CHUNK_MAX_Z || ite.GetBlockNeighbor(BLOCK_FACE_UP).GetBlock()->IsSky())
-				{
-					blk->SetSky(true);
-					blk->SetOutdoorLightInfluence(15);
-				}
-			}
+	// already waiting for a rebuild with every neighbor, that rebuild picks this change up
+	if (m_meshDirty && m_meshQueueDistance >= 0 && HasAllNeighbors())
+		return;
 
-	ite = BlockIterator(this, CHUNK_SIZE_BLOCKS);
-	for (coords.z = CHUNK_MAX_Z; coords.z >= 0; coords.z--)
-		for (coords.y = CHUNK_MAX_Y; coords.y >= 0; coords.y--)
-			for (coords.x = CHUNK_MAX_X; coords.x >= 0; coords.x--)
-			{
-				ite--;
-				Block* blk = ite.GetBlock();
-				if (blk->GetGlowLight())
-				{
-					m_world->GetChunkManager()->MarkLightingDirty(ite);
-					continue;
-				}
+	m_meshDirty = true;
+	if (m_state == ChunkState::LOADED)
+		m_world->GetChunkManager()->EnqueueMeshRebuild(this);
+}
 
-				if (!blk->IsSky())
-					continue;
+bool Chunk::HasAllNeighbors() const
+{
+	for (auto& neighbor : m_neighbors)
+		if (!neighbor)
+			return false;
+	return true;
+}
 
-				for (BlockFace face : CHUNK_NEIGHBORS)
-				{
-					BlockIterator iteNbr = ite.GetBlockNeighbor(face);
+bool Chunk::HasPendingLight() const
+{
+	return m_lightQueue.HasRemovals() || !m_lightQueue.IsEmpty();
+}
 
-					Block* block = iteNbr.GetBlock();
-					if (block->IsValid() && !block->IsSky() && !block->IsSolid())
-					{
-						m_world->GetChunkManager()->MarkLightingDirty(iteNbr);
-					}
-				}
-			}
+void Chunk::PopulateLocalLight()
+{
+	// layers above the highest column are open everywhere and filled as one flat run,
+	// only the band between the lowest and highest column needs a per column test
+	int minHeight = CHUNK_SIZE_Z;
+	int maxHeight = 0;
+	for (unsigned char height : m_skyHeight)
+	{
+		if (height < minHeight)
+			minHeight = height;
+		if (height > maxHeight)
+			maxHeight = height;
+	}
+
+	for (int z = minHeight; z < maxHeight; z++)
+	{
+		Block* layer = &m_blockArray[z << CHUNK_BITSHIFT_Z];
+		for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+			if (z >= m_skyHeight[column])
+				layer[column].SetOutdoorLightInfluence(15);
+	}
+
+	Block* openEnd = m_blockArray + CHUNK_SIZE_BLOCKS;
+	for (Block* blk = m_blockArray + (maxHeight << CHUNK_BITSHIFT_Z); blk != openEnd; blk++)
+		blk->SetOutdoorLightInfluence(15);
+
+	for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+		if (m_blockArray[index].GetGlowLight())
+			m_lightQueue.Push(index);
+
+	// sky light only spreads sideways into cells under an overhang next to an open column
+	for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+	{
+		int height = m_skyHeight[column];
+		if (height == CHUNK_SIZE_Z)
+			continue;
+
+		BlockIterator ite(this, column | (height << CHUNK_BITSHIFT_Z));
+		for (BlockFace face : CHUNK_NEIGHBORS)
+		{
+			BlockIterator iteNbr = ite.GetBlockNeighbor(face);
+			if (iteNbr.GetChunk() != this)
+				continue; // other chunks are reconciled on main thread once linked
+
+			int indexNbr = iteNbr.GetBlockIndex();
+			int heightNbr = m_skyHeight[GetColumnIndex(indexNbr)];
+			for (int z = height; z < heightNbr; z++, indexNbr += CHUNK_SIZE_COLUMNS)
+				if (!m_blockArray[indexNbr].IsOpaque())
+					m_lightQueue.Push(indexNbr);
+		}
+	}
+
+	// propagate without leaving the chunk, border light only ever grows later so this never overshoots
+	while (!m_lightQueue.IsEmpty())
+	{
+		BlockIterator ite(this, m_lightQueue.Pop());
+		BlockIterator iteNbrs[BlockFace::BLOCK_FACE_SIZE] = {};
+		Block*        nbrs[BlockFace::BLOCK_FACE_SIZE]    = {};
+		if (!ChunkProvider::RelaxBlockLight(ite, iteNbrs, nbrs))
+			continue;
+
+		for (BlockFace face : BLOCK_NEIGHBORS)
+			if (iteNbrs[face].GetChunk() == this && nbrs[face]->IsValid() && !nbrs[face]->IsOpaque())
+				m_lightQueue.Push(iteNbrs[face].GetBlockIndex());
+	}
+}
+
+LocalCoords GetBorderCoords(BlockFace face, int i, int z)
+{
+	switch (face)
+	{
+	case BLOCK_FACE_NORTH: return LocalCoords(CHUNK_MAX_X, i, z);
+	case BLOCK_FACE_SOUTH: return LocalCoords(0, i, z);
+	case BLOCK_FACE_WEST:  return LocalCoords(i, CHUNK_MAX_Y, z);
+	default:               return LocalCoords(i, 0, z);
+	}
+}
+
+void Chunk::PullBorderLight(BlockFace face)
+{
+	if (!m_neighbors[face])
+		return;
+
+	ChunkProvider* provider = m_world->GetChunkManager();
+	for (int z = 0; z < (int)CHUNK_SIZE_Z; z++)
+		for (int i = 0; i < (int)CHUNK_SIZE_XY; i++)
+		{
+			BlockIterator ite(this, GetBorderCoords(face, i, z));
+			const Block* blk = ite.GetBlock();
+			const Block* nbr = ite.GetBlockNeighbor(face).GetBlock();
+			if (blk->IsOpaque() || !nbr->IsValid())
+				continue;
+
+			// only cells the neighbor can brighten need a relaxation
+			if (nbr->GetIndoorLightInfluence() > blk->GetIndoorLightInfluence() + 1 || nbr->GetOutdoorLightInfluence() > blk->GetOutdoorLightInfluence() + 1)
+				provider->MarkLightingDirty(ite);
+		}
+}
+
+void Chunk::InvalidateBorderLight(BlockFace face)
+{
+	// the neighbor changed while we were on disk, light that came across may be gone
+	ChunkProvider* provider = m_world->GetChunkManager();
+	for (int z = 0; z < (int)CHUNK_SIZE_Z; z++)
+		for (int i = 0; i < (int)CHUNK_SIZE_XY; i++)
+		{
+			BlockIterator ite(this, GetBorderCoords(face, i, z));
+			if (!ite.GetBlock()->IsOpaque())
+				provider->InvalidateLighting(ite);
+		}
+}
+
+void Chunk::OnLightChanged(int blockIndex)
+{
+	m_lightDirty = true;
+
+	// an unloaded neighbor holds light computed against our old border, make it notice on load
+	int x = (blockIndex & CHUNK_BLOCKMASK_X) >> CHUNK_BITSHIFT_X;
+	int y = (blockIndex & CHUNK_BLOCKMASK_Y) >> CHUNK_BITSHIFT_Y;
+	if ((x == CHUNK_MAX_X && !m_neighbors[BLOCK_FACE_NORTH]) || (x == 0 && !m_neighbors[BLOCK_FACE_SOUTH]) ||
+		(y == CHUNK_MAX_Y && !m_neighbors[BLOCK_FACE_WEST]) || (y == 0 && !m_neighbors[BLOCK_FACE_EAST]))
+		m_editStamp++;
+}
+
+void Chunk::RebuildHeightMap()
+{
+	for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+	{
+		int z = CHUNK_SIZE_Z;
+		while (z > 0 && !m_blockArray[column | ((z - 1) << CHUNK_BITSHIFT_Z)].IsOpaque())
+			z--;
+		m_skyHeight[column] = (unsigned char)z;
+	}
+}
+
+void Chunk::UpdateHeightMap(const LocalCoords& localCoords)
+{
+	int index = GetIndex(localCoords);
+	int column = GetColumnIndex(index);
+	int height = m_skyHeight[column];
+
+	if (m_blockArray[index].IsOpaque())
+	{
+		if (localCoords.z >= height)
+			m_skyHeight[column] = (unsigned char)(localCoords.z + 1);
+	}
+	else if (localCoords.z == height - 1)
+	{
+		// top block removed, the column opens down to the next opaque block
+		int z = localCoords.z;
+		while (z > 0 && !m_blockArray[column | ((z - 1) << CHUNK_BITSHIFT_Z)].IsOpaque())
+			z--;
+		m_skyHeight[column] = (unsigned char)z;
+	}
 }
 
 WorldCoords Chunk::GetChunkOrigin() const
@@ -240,9 +361,13 @@ void Chunk::SetBlockId(const LocalCoords& localCoords, BlockId block)
 
 	bool wasOpaque = m_blockArray[index].IsOpaque();
 
+	if (m_hasGeneratedBase)
+		KeepGeneratedBlock(index);
 	m_blockArray[index].SetBlockId(block);
 
 	MarkDirty();
+	m_editStamp++;
+	m_world->GetChunkManager()->JournalBlockEdit(this, index, block);
 
 	if (wasOpaque != m_blockArray[index].IsOpaque() && wasOpaque) // change from opaque to transparent, neighbor might need to build a face
 	{
@@ -251,74 +376,37 @@ void Chunk::SetBlockId(const LocalCoords& localCoords, BlockId block)
 		{
 			BlockIterator nbr = ite.GetBlockNeighbor(face);
 			if (nbr.IsValid() && nbr.GetBlock()->IsOpaque()) // build only if a face of neighbor is exposed
-				nbr.GetChunk()->m_meshDirty = true;
+				nbr.GetChunk()->MarkMeshDirty();
 		}
 	}
 
-	m_world->GetChunkManager()->MarkLightingDirty(BlockIterator(this, index));
-	if (!m_blockArray[index].IsOpaque())
-	{
-		// transparent (air)
-		BlockIterator ite = BlockIterator(this, index);
-		BlockIterator iteUp = ite.GetBlockNeighbor(BLOCK_FACE_UP);
-		Block* blk = ite.GetBlock();
-		Block* blkUp = iteUp.GetBlock();
-		if (blkUp->IsValid() && blkUp->IsSky())
-		{
-			blk->SetSky(true);
-			BlockIterator iteDown = ite.GetBlockNeighbor(BLOCK_FACE_DOWN);
-			Block* blkDown = iteDown.GetBlock();
-			while (blkDown->IsValid() && !blkDown->IsOpaque())
-			{
-				blkDown->SetSky(true);
-				m_world->GetChunkManager()->MarkLightingDirty(iteDown);
-				iteDown = iteDown.GetBlockNeighbor(BLOCK_FACE_DOWN);
-				blkDown = iteDown.GetBlock();
-			}
-		}
-	}
-	else
-	{
-		// opaque (block)
-		BlockIterator ite = BlockIterator(this, index);
-		Block* blk = ite.GetBlock();
-		if (blk->IsSky())
-		{
-			blk->SetSky(false);
-			BlockIterator iteDown = ite.GetBlockNeighbor(BLOCK_FACE_DOWN);
-			Block* blkDown = iteDown.GetBlock();
-			while (blkDown->IsValid() && blkDown->IsSky())
-			{
-				blkDown->SetSky(false);
-				m_world->GetChunkManager()->MarkLightingDirty(iteDown);
-				iteDown = iteDown.GetBlockNeighbor(BLOCK_FACE_DOWN);
-			}
-		}
-	}
+	// sky exposure moves with the column height, the light below follows through the removal and dirty queues
+	UpdateHeightMap(localCoords);
+	m_world->GetChunkManager()->InvalidateLighting(BlockIterator(this, index));
 
 	if (localCoords.x == CHUNK_MAX_X)
 	{
 		Chunk* neighbor = m_neighbors[(int)BLOCK_FACE_NORTH];
 		if (neighbor)
-			neighbor->m_meshDirty = true;
+			neighbor->MarkMeshDirty();
 	}
 	if (localCoords.x == 0)
 	{
 		Chunk* neighbor = m_neighbors[(int)BLOCK_FACE_SOUTH];
 		if (neighbor)
-			neighbor->m_meshDirty = true;
+			neighbor->MarkMeshDirty();
 	}
 	if (localCoords.y == CHUNK_MAX_Y)
 	{
 		Chunk* neighbor = m_neighbors[(int)BLOCK_FACE_WEST];
 		if (neighbor)
-			neighbor->m_meshDirty = true;
+			neighbor->MarkMeshDirty();
 	}
 	if (localCoords.y == 0)
 	{
 		Chunk* neighbor = m_neighbors[(int)BLOCK_FACE_EAST];
 		if (neighbor)
-			neighbor->m_meshDirty = true;
+			neighbor->MarkMeshDirty();
 	}
 }
 
@@ -400,17 +488,14 @@ void Chunk::OnNeighborLoad(Chunk& neighbor)
 		if (m_chunkCoords + Block::GetOffset2ByFace(face) == neighbor.m_chunkCoords)
 		{
 			m_neighbors[face] = &neighbor;
-			m_meshDirty = true;
-			break;
+			MarkMeshDirty();
+			if (m_neighborStamps[face] != CHUNK_STAMP_UNKNOWN && m_neighborStamps[face] != neighbor.m_editStamp)
+				InvalidateBorderLight(face);
+			m_neighborStamps[face] = neighbor.m_editStamp;
+			PullBorderLight(face); // the neighbor does the same toward this chunk
+			return;
 		}
 	}
-
-	for (auto& nbr : m_neighbors)
-		if (!nbr)
-			return;
-
-	// all neighbors are loaded, do some work
-	PopulateSkyLight();
 }
 
 void Chunk::OnNeighborUnload(const Chunk& neighbor)
@@ -420,7 +505,8 @@ void Chunk::OnNeighborUnload(const Chunk& neighbor)
 		if (m_chunkCoords + Block::GetOffset2ByFace(face) == neighbor.m_chunkCoords)
 		{
 			m_neighbors[face] = nullptr;
-			m_meshDirty = true;
+			m_neighborStamps[face] = neighbor.m_editStamp;
+			MarkMeshDirty();
 			return;
 		}
 	}
@@ -431,7 +517,7 @@ void Chunk::OnNeighborBlockUpdate(const Chunk& neighbor, const LocalCoords& coor
 {
 	UNUSED(neighbor);
 	UNUSED(coords);
-	m_meshDirty = true;
+	MarkMeshDirty();
 // 	for (auto* pChunk : m_neighbors)
 // 	{
 // 		if (&neighbor == pChunk)
@@ -467,7 +553,7 @@ void Chunk::WriteBytes(ByteBuffer* buffer) const
 	buffer->Write(rle_len);
 }
 
-void Chunk::ReadBytes(ByteBuffer* buffer)
+bool Chunk::ReadBytes(ByteBuffer* buffer)
 {
 	size_t idx = 0;
 	unsigned char rle_len;
@@ -476,10 +562,180 @@ void Chunk::ReadBytes(ByteBuffer* buffer)
 	{
 		buffer->Read(rle_last_char);
 		buffer->Read(rle_len);
+		if (rle_len == 0 || rle_len > CHUNK_SIZE_BLOCKS - idx)
+			return false; // an empty run never ends the stream, a long one overflows the chunk
 		for (int i = 0; i < rle_len; i++)
 			m_blockArray[idx + i].SetBlockId(rle_last_char);
 		idx += rle_len;
 	}
+	return true;
+}
+
+// CountRunBytes: Bytes of a run length stream filling a chunk exactly, 0 if the stream is broken
+static size_t CountRunBytes(const unsigned char* data, const unsigned char* end)
+{
+	size_t idx = 0;
+	const unsigned char* run = data;
+	for (; idx < CHUNK_SIZE_BLOCKS && end - run >= 2; run += 2)
+	{
+		if (run[1] == 0)
+			return 0;
+		idx += run[1];
+	}
+	return idx == CHUNK_SIZE_BLOCKS ? (size_t)(run - data) : 0;
+}
+
+bool Chunk::ReadBytes(const unsigned char*& data, const unsigned char* end)
+{
+	size_t length = CountRunBytes(data, end);
+	if (length == 0)
+		return false;
+
+	// the definition lookup of SetBlockId once a run, the rest of the run is copied;
+	// runs are clamped to the chunk, mapped bytes may differ from the ones counted
+	Block* blk = m_blockArray;
+	Block* blkEnd = m_blockArray + CHUNK_SIZE_BLOCKS;
+	for (const unsigned char* run = data; run != data + length && blk != blkEnd; run += 2)
+	{
+		Block block(run[0]);
+		Block* runEnd = (size_t)(blkEnd - blk) > run[1] ? blk + run[1] : blkEnd;
+		for (; blk != runEnd; blk++)
+			*blk = block;
+	}
+	data += length;
+	return true;
+}
+
+void Chunk::ApplyPendingEdits()
+{
+	for (const BlockEdit& edit : m_pendingEdits)
+	{
+		if (m_hasGeneratedBase)
+			KeepGeneratedBlock(edit.m_blockIndex);
+		m_blockArray[edit.m_blockIndex].SetBlockId(edit.m_blockId);
+	}
+	m_pendingEdits.clear();
+	m_pendingEdits.shrink_to_fit();
+}
+
+void Chunk::CollectEdits(std::vector<BlockEdit>& edits) const
+{
+	// edits reverted to the generated block drop out
+	for (const BlockEdit& generated : m_generatedBlocks)
+	{
+		BlockId blockId = m_blockArray[generated.m_blockIndex].GetBlockId();
+		if (blockId != generated.m_blockId)
+			edits.push_back({ generated.m_blockIndex, blockId });
+	}
+}
+
+// KeepGeneratedBlock: Remembers the block at index unless an earlier edit did, that one is the generator's
+void Chunk::KeepGeneratedBlock(int index)
+{
+	auto ite = std::lower_bound(m_generatedBlocks.begin(), m_generatedBlocks.end(), index, [](const BlockEdit& edit, int blockIndex) {
+		return edit.m_blockIndex < blockIndex;
+	});
+	if (ite == m_generatedBlocks.end() || ite->m_blockIndex != index)
+		m_generatedBlocks.insert(ite, { (unsigned short)index, m_blockArray[index].GetBlockId() });
+}
+
+void Chunk::WriteLightBytes(ByteBuffer* buffer) const
+{
+	// both nibbles packed in one byte, run length encoded like the block ids
+	unsigned char rle_len = 1;
+	unsigned char rle_last_char = (unsigned char)((m_blockArray[0].GetOutdoorLightInfluence() << 4) | m_blockArray[0].GetIndoorLightInfluence());
+	for (size_t idx = 1; idx < CHUNK_SIZE_BLOCKS; idx++)
+	{
+		unsigned char rle_char = (unsigned char)((m_blockArray[idx].GetOutdoorLightInfluence() << 4) | m_blockArray[idx].GetIndoorLightInfluence());
+		if (rle_char != rle_last_char || rle_len == 255)
+		{
+			buffer->Write(rle_last_char);
+			buffer->Write(rle_len);
+			rle_len = 1;
+			rle_last_char = rle_char;
+		}
+		else
+		{
+			rle_len++;
+		}
+	}
+	buffer->Write(rle_last_char);
+	buffer->Write(rle_len);
+}
+
+bool Chunk::ReadLightBytes(ByteBuffer* buffer)
+{
+	size_t idx = 0;
+	unsigned char rle_len;
+	unsigned char rle_last_char;
+	while (idx < CHUNK_SIZE_BLOCKS)
+	{
+		buffer->Read(rle_last_char);
+		buffer->Read(rle_len);
+		if (rle_len == 0 || rle_len > CHUNK_SIZE_BLOCKS - idx)
+			return false;
+		for (int i = 0; i < rle_len; i++)
+		{
+			m_blockArray[idx + i].SetIndoorLightInfluence(rle_last_char & 0x0F);
+			m_blockArray[idx + i].SetOutdoorLightInfluence(rle_last_char >> 4);
+		}
+		idx += rle_len;
+	}
+	return true;
+}
+
+bool Chunk::ReadLightBytes(const unsigned char*& data, const unsigned char* end)
+{
+	size_t length = CountRunBytes(data, end);
+	if (length == 0)
+		return false;
+
+	Block* blk = m_blockArray;
+	Block* blkEnd = m_blockArray + CHUNK_SIZE_BLOCKS;
+	for (const unsigned char* run = data; run != data + length && blk != blkEnd; run += 2)
+	{
+		Block* runEnd = (size_t)(blkEnd - blk) > run[1] ? blk + run[1] : blkEnd;
+		for (; blk != runEnd; blk++)
+		{
+			blk->SetIndoorLightInfluence(run[0] & 0x0F);
+			blk->SetOutdoorLightInfluence(run[0] >> 4);
+		}
+	}
+	data += length;
+	return true;
+}
+
+void Chunk::GetBlockIds(unsigned char* plane) const
+{
+	for (size_t idx = 0; idx < CHUNK_SIZE_BLOCKS; idx++)
+		plane[idx] = m_blockArray[idx].GetBlockId();
+}
+
+void Chunk::SetBlockIds(const unsigned char* plane)
+{
+	// the definition lookup of SetBlockId once a run, like the run length reader
+	Block block(plane[0]);
+	for (size_t idx = 0; idx < CHUNK_SIZE_BLOCKS; idx++)
+	{
+		if (plane[idx] != block.GetBlockId())
+			block = Block(plane[idx]);
+		m_blockArray[idx] = block;
+	}
+}
+
+void Chunk::GetLightBytes(unsigned char* plane) const
+{
+	for (size_t idx = 0; idx < CHUNK_SIZE_BLOCKS; idx++)
+		plane[idx] = (unsigned char)((m_blockArray[idx].GetOutdoorLightInfluence() << 4) | m_blockArray[idx].GetIndoorLightInfluence());
+}
+
+void Chunk::SetLightBytes(const unsigned char* plane)
+{
+	for (size_t idx = 0; idx < CHUNK_SIZE_BLOCKS; idx++)
+	{
+		m_blockArray[idx].SetIndoorLightInfluence(plane[idx] & 0x0F);
+		m_blockArray[idx].SetOutdoorLightInfluence(plane[idx] >> 4);
+	}
 }
 
 void Chunk::RebuildOpaqueMesh()
@@ -750,3 +1006,63 @@ void Chunk::RebuildTranslucentMesh()
 		m_fluidBufferIdx = nullptr;
 	}
 }
+
+bool ChunkLightQueue::Push(int blockIndex)
+{
+	unsigned int bit = 1u << (blockIndex & 31);
+	unsigned int& word = m_queuedBits[blockIndex >> 5];
+	if (word & bit)
+		return false;
+	word |= bit;
+
+	if (GetSize() == m_ring.size())
+		Grow();
+	m_ring[m_tail & (m_ring.size() - 1)] = (unsigned short)blockIndex;
+	m_tail++;
+	return true;
+}
+
+int ChunkLightQueue::Pop()
+{
+	int blockIndex = m_ring[m_head & (m_ring.size() - 1)];
+	m_head++;
+	m_queuedBits[blockIndex >> 5] &= ~(1u << (blockIndex & 31));
+	return blockIndex;
+}
+
+void ChunkLightQueue::Clear()
+{
+	m_head = 0;
+	m_tail = 0;
+	for (unsigned int& word : m_queuedBits)
+		word = 0;
+	m_removals.clear();
+	m_removalHead = 0;
+}
+
+void ChunkLightQueue::PushRemoval(const LightRemoval& removal)
+{
+	m_removals.push_back(removal);
+}
+
+LightRemoval ChunkLightQueue::PopRemoval()
+{
+	LightRemoval removal = m_removals[m_removalHead++];
+	if (m_removalHead == m_removals.size())
+	{
+		m_removals.clear();
+		m_removalHead = 0;
+	}
+	return removal;
+}
+
+void ChunkLightQueue::Grow()
+{
+	std::vector<unsigned short> ring(m_ring.empty() ? 64 : m_ring.size() * 2);
+	size_t size = GetSize();
+	for (size_t i = 0; i < size; i++)
+		ring[i] = m_ring[(m_head + i) & (m_ring.size() - 1)];
+	m_ring.swap(ring);
+	m_head = 0;
+	m_tail = size;
+}
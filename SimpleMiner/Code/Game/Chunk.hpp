@@ -8,6 +8,8 @@
 #include "Engine/Renderer/VertexFormat.hpp"
 
 #include <atomic>
+#include <map>
+#include <vector>
 
 //------------------------------------------------------------------------------------------------
 typedef unsigned char BlockId;
@@ -15,6 +17,8 @@ typedef IntVec2 ChunkCoords;
 typedef IntVec3 LocalCoords;
 typedef IntVec3 WorldCoords;
 
+constexpr unsigned int CHUNK_STAMP_UNKNOWN = 0xFFFFFFFF;
+
 class World;
 class VertexBuffer;
 class IndexBuffer;
@@ -27,15 +31,58 @@ struct BlockState
 	Block m_block;
 };
 
+struct BlockEdit
+{
+	unsigned short m_blockIndex;
+	BlockId        m_blockId;
+};
+
 enum class ChunkState
 {
 	UNLOAD,           // chunk is not in memory 
-	QUEUED,           // chunk is queued to generate 
-	GENERATING,		  // chunk is being generated
-	GENERATED,		  // chunk is generated
+	QUEUED,           // chunk is queued to load or generate 
+	GENERATING,		  // chunk file is being read, or the chunk generated when there is none
+	GENERATED,		  // chunk is read or generated
 	LOADED,			  // chunk is loaded and active
 };
 
+struct LightRemoval
+{
+	unsigned short m_blockIndex   = 0;
+	LightLevel     m_indoorLight  = 0; // previous level of the channel being removed, 0 if untouched
+	LightLevel     m_outdoorLight = 0;
+};
+
+//------------------------------------------------------------------------------------------------
+// FIFO of block indices waiting for light relaxation, packed to 16 bits in a growable ring,
+// a bitset over the chunk keeps every block queued at most once.
+// light removals of the chunk wait in a second FIFO, drained before any relaxation
+class ChunkLightQueue
+{
+public:
+	bool   IsEmpty() const { return m_head == m_tail; }
+	size_t GetSize() const { return m_tail - m_head; }
+	bool   Push(int blockIndex); // false if the block is already queued
+	int    Pop();
+	void   Clear();
+
+	bool         HasRemovals() const { return m_removalHead != m_removals.size(); }
+	size_t       GetRemovalCount() const { return m_removals.size() - m_removalHead; }
+	void         PushRemoval(const LightRemoval& removal);
+	LightRemoval PopRemoval();
+
+private:
+	void   Grow();
+
+private:
+	std::vector<unsigned short> m_ring; // capacity is a power of two
+	size_t                      m_head = 0;
+	size_t                      m_tail = 0;
+	unsigned int                m_queuedBits[CHUNK_SIZE_BLOCKS / 32] = {};
+	std::vector<LightRemoval>   m_removals; // reset once drained, the capacity is kept
+	size_t                      m_removalHead = 0;
+};
+
 //------------------------------------------------------------------------------------------------
 class Chunk
 {
@@ -49,17 +96,25 @@ public:
 	static inline WorldCoords            GetWorldCoords(const ChunkCoords& chunkCoords, const LocalCoords& localCoords);
 	static inline int                    GetIndex(const LocalCoords& localCoords);
 	static inline LocalCoords            GetLocalCoords(int blockIndex);
+	static inline int                    GetColumnIndex(int blockIndex);
 
 	Chunk(World* world, const ChunkCoords& chunkCoords);
 	~Chunk();
 
-	void Update();
 	void UpdateRandomTick(size_t rndSize, const float* rndSource, size_t offset);
 	void Render(int pass) const;
 
 	void RebuildMesh();
 	void MarkDirty();
-	void PopulateSkyLight();
+	void MarkMeshDirty();
+	bool HasAllNeighbors() const;
+	bool HasPendingLight() const;
+	void PopulateLocalLight();
+	void PullBorderLight(BlockFace face);
+	void InvalidateBorderLight(BlockFace face);
+	void OnLightChanged(int blockIndex);
+	void RebuildHeightMap();
+	inline bool IsSkyExposed(int blockIndex) const;
 
 	WorldCoords     GetChunkOrigin() const;
 	WorldCoords     GetWorldCoords(const LocalCoords& localCoords) const;
@@ -74,9 +129,21 @@ public:
 	void            OnNeighborBlockUpdate(const Chunk& neighbor, const LocalCoords& coords);
 
 	void            WriteBytes(ByteBuffer* buffer) const;
-	void            ReadBytes(ByteBuffer* buffer);
+	bool            ReadBytes(ByteBuffer* buffer); // false on a broken run, the chunk is left part read
+	bool            ReadBytes(const unsigned char*& data, const unsigned char* end); // decoded where the bytes lie, false leaves the chunk untouched
+	void            WriteLightBytes(ByteBuffer* buffer) const;
+	bool            ReadLightBytes(ByteBuffer* buffer);
+	bool            ReadLightBytes(const unsigned char*& data, const unsigned char* end);
+	void            GetBlockIds(unsigned char* plane) const; // CHUNK_SIZE_BLOCKS bytes, for the chunk codecs
+	void            SetBlockIds(const unsigned char* plane);
+	void            GetLightBytes(unsigned char* plane) const; // outdoor light in the high nibble
+	void            SetLightBytes(const unsigned char* plane);
+	void            ApplyPendingEdits();
+	void            CollectEdits(std::vector<BlockEdit>& edits) const;
 
 private:
+	void UpdateHeightMap(const LocalCoords& localCoords);
+	void KeepGeneratedBlock(int index);
 	void RebuildOpaqueMesh();
 	void RebuildTranslucentMesh();
 
@@ -86,9 +153,22 @@ public:
 	std::atomic<ChunkState> m_state = ChunkState::UNLOAD;
 	Chunk* m_neighbors[4] = {}; // NORTH(+X), SOUTH(-X), WEST(+Y), EAST(-Y)
 	Block* m_blockArray = nullptr;
+	unsigned char m_skyHeight[CHUNK_SIZE_COLUMNS] = {}; // per column, lowest z open to the sky (one above the top opaque block)
 
 	bool m_meshDirty = true;
+	int  m_meshQueueDistance = -1; // hotspot distance the chunk waits in the mesh rebuild queue under, -1 if not queued
 	bool m_blocksDirty = false;
+	bool m_lightDirty = false;    // light differs from the chunk file
+	unsigned int m_editStamp = 0; // bumped on block edits and on border light changes no loaded neighbor saw
+	unsigned int m_neighborStamps[4] = { CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN }; // neighbor stamps our light was computed against
+	ChunkLightQueue m_lightQueue;
+
+	bool m_hasGeneratedBase = false;          // blocks are generator output plus tracked edits, only while the provider writes delta saves
+	bool m_loadedFromDisk = false;
+	bool m_savedToDisk = false;               // a file was written since load, reverting every edit must delete it
+	std::vector<BlockEdit> m_generatedBlocks; // generator output under every block edited since generation, by index
+	std::vector<BlockEdit> m_pendingEdits;    // read from a delta file, applied over generator output
+	bool m_generatorChanged = false;          // the delta file was of another generator version, rewritten over the new output
 
 private:
 	VertexBufferBuilder m_opaqueMesh;
@@ -140,6 +220,16 @@ LocalCoords Chunk::GetLocalCoords(int blockIndex)
 	return coords;
 }
 
+int Chunk::GetColumnIndex(int blockIndex)
+{
+	return blockIndex & (CHUNK_BLOCKMASK_X | CHUNK_BLOCKMASK_Y);
+}
+
+bool Chunk::IsSkyExposed(int blockIndex) const
+{
+	return (blockIndex >> CHUNK_BITSHIFT_Z) >= (int)m_skyHeight[GetColumnIndex(blockIndex)];
+}
+
 WorldCoords Chunk::GetWorldCoords(const Vec3& worldPosition)
 {
 	return IntVec3(int(floorf(worldPosition.x)), int(floorf(worldPosition.y)), int(floorf(worldPosition.z)));
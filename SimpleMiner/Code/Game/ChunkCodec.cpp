@@ -0,0 +1,239 @@
+#include "Game/ChunkCodec.hpp"
+
+#include <cstring>
+
+constexpr size_t       LZ_MIN_MATCH   = 4;
+constexpr size_t       LZ_MAX_OFFSET  = 65535;
+constexpr unsigned int LZ_HASH_BITS   = 12;
+constexpr size_t       LZ_NIBBLE_MAX  = 15;
+
+static const RleChunkCodec       s_rleCodec;
+static const VarintRleChunkCodec s_varintRleCodec;
+static const LzChunkCodec        s_lzCodec;
+
+const ChunkCodec* ChunkCodec::Find(unsigned char id)
+{
+	for (const ChunkCodec* codec : GetAll())
+		if (codec->GetId() == id)
+			return codec;
+	return nullptr;
+}
+
+const ChunkCodec* ChunkCodec::FindByName(const std::string& name)
+{
+	for (const ChunkCodec* codec : GetAll())
+		if (name == codec->GetName())
+			return codec;
+	return nullptr;
+}
+
+const std::vector<const ChunkCodec*>& ChunkCodec::GetAll()
+{
+	static const std::vector<const ChunkCodec*> codecs = { &s_rleCodec, &s_varintRleCodec, &s_lzCodec };
+	return codecs;
+}
+
+// GetRunLength: Bytes equal to plane[index] from index on
+static size_t GetRunLength(const unsigned char* plane, size_t index)
+{
+	size_t end = index + 1;
+	while (end < CHUNK_SIZE_BLOCKS && plane[end] == plane[index])
+		end++;
+	return end - index;
+}
+
+void RleChunkCodec::Encode(const unsigned char* plane, std::vector<unsigned char>& output) const
+{
+	for (size_t index = 0; index < CHUNK_SIZE_BLOCKS;)
+	{
+		size_t run = GetRunLength(plane, index);
+		for (size_t left = run; left > 0;)
+		{
+			size_t length = left < 255 ? left : 255;
+			output.push_back(plane[index]);
+			output.push_back((unsigned char)length);
+			left -= length;
+		}
+		index += run;
+	}
+}
+
+bool RleChunkCodec::Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const
+{
+	for (size_t index = 0; index < CHUNK_SIZE_BLOCKS; data += 2)
+	{
+		if (end - data < 2 || data[1] == 0 || index + data[1] > CHUNK_SIZE_BLOCKS)
+			return false;
+		memset(plane + index, data[0], data[1]);
+		index += data[1];
+	}
+	return true;
+}
+
+void VarintRleChunkCodec::Encode(const unsigned char* plane, std::vector<unsigned char>& output) const
+{
+	for (size_t index = 0; index < CHUNK_SIZE_BLOCKS;)
+	{
+		size_t run = GetRunLength(plane, index);
+		output.push_back(plane[index]);
+		for (size_t length = run; ; length >>= 7)
+		{
+			if (length < 0x80)
+			{
+				output.push_back((unsigned char)length);
+				break;
+			}
+			output.push_back((unsigned char)(length & 0x7F) | 0x80);
+		}
+		index += run;
+	}
+}
+
+bool VarintRleChunkCodec::Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const
+{
+	for (size_t index = 0; index < CHUNK_SIZE_BLOCKS;)
+	{
+		if (data == end)
+			return false;
+		unsigned char value = *data++;
+
+		// three bytes already cover a whole chunk
+		size_t length = 0;
+		for (int shift = 0; ; shift += 7)
+		{
+			if (data == end || shift > 14)
+				return false;
+			unsigned char byte = *data++;
+			length |= (size_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		if (length == 0 || index + length > CHUNK_SIZE_BLOCKS)
+			return false;
+		memset(plane + index, value, length);
+		index += length;
+	}
+	return true;
+}
+
+// WriteLzLength: Rest of a length past its token nibble, 255 continues
+static void WriteLzLength(size_t length, std::vector<unsigned char>& output)
+{
+	for (length -= LZ_NIBBLE_MAX; length >= 255; length -= 255)
+		output.push_back(255);
+	output.push_back((unsigned char)length);
+}
+
+// WriteLzSequence: Literals from the plane, then a match unless this is the last sequence
+static void WriteLzSequence(const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength, std::vector<unsigned char>& output)
+{
+	size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+	unsigned char token = (unsigned char)(((literalLength < LZ_NIBBLE_MAX ? literalLength : LZ_NIBBLE_MAX) << 4) | (matchCode < LZ_NIBBLE_MAX ? matchCode : LZ_NIBBLE_MAX));
+	output.push_back(token);
+	if (literalLength >= LZ_NIBBLE_MAX)
+		WriteLzLength(literalLength, output);
+	output.insert(output.end(), literals, literals + literalLength);
+	if (matchLength == 0)
+		return;
+
+	output.push_back((unsigned char)(offset & 0xFF));
+	output.push_back((unsigned char)(offset >> 8));
+	if (matchCode >= LZ_NIBBLE_MAX)
+		WriteLzLength(matchCode, output);
+}
+
+// ReadLzLength: Adds the bytes following a full nibble
+static bool ReadLzLength(const unsigned char*& data, const unsigned char* end, size_t& length)
+{
+	for (;;)
+	{
+		if (data == end)
+			return false;
+		unsigned char byte = *data++;
+		length += byte;
+		if (byte != 255)
+			return true;
+		if (length > CHUNK_SIZE_BLOCKS)
+			return false;
+	}
+}
+
+void LzChunkCodec::Encode(const unsigned char* plane, std::vector<unsigned char>& output) const
+{
+	// last position seen for a hash of 4 bytes, a single candidate per hash keeps it fast
+	int table[1 << LZ_HASH_BITS];
+	memset(table, 0xFF, sizeof(table));
+
+	size_t anchor = 0;
+	size_t index = 0;
+	while (index + LZ_MIN_MATCH <= CHUNK_SIZE_BLOCKS)
+	{
+		unsigned int sequence;
+		memcpy(&sequence, plane + index, sizeof(sequence));
+		unsigned int hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int candidate = table[hash];
+		table[hash] = (int)index;
+
+		if (candidate < 0 || index - candidate > LZ_MAX_OFFSET || memcmp(plane + candidate, plane + index, LZ_MIN_MATCH) != 0)
+		{
+			index++;
+			continue;
+		}
+
+		// a match may overlap what it copies, offset 1 repeats a single byte
+		size_t length = LZ_MIN_MATCH;
+		while (index + length < CHUNK_SIZE_BLOCKS && plane[candidate + length] == plane[index + length])
+			length++;
+		WriteLzSequence(plane + anchor, index - anchor, index - candidate, length, output);
+		index += length;
+		anchor = index;
+	}
+
+	if (anchor < CHUNK_SIZE_BLOCKS)
+		WriteLzSequence(plane + anchor, CHUNK_SIZE_BLOCKS - anchor, 0, 0, output);
+}
+
+bool LzChunkCodec::Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const
+{
+	size_t index = 0;
+	while (index < CHUNK_SIZE_BLOCKS)
+	{
+		if (data == end)
+			return false;
+		unsigned char token = *data++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == LZ_NIBBLE_MAX && !ReadLzLength(data, end, literalLength))
+			return false;
+		if (literalLength > (size_t)(end - data) || index + literalLength > CHUNK_SIZE_BLOCKS)
+			return false;
+		memcpy(plane + index, data, literalLength);
+		data += literalLength;
+		index += literalLength;
+		if (index == CHUNK_SIZE_BLOCKS)
+			break; // the last sequence has no match
+
+		if (end - data < 2)
+			return false;
+		size_t offset = (size_t)data[0] | ((size_t)data[1] << 8);
+		data += 2;
+		size_t matchLength = token & 0x0F;
+		if (matchLength == LZ_NIBBLE_MAX && !ReadLzLength(data, end, matchLength))
+			return false;
+		matchLength += LZ_MIN_MATCH;
+		if (offset == 0 || offset > index || index + matchLength > CHUNK_SIZE_BLOCKS)
+			return false;
+
+		unsigned char* target = plane + index;
+		const unsigned char* source = target - offset;
+		if (offset == 1)
+			memset(target, *source, matchLength);
+		else if (offset >= matchLength)
+			memcpy(target, source, matchLength);
+		else
+			for (size_t byte = 0; byte < matchLength; byte++)
+				target[byte] = source[byte];
+		index += matchLength;
+	}
+	return true;
+}
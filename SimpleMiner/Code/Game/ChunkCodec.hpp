@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Game/GameCommon.hpp"
+
+#include <string>
+#include <vector>
+
+// codec ids as stored in the block encoding byte of a chunk file, 1 is taken by delta files
+enum ChunkCodecId : unsigned char
+{
+	CHUNK_CODEC_RLE        = 0,
+	CHUNK_CODEC_VARINT_RLE = 2,
+	CHUNK_CODEC_LZ         = 3,
+};
+
+// compresses one plane of a chunk, CHUNK_SIZE_BLOCKS bytes of block ids or packed light. streams end where the
+// plane is full, so they need no length. decoding checks every read and write and fails on a broken stream
+class ChunkCodec
+{
+public:
+	virtual ~ChunkCodec() {}
+
+	virtual const char*   GetName() const = 0;
+	virtual unsigned char GetId() const = 0;
+	virtual void          Encode(const unsigned char* plane, std::vector<unsigned char>& output) const = 0; // appends
+	virtual bool          Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const = 0;
+
+	static const ChunkCodec*                     Find(unsigned char id); // nullptr for an unknown id
+	static const ChunkCodec*                     FindByName(const std::string& name);
+	static const std::vector<const ChunkCodec*>& GetAll();
+};
+
+// (value, length) byte pairs with runs capped at 255, what chunk files always used
+class RleChunkCodec : public ChunkCodec
+{
+public:
+	const char*   GetName() const override { return "RLE"; }
+	unsigned char GetId() const override { return CHUNK_CODEC_RLE; }
+	void          Encode(const unsigned char* plane, std::vector<unsigned char>& output) const override;
+	bool          Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const override;
+};
+
+// a value and a 7 bits per byte run length, an air layer or a whole empty chunk is one run
+class VarintRleChunkCodec : public ChunkCodec
+{
+public:
+	const char*   GetName() const override { return "VarintRLE"; }
+	unsigned char GetId() const override { return CHUNK_CODEC_VARINT_RLE; }
+	void          Encode(const unsigned char* plane, std::vector<unsigned char>& output) const override;
+	bool          Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const override;
+};
+
+// byte oriented LZ77 in the layout of LZ4 sequences: a token of literal and match length nibbles, literals,
+// a 16 bit offset back into the plane, extra length bytes past 15. repeats ore speckled layers and long runs
+class LzChunkCodec : public ChunkCodec
+{
+public:
+	const char*   GetName() const override { return "LZ"; }
+	unsigned char GetId() const override { return CHUNK_CODEC_LZ; }
+	void          Encode(const unsigned char* plane, std::vector<unsigned char>& output) const override;
+	bool          Decode(const unsigned char*& data, const unsigned char* end, unsigned char* plane) const override;
+};
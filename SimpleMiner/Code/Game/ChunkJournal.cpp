@@ -0,0 +1,236 @@
+#include "Game/ChunkJournal.hpp"
+#include "Game/RegionFile.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+constexpr const char*  CHUNK_JOURNAL_MAGIC = "SJNL";
+constexpr unsigned int CHUNK_JOURNAL_VERSION = 1;
+constexpr size_t       CHUNK_JOURNAL_HEADER_SIZE = 12; // magic, version, world seed
+constexpr size_t       CHUNK_JOURNAL_READ_RECORDS = 1024;
+
+ChunkJournal::ChunkJournal(const std::string& folderPath)
+	: m_filePath(folderPath + "/" + CHUNK_JOURNAL_FILE_NAME)
+	, m_previousPath(folderPath + "/" + CHUNK_JOURNAL_PREVIOUS_FILE_NAME)
+{
+	std::error_code error;
+	m_hasPrevious = std::filesystem::exists(std::filesystem::path(m_previousPath), error);
+}
+
+ChunkJournal::~ChunkJournal()
+{
+	Flush();
+	Close();
+}
+
+unsigned char ChunkJournal::GetRecordCheck(const ChunkJournalRecord& record)
+{
+	unsigned int checksum = RegionFile::Checksum((const unsigned char*)&record, sizeof(record) - 1);
+	return (unsigned char)(checksum ^ (checksum >> 8) ^ (checksum >> 16) ^ (checksum >> 24));
+}
+
+void ChunkJournal::Append(const ChunkCoords& coords, unsigned short blockIndex, BlockId blockId)
+{
+	ChunkJournalRecord record;
+	record.m_chunkX = coords.x;
+	record.m_chunkY = coords.y;
+	record.m_blockIndex = blockIndex;
+	record.m_blockId = blockId;
+	record.m_check = GetRecordCheck(record);
+	m_buffer.push_back(record);
+	m_recordCount++;
+	m_appendedCount++;
+}
+
+bool ChunkJournal::Flush()
+{
+	if (m_buffer.empty())
+		return true;
+	if (m_rotating)
+		return false; // the current file is not there until the rotation ends
+
+	// a file left by a crash is replayed before anything is appended, a new one always starts empty
+	if (!m_file)
+	{
+		m_file = OpenFile(m_filePath, "wb");
+		if (!m_file || !WriteHeader(m_file))
+		{
+			Close();
+			return false; // kept buffered, the next flush tries again
+		}
+	}
+
+	size_t bytes = m_buffer.size() * sizeof(ChunkJournalRecord);
+	bool written = fwrite(m_buffer.data(), 1, bytes, m_file) == bytes && fflush(m_file) == 0;
+	if (written)
+	{
+		m_flushedBytes += bytes;
+		m_buffer.clear();
+	}
+	return written;
+}
+
+bool ChunkJournal::BeginRotate(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried)
+{
+	if (m_hasPrevious || m_rotating)
+		return false;
+
+	// the round saves every chunk these records touch, the file is kept until those saves are on disk
+	Flush();
+	m_rotatingFile = m_file;
+	m_file = nullptr;
+	m_rotating = true;
+	m_rotatedPrevious = false;
+	m_recordCount = m_buffer.size();
+	AppendAll(carried);
+	return true;
+}
+
+bool ChunkJournal::FinishRotate()
+{
+	if (m_rotatingFile)
+	{
+		bool synced = SyncFile(m_rotatingFile);
+		fclose(m_rotatingFile);
+		m_rotatingFile = nullptr;
+		if (!synced)
+			return false;
+	}
+
+	std::error_code error;
+	if (std::filesystem::exists(std::filesystem::path(m_filePath), error))
+	{
+		std::filesystem::rename(std::filesystem::path(m_filePath), std::filesystem::path(m_previousPath), error);
+		if (error)
+			return false;
+		m_rotatedPrevious = true;
+	}
+	return true;
+}
+
+void ChunkJournal::EndRotate(bool rotated)
+{
+	m_rotating = false;
+	m_hasPrevious = rotated && m_rotatedPrevious;
+
+	// the old file is still current, appending to it keeps its records for the next round
+	std::error_code error;
+	if (!rotated && std::filesystem::exists(std::filesystem::path(m_filePath), error))
+		m_file = OpenFile(m_filePath, "ab");
+}
+
+void ChunkJournal::DropPrevious()
+{
+	std::error_code error;
+	std::filesystem::remove(std::filesystem::path(m_previousPath), error);
+	m_hasPrevious = false;
+}
+
+bool ChunkJournal::Restart(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried)
+{
+	Close();
+	m_buffer.clear();
+	m_recordCount = 0;
+
+	// carried edits land under a temporary name first, a crash meanwhile still finds the old files
+	std::error_code error;
+	if (!carried.empty())
+	{
+		std::string tempPath = m_filePath + ".tmp";
+		FILE* file = OpenFile(tempPath, "wb");
+		bool written = file && WriteHeader(file);
+		AppendAll(carried);
+		size_t bytes = m_buffer.size() * sizeof(ChunkJournalRecord);
+		written = written && fwrite(m_buffer.data(), 1, bytes, file) == bytes && SyncFile(file);
+		if (file)
+			fclose(file);
+		if (written)
+			std::filesystem::rename(std::filesystem::path(tempPath), std::filesystem::path(m_filePath), error);
+		if (!written || error)
+		{
+			std::filesystem::remove(std::filesystem::path(tempPath), error);
+			m_buffer.clear();
+			m_recordCount = 0;
+			return false;
+		}
+		m_flushedBytes += bytes;
+		m_buffer.clear();
+		m_file = OpenFile(m_filePath, "ab");
+	}
+	else
+	{
+		std::filesystem::remove(std::filesystem::path(m_filePath), error);
+	}
+	DropPrevious();
+	return true;
+}
+
+size_t ChunkJournal::Recover(std::map<ChunkCoords, std::vector<BlockEdit>>& edits) const
+{
+	return ReadFile(m_previousPath, edits) + ReadFile(m_filePath, edits);
+}
+
+bool ChunkJournal::WriteHeader(FILE* file) const
+{
+	unsigned char header[CHUNK_JOURNAL_HEADER_SIZE];
+	memcpy(header, CHUNK_JOURNAL_MAGIC, 4);
+	memcpy(header + 4, &CHUNK_JOURNAL_VERSION, 4);
+	memcpy(header + 8, &m_worldSeed, 4);
+	return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+void ChunkJournal::AppendAll(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried)
+{
+	for (const auto& entry : carried)
+		for (const BlockEdit& edit : entry.second)
+			Append(entry.first, edit.m_blockIndex, edit.m_blockId);
+}
+
+void ChunkJournal::Close()
+{
+	if (m_file)
+		fclose(m_file);
+	m_file = nullptr;
+}
+
+size_t ChunkJournal::ReadFile(const std::string& filePath, std::map<ChunkCoords, std::vector<BlockEdit>>& edits) const
+{
+	FILE* file = OpenFile(filePath, "rb");
+	if (!file)
+		return 0;
+
+	unsigned char header[CHUNK_JOURNAL_HEADER_SIZE];
+	unsigned int version = 0;
+	unsigned int worldSeed = 0;
+	bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, CHUNK_JOURNAL_MAGIC, 4) == 0;
+	memcpy(&version, header + 4, 4);
+	memcpy(&worldSeed, header + 8, 4);
+	if (!valid || version != CHUNK_JOURNAL_VERSION || worldSeed != m_worldSeed)
+	{
+		fclose(file);
+		return 0;
+	}
+
+	// a torn tail from a crash mid write ends the replay, every record before it is whole
+	size_t count = 0;
+	std::vector<ChunkJournalRecord> records(CHUNK_JOURNAL_READ_RECORDS);
+	for (;;)
+	{
+		size_t read = fread(records.data(), sizeof(ChunkJournalRecord), records.size(), file);
+		for (size_t index = 0; index < read; index++)
+		{
+			const ChunkJournalRecord& record = records[index];
+			if (record.m_check != GetRecordCheck(record) || record.m_blockIndex >= CHUNK_SIZE_BLOCKS)
+			{
+				fclose(file);
+				return count;
+			}
+			edits[ChunkCoords(record.m_chunkX, record.m_chunkY)].push_back({ record.m_blockIndex, record.m_blockId });
+			count++;
+		}
+		if (read < records.size())
+			break;
+	}
+	fclose(file);
+	return count;
+}
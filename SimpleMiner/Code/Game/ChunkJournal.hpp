@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Game/Chunk.hpp"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+constexpr const char* CHUNK_JOURNAL_FILE_NAME          = "Edits.journal";
+constexpr const char* CHUNK_JOURNAL_PREVIOUS_FILE_NAME = "Edits.previous.journal"; // edits of the autosave round still being written
+
+// one block change, the block id it was set to rather than a diff, so replaying a record twice is harmless
+#pragma pack(push, 1)
+struct ChunkJournalRecord
+{
+	int            m_chunkX;
+	int            m_chunkY;
+	unsigned short m_blockIndex;
+	BlockId        m_blockId;
+	unsigned char  m_check; // of the bytes before it, a torn record ends the replay
+};
+#pragma pack(pop)
+static_assert(sizeof(ChunkJournalRecord) == 12, "journal records are written as they are laid out");
+
+// append only log of block edits since the chunks were last saved. records are buffered and handed to the OS once a
+// frame, so a crash of the game loses none of them. an autosave round rotates the log: the previous file covers the
+// chunks being saved and is dropped once they are in their regions, edits made meanwhile go to the new file.
+// recovery reads the previous file, then the current one. main thread only, but for FinishRotate on a worker
+class ChunkJournal
+{
+public:
+	ChunkJournal(const std::string& folderPath);
+	ChunkJournal(const ChunkJournal&) = delete;
+	ChunkJournal& operator=(const ChunkJournal&) = delete;
+	~ChunkJournal(); // flushes and leaves the files for the next start, a clean shutdown resets first
+
+	void   Append(const ChunkCoords& coords, unsigned short blockIndex, BlockId blockId);
+	bool   Flush(); // buffered records to the OS, opens a new file on first use
+	bool   BeginRotate(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried); // hands the current file over, false while the previous round is not dropped
+	bool   FinishRotate(); // on any thread between the two, syncs the handed over file and renames it to the previous one
+	void   EndRotate(bool rotated); // records appended meanwhile go to the new file from here on
+	void   DropPrevious(); // its edits are all in region files now
+	bool   Restart(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried); // every saved edit is dropped, carried ones are renamed in over both files
+	size_t Recover(std::map<ChunkCoords, std::vector<BlockEdit>>& edits) const; // records read, in order per chunk
+
+	bool   HasPrevious() const { return m_hasPrevious; }
+	bool   IsRotating() const { return m_rotating; }
+	size_t GetRecordCount() const { return m_recordCount; } // in the current file, buffered ones included
+	size_t GetAppendedCount() const { return m_appendedCount; }
+	size_t GetFlushedBytes() const { return m_flushedBytes; }
+	void   SetWorldSeed(unsigned int worldSeed) { m_worldSeed = worldSeed; } // files of another seed are not replayed
+
+	static unsigned char GetRecordCheck(const ChunkJournalRecord& record);
+
+private:
+	bool   WriteHeader(FILE* file) const;
+	void   AppendAll(const std::map<ChunkCoords, std::vector<BlockEdit>>& carried);
+	void   Close();
+	size_t ReadFile(const std::string& filePath, std::map<ChunkCoords, std::vector<BlockEdit>>& edits) const;
+
+private:
+	std::string                     m_filePath;
+	std::string                     m_previousPath;
+	FILE*                           m_file = nullptr;
+	unsigned int                    m_worldSeed = 0;
+	std::vector<ChunkJournalRecord> m_buffer; // appended since the last flush
+	bool                            m_hasPrevious = false;
+	bool                            m_rotating = false;        // records stay buffered until the rotation ends
+	FILE*                           m_rotatingFile = nullptr;  // owned by FinishRotate
+	bool                            m_rotatedPrevious = false; // set by FinishRotate, read by EndRotate
+	size_t                          m_recordCount = 0;
+	size_t                          m_appendedCount = 0;
+	size_t                          m_flushedBytes = 0;
+};
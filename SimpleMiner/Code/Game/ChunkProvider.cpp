@@ -1,17 +1,23 @@
 #include "Game/ChunkProvider.hpp"
 
 #include "Engine/Core/ByteBuffer.hpp"
+#include "Engine/Core/DevConsole.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/FileUtils.hpp"
 #include "Engine/Core/NamedStrings.hpp"
+#include "Engine/Core/Time.hpp"
 #include "Engine/Input/InputSystem.hpp"
 #include "Game/World.hpp"
 #include "Game/BlockDef.hpp"
 #include "Game/WorldGenerator.hpp"
 #include "Engine/Math/RandomNumberGenerator.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 
 int g_nbrReqCounter = 0;
 int g_dirtyCounter = 0;
@@ -23,22 +29,55 @@ int g_newReqCounter = 0;
 
 extern RandomNumberGenerator rng;
 
+constexpr int RANDOM_TICK_CHUNKS_RADIUS = 8;
+constexpr int LIGHTING_NEAR_CHUNKS_RADIUS = 3;
+constexpr int LIGHTING_BLOCKS_PER_TIME_CHECK = 64;
+constexpr size_t LIGHTING_PARALLEL_THRESHOLD = 16384;     // below this the serial path is cheaper than job dispatch
+constexpr int LIGHTING_PARALLEL_BLOCKS_PER_JOB = 4096;
+constexpr int LIGHTING_PARALLEL_MIN_BLOCKS_PER_JOB = 256; // keeps a phase worth its dispatch when the budget is nearly spent
+constexpr double LIGHTING_RATE_SMOOTHING = 0.25;
+constexpr float LOAD_VIEW_CONE_COS = 0.5f;          // chunks within 60 degrees of the view direction are boosted
+constexpr float LOAD_VIEW_CONE_WEIGHT = 0.25f;      // boosted chunks load as if half as far away
+constexpr float LOAD_FACING_SECTOR = 3.14159265f / 4.0f; // the queue is resorted once a hotspot turns into another eighth
+constexpr size_t AUTOSAVE_WRITER_QUEUE_LIMIT = CHUNK_WRITE_QUEUE_CAPACITY / 2; // autosave pauses past it, unloading chunks keep the rest
+constexpr double AUTOSAVE_ESTIMATE_DECAY = 0.95;    // a slow save makes the next frames careful for a while
+constexpr double AUTOSAVE_INITIAL_ESTIMATE = 0.0002; // seconds for one chunk until one was measured
+
 ChunkProvider::ChunkProvider(World* world, const char* folderPath, WorldGenerator* generator)
 	: m_world(world)
 	, m_path(folderPath)
+	, m_regions(folderPath)
+	, m_chunkWriter(&m_regions)
+	, m_journal(folderPath)
 	, m_generator(generator)
+	, m_featureQueue(folderPath)
 {
 	std::filesystem::create_directories(std::filesystem::path(folderPath));
 
 	m_chunkActivationRange = g_gameConfigBlackboard.GetValue("chunkActivationRange", m_chunkActivationRange);
 	m_worldSeed = (unsigned int)g_gameConfigBlackboard.GetValue("worldSeed", (int)m_worldSeed);
+	m_lightingBudgetSeconds = 0.001 * (double)g_gameConfigBlackboard.GetValue("lightingBudgetMs", (float)(m_lightingBudgetSeconds * 1000.0));
+	m_mappedReads = g_gameConfigBlackboard.GetValue("chunkMappedReads", m_mappedReads);
+	m_deltaSaveEnabled = g_gameConfigBlackboard.GetValue("chunkDeltaSave", m_deltaSaveEnabled);
+	m_codec = ChunkCodec::FindByName(g_gameConfigBlackboard.GetValue("chunkCodec", "RLE"));
+	if (!m_codec)
+		m_codec = ChunkCodec::Find(CHUNK_CODEC_RLE);
 	m_generator->m_seed = m_worldSeed;
-
+	m_generator->SetCoarseSampling(g_gameConfigBlackboard.GetValue("worldCoarseSampling", false));
+	SetAutosave((double)g_gameConfigBlackboard.GetValue("autosaveIntervalSeconds", (float)m_autosaveIntervalSeconds),
+		0.001 * (double)g_gameConfigBlackboard.GetValue("autosaveBudgetMs", (float)(m_autosaveBudgetSeconds * 1000.0)),
+		g_gameConfigBlackboard.GetValue("autosaveBatchChunks", m_autosaveBatchChunks));
+	RecoverJournal();
+	m_featureQueue.SetWorldSeed(m_worldSeed);
+	m_featureQueue.Load();
+
+	BuildLoadOffsets();
 	m_rndTickWatch.Start(1.0 / 20.0);
 }
 
 ChunkProvider::~ChunkProvider()
 {
+	FinishUpJournalRotation();
 	delete m_generator;
 }
 
@@ -46,8 +85,9 @@ void ChunkProvider::Update()
 {
 	BeginFrame();
 
-	for (auto& chunkEntry : GetLoadedChunks())
-		chunkEntry.second->Update();
+	ApplyNewQueuedFeatures();
+
+	ProcessMeshRebuilds();
 
 	UpdateRandomTick();
 
@@ -80,9 +120,13 @@ bool ChunkProvider::LoadChunkWithTicket(const ChunkCoords& coords)
 
 void ChunkProvider::PopulateChunk(Chunk* chunk)
 {
-	m_generator->GenerateChunk(chunk);
+	m_generator->GenerateChunk(chunk, chunk->m_loadedFromDisk ? nullptr : &m_featureQueue); // a delta chunk queued its blocks when first generated
+	chunk->m_hasGeneratedBase = m_deltaSaveEnabled && !m_disableSaveToDisk; // the generator output under edits is only kept for delta saves
+	chunk->ApplyPendingEdits();
+	chunk->RebuildHeightMap();
+	chunk->PopulateLocalLight();
 	chunk->m_meshDirty = true;
-	chunk->m_blocksDirty = true;
+	chunk->m_blocksDirty = !chunk->m_loadedFromDisk || chunk->m_generatorChanged; // a delta file of this version already holds these edits
 }
 
 Chunk* ChunkProvider::FindLoadedChunk(const ChunkCoords& coords) const
@@ -93,25 +137,47 @@ Chunk* ChunkProvider::FindLoadedChunk(const ChunkCoords& coords) const
 	return nullptr;
 }
 
-std::string ChunkProvider::GetFileName(const ChunkCoords& coords) const
-{
-	return Stringf("%s/Chunk(%d,%d).chunk", m_path.c_str(), coords.x, coords.y);
-}
-
-void ChunkProvider::UnloadAllChunks()
+void ChunkProvider::FinishUpChunkGeneration()
 {
 	while (!m_chunksGenerating.empty())
 	{
 		g_theJobSystem->FinishUpJobsOfType(JOB_TYPE_GEN_CHUNK);
 		std::this_thread::sleep_for(std::chrono::milliseconds(50));
 	}
+	ApplyNewQueuedFeatures();
+}
+
+void ChunkProvider::UnloadAllChunks()
+{
+	FinishUpChunkGeneration();
+	FinishUpJournalRotation();
 
 	for (auto& entry : m_chunksLoaded)
-	{
 		SaveChunkToDisk(entry.second);
+	bool flushed = m_chunkWriter.Flush(CHUNK_FLUSH_THREADS);
+
+	// every edit is in a region now, only recovered edits of chunks that never loaded stay journaled.
+	// when some chunks could not be written the journal is left for the next start to replay
+	m_autosaveQueue.clear();
+	if (!flushed)
+		g_theConsole->AddLine(DevConsole::LOG_WARN, Stringf("%d chunks could not be saved, their edits stay in the journal", (int)m_chunkWriter.GetFailedChunkCount()));
+	else if (!m_disableSaveToDisk)
+		m_journal.Restart(m_recoveredEdits);
+	m_featureQueue.Rewrite(); // blocks taken were saved with their chunks or are journaled still
+
+	for (auto& entry : m_chunksLoaded)
 		delete entry.second;
-	}
 	m_chunksLoaded.clear();
+
+	for (auto& chunks : m_chunksDirtyLighting)
+		chunks.clear();
+	m_chunksDarkLighting.clear();
+
+	m_chunksMeshDirty.clear();
+	m_chunksPendingNeighbors.clear();
+	m_chunksTicking.clear();
+	m_chunksUnloading.clear();
+	m_loadQueueDirty = true;
 }
 
 const Block& ChunkProvider::GetBlock(const WorldCoords& coords) const
@@ -173,33 +239,70 @@ void ChunkProvider::ProcessDirtyLighting()
 	g_newReqCounter = 0;
 
 	if (WORLD_DEBUG_STEP_LIGHTING)
+	{
 		if (!g_theInput->WasKeyJustPressed(KEYCODE_G))
 			return;
 
-	if (WORLD_DEBUG_STEP_LIGHTING)
-		m_dirtyLighting.swap(m_debugLighting);
-	size_t initial = m_dirtyLighting.size();
-	while (m_dirtyLighting.size())
+		// step one propagation generation, ignoring the frame budget
+		while (!m_chunksDarkLighting.empty())
+			ProcessNextLightRemoval();
+
+		std::vector<std::pair<Chunk*, size_t>> step;
+		for (auto& chunks : m_chunksDirtyLighting)
+			for (Chunk* chunk : chunks)
+				step.push_back(std::make_pair(chunk, chunk->m_lightQueue.GetSize()));
+		for (auto& entry : step)
+			for (size_t i = 0; i < entry.second; i++)
+			{
+				g_dirtyCounter++;
+				ProcessDirtyLightBlock(BlockIterator(entry.first, entry.first->m_lightQueue.Pop()));
+			}
+		RemoveSettledLightChunks();
+		return;
+	}
+
+	// time sliced, whatever is left over resumes next frame
+	double deadline = GetCurrentTimeSeconds() + m_lightingBudgetSeconds;
+	if (GetDirtyLightingCount() >= LIGHTING_PARALLEL_THRESHOLD)
+	{
+		ProcessDirtyLightingParallel(deadline);
+		return;
+	}
+
+	while (HasDirtyLighting())
 	{
 		g_dirtyCounter++;
 		ProcessNextDirtyLightBlock();
-	}
 
-	if (initial == 0)
-		return;
+		if (g_dirtyCounter % LIGHTING_BLOCKS_PER_TIME_CHECK == 0 && GetCurrentTimeSeconds() > deadline)
+			break;
+	}
 
-// 	const char* info = "LightInfo: Init=%d, Dirty=%d, New=%d, Acc=%d, Rej=%d, Chg=%d, NoChg=%d, Nbr=%d";
-// 	std::string msg = Stringf(info, initial, g_dirtyCounter, g_newReqCounter, g_acceptedCounter, g_rejectedCounter, g_changedCounter, g_notchangedCounter, g_nbrReqCounter);
+// 	const char* info = "LightInfo: Dirty=%d, New=%d, Acc=%d, Rej=%d, Chg=%d, NoChg=%d, Nbr=%d";
+// 	std::string msg = Stringf(info, g_dirtyCounter, g_newReqCounter, g_acceptedCounter, g_rejectedCounter, g_changedCounter, g_notchangedCounter, g_nbrReqCounter);
 // 	DebugAddMessage(msg, 10.f, Rgba8::WHITE, Rgba8::WHITE);
 }
 
 void ChunkProvider::ProcessNextDirtyLightBlock()
 {
-	BlockIterator ite = m_dirtyLighting.front();
-	m_dirtyLighting.pop_front();
-	Block* block = ite.GetBlock();
+	if (!m_chunksDarkLighting.empty())
+	{
+		ProcessNextLightRemoval();
+		return;
+	}
+
+	auto& chunks = m_chunksDirtyLighting[LIGHT_PRIORITY_NEAR].empty() ? m_chunksDirtyLighting[LIGHT_PRIORITY_FAR] : m_chunksDirtyLighting[LIGHT_PRIORITY_NEAR];
+	Chunk* chunk = *chunks.begin();
+	int blockIndex = chunk->m_lightQueue.Pop();
+	if (chunk->m_lightQueue.IsEmpty())
+		chunks.erase(chunks.begin());
+
+	ProcessDirtyLightBlock(BlockIterator(chunk, blockIndex));
+}
 
-	block->SetLightDirty(false);
+void ChunkProvider::ProcessDirtyLightBlock(const BlockIterator& ite)
+{
+	m_lightingUpdateCount++;
 
 	if (g_theInput->IsKeyDown(KEYCODE_H))
 	{
@@ -208,19 +311,53 @@ void ChunkProvider::ProcessNextDirtyLightBlock()
 		DebugAddWorldPoint(world, 0.2f, 5.0f, Rgba8::RED, Rgba8::WHITE, DebugRenderMode::XRAY);
 	}
 
+	BlockIterator iteNbrs[BlockFace::BLOCK_FACE_SIZE] = {};
+	Block*        nbrs[BlockFace::BLOCK_FACE_SIZE]    = {};
+	g_nbrReqCounter += BLOCK_FACE_SIZE;
+
+	if (RelaxBlockLight(ite, iteNbrs, nbrs))
+	{
+		g_changedCounter++;
+
+		ite.GetChunk()->OnLightChanged(ite.GetBlockIndex());
+		ite.GetChunk()->MarkMeshDirty();
+		for (BlockFace face : BLOCK_NEIGHBORS)
+		{
+			const BlockIterator& iteNbr = iteNbrs[face];
+			Block* nbr = nbrs[face];
+			if (nbr->IsValid())
+			{
+				if (nbr->IsOpaque()) // a face of neighbor's lighting has changed
+				{
+					iteNbr.GetChunk()->MarkMeshDirty();
+				}
+				else // a block of neighbor needs to update light
+				{
+					g_newReqCounter++;
+					MarkLightingDirty(iteNbr);
+				}
+			}
+		}
+	}
+	else
+	{
+		g_notchangedCounter++;
+	}
+}
+
+bool ChunkProvider::RelaxBlockLight(const BlockIterator& ite, BlockIterator* iteNbrs, Block** nbrs)
+{
+	Block* block = ite.GetBlock();
+
 	LightLevel iLightPrev = block->GetIndoorLightInfluence();
 	LightLevel oLightPrev = block->GetOutdoorLightInfluence();
 
 	LightLevel iLight = block->GetGlowLight();
-	LightLevel oLight = block->GetSkyLight();
-
-	BlockIterator iteNbrs[BlockFace::BLOCK_FACE_SIZE] = {};
-	Block*        nbrs[BlockFace::BLOCK_FACE_SIZE]    = {};
+	LightLevel oLight = ite.IsSky() ? 15 : 0;
 
 	for (BlockFace face : BLOCK_NEIGHBORS)
 	{
 		iteNbrs[face] = ite.GetBlockNeighbor(face);
-		g_nbrReqCounter++;
 		nbrs[face] = iteNbrs[face].GetBlock();
 	}
 
@@ -244,48 +381,325 @@ void ChunkProvider::ProcessNextDirtyLightBlock()
 		}
 	}
 
-	if (iLight != iLightPrev || oLight != oLightPrev)
+	if (iLight == iLightPrev && oLight == oLightPrev)
+		return false;
+
+	block->SetIndoorLightInfluence(iLight);
+	block->SetOutdoorLightInfluence(oLight);
+	return true;
+}
+
+void ChunkProvider::InvalidateLighting(const BlockIterator& blockIte)
+{
+	Block* block = blockIte.GetBlock();
+	if (!block->IsValid())
+		return;
+
+	// clear the old light first, relaxing from stale neighbors would only fade it one level per pass
+	LightRemoval removal;
+	removal.m_blockIndex = (unsigned short)blockIte.GetBlockIndex();
+	removal.m_indoorLight = block->GetIndoorLightInfluence();
+	removal.m_outdoorLight = block->GetOutdoorLightInfluence();
+	if (m_lightRemovalEnabled && (removal.m_indoorLight || removal.m_outdoorLight))
 	{
-		g_changedCounter++;
+		block->SetIndoorLightInfluence(0);
+		block->SetOutdoorLightInfluence(0);
+		QueueLightRemoval(blockIte.GetChunk(), removal);
+	}
 
-		block->SetIndoorLightInfluence(iLight);
-		block->SetOutdoorLightInfluence(oLight);
-		ite.GetChunk()->m_meshDirty = true;
-		for (BlockFace face : BLOCK_NEIGHBORS)
+	MarkLightingDirty(blockIte); // re-seed its own source and pull in light from the surrounding
+}
+
+void ChunkProvider::QueueLightRemoval(Chunk* chunk, const LightRemoval& removal)
+{
+	chunk->m_lightQueue.PushRemoval(removal);
+	if (chunk->m_lightQueue.GetRemovalCount() == 1) // first pending removal, start tracking the chunk
+		m_chunksDarkLighting.insert(chunk);
+}
+
+void ChunkProvider::ProcessNextLightRemoval()
+{
+	Chunk* chunk = *m_chunksDarkLighting.begin();
+	LightRemoval removal = chunk->m_lightQueue.PopRemoval();
+	if (!chunk->m_lightQueue.HasRemovals())
+		m_chunksDarkLighting.erase(m_chunksDarkLighting.begin());
+	m_lightingUpdateCount++;
+
+	BlockIterator ite(chunk, removal.m_blockIndex);
+	chunk->OnLightChanged(ite.GetBlockIndex());
+	chunk->MarkMeshDirty();
+
+	// a neighbor dimmer than the removed level was lit through this block and goes dark too,
+	// a neighbor at least as bright is lit from elsewhere and will flow back in
+	bool reachedLitBlock = false;
+	for (BlockFace face : BLOCK_NEIGHBORS)
+	{
+		BlockIterator iteNbr = ite.GetBlockNeighbor(face);
+		Block* nbr = iteNbr.GetBlock();
+		if (!nbr->IsValid())
+			continue;
+
+		LightLevel iLightNbr = nbr->GetIndoorLightInfluence();
+		LightLevel oLightNbr = nbr->GetOutdoorLightInfluence();
+
+		if (nbr->IsOpaque())
 		{
-			const BlockIterator& iteNbr = iteNbrs[face];
-			Block* nbr = nbrs[face];
-			if (nbr->IsValid())
+			// opaque blocks only hold their own glow, never darken them
+			iteNbr.GetChunk()->MarkMeshDirty();
+			if (removal.m_indoorLight && iLightNbr > 0)
+				reachedLitBlock = true;
+			continue;
+		}
+
+		LightRemoval nbrRemoval;
+		nbrRemoval.m_blockIndex = (unsigned short)iteNbr.GetBlockIndex();
+		if (removal.m_indoorLight && iLightNbr > 0)
+		{
+			if (iLightNbr < removal.m_indoorLight)
 			{
-				if (nbr->IsOpaque()) // a face of neighbor's lighting has changed
-				{
-					iteNbr.GetChunk()->m_meshDirty = true;
-				}
-				else // a block of neighbor needs to update light
-				{
-					g_newReqCounter++;
-					MarkLightingDirty(iteNbr);
-				}
+				nbrRemoval.m_indoorLight = iLightNbr;
+				nbr->SetIndoorLightInfluence(0);
+			}
+			else
+			{
+				reachedLitBlock = true;
 			}
 		}
+		if (removal.m_outdoorLight && oLightNbr > 0)
+		{
+			// only an open column holds 15, anything else at 15 just lost its sky through this block
+			if (!iteNbr.IsSky() && (oLightNbr < removal.m_outdoorLight || oLightNbr == 15))
+			{
+				nbrRemoval.m_outdoorLight = oLightNbr;
+				nbr->SetOutdoorLightInfluence(0);
+			}
+			else
+			{
+				reachedLitBlock = true;
+			}
+		}
+
+		if (nbrRemoval.m_indoorLight || nbrRemoval.m_outdoorLight)
+		{
+			QueueLightRemoval(iteNbr.GetChunk(), nbrRemoval);
+			if (nbr->GetGlowLight())
+				MarkLightingDirty(iteNbr); // its own source survives the removal
+		}
 	}
-	else
-	{
-		g_notchangedCounter++;
-	}
+
+	if (reachedLitBlock)
+		MarkLightingDirty(ite);
 }
 
 void ChunkProvider::MarkLightingDirty(const BlockIterator& blockIte)
 {
-	Block* blk = blockIte.GetBlock();
-	if (!blk->IsValid() || blk->IsLightDirty())
+	Chunk* chunk = blockIte.GetChunk();
+	if (!blockIte.GetBlock()->IsValid() || !chunk->m_lightQueue.Push(blockIte.GetBlockIndex()))
 	{
 		g_rejectedCounter++;
 		return;
 	}
 	g_acceptedCounter++;
-	blk->SetLightDirty(true);
-	(WORLD_DEBUG_STEP_LIGHTING ? m_debugLighting : m_dirtyLighting).push_back(blockIte);
+	if (chunk->m_lightQueue.GetSize() == 1) // first pending block, start tracking the chunk
+	{
+		bool isNear = IsChunkInRange(chunk->m_chunkCoords, LIGHTING_NEAR_CHUNKS_RADIUS);
+		m_chunksDirtyLighting[isNear ? LIGHT_PRIORITY_NEAR : LIGHT_PRIORITY_FAR].insert(chunk);
+	}
+}
+
+void ChunkProvider::RemoveSettledLightChunks()
+{
+	for (auto& chunks : m_chunksDirtyLighting)
+	{
+		auto ite = chunks.begin();
+		while (ite != chunks.end())
+		{
+			if ((*ite)->m_lightQueue.IsEmpty())
+				ite = chunks.erase(ite);
+			else
+				ite++;
+		}
+	}
+}
+
+void ChunkProvider::RebucketDirtyLighting()
+{
+	std::set<Chunk*> pending;
+	for (auto& chunks : m_chunksDirtyLighting)
+	{
+		pending.insert(chunks.begin(), chunks.end());
+		chunks.clear();
+	}
+
+	for (Chunk* chunk : pending)
+	{
+		bool isNear = IsChunkInRange(chunk->m_chunkCoords, LIGHTING_NEAR_CHUNKS_RADIUS);
+		m_chunksDirtyLighting[isNear ? LIGHT_PRIORITY_NEAR : LIGHT_PRIORITY_FAR].insert(chunk);
+	}
+}
+
+void ChunkProvider::ProcessDirtyLightingParallel(double deadline)
+{
+	// chunks are split in four colors by coordinate parity, chunks of the same color never touch,
+	// so one job per chunk can relax its own blocks while reading stable neighbor borders.
+	// border requests are merged back on main thread and picked up by the next phase.
+	// the relaxation converges to a unique fixpoint, so the result matches the serial path exactly.
+	// near chunks are drained before far ones and jobs are sized to what is left of the budget,
+	// whatever is left over resumes next frame
+	auto isPastDeadline = [deadline]() { return deadline > 0.0 && GetCurrentTimeSeconds() > deadline; };
+	while (HasDirtyLighting())
+	{
+		int removals = 0;
+		while (!m_chunksDarkLighting.empty())
+		{
+			ProcessNextLightRemoval();
+			if (++removals % LIGHTING_BLOCKS_PER_TIME_CHECK == 0 && isPastDeadline())
+				return;
+		}
+		if (isPastDeadline())
+			return;
+
+		for (int color = 0; color < 4; color++)
+		{
+			bool isNear = !m_chunksDirtyLighting[LIGHT_PRIORITY_NEAR].empty();
+			std::set<Chunk*>& chunks = m_chunksDirtyLighting[isNear ? LIGHT_PRIORITY_NEAR : LIGHT_PRIORITY_FAR];
+			int maxBlocks = GetLightJobBlockLimit(deadline, 4 - color);
+
+			// each job drains the light queue of its own chunk, no partitioning needed
+			int jobCount = 0;
+			m_lightJobsMostProcessed = 0;
+			double phaseStart = GetCurrentTimeSeconds();
+			for (Chunk* chunk : chunks)
+				if (((chunk->m_chunkCoords.x & 1) | ((chunk->m_chunkCoords.y & 1) << 1)) == color)
+				{
+					m_lightJobsRunning++;
+					jobCount++;
+					g_theJobSystem->QueueJob(new ChunkLightJob(this, chunk, maxBlocks));
+				}
+
+			WaitForLightJobs(jobCount);
+			UpdateLightJobRate(GetCurrentTimeSeconds() - phaseStart);
+			RemoveSettledLightChunks();
+			if (isPastDeadline())
+				return;
+		}
+	}
+}
+
+int ChunkProvider::GetLightJobBlockLimit(double deadline, int phasesLeft) const
+{
+	if (deadline <= 0.0)
+		return LIGHTING_PARALLEL_BLOCKS_PER_JOB;
+
+	// the slowest job of a phase holds up the others, so each job gets a share of what is left of the budget
+	double secondsPerPhase = (deadline - GetCurrentTimeSeconds()) / (double)phasesLeft;
+	double maxBlocks = secondsPerPhase * m_lightJobBlocksPerSecond;
+	return (int)Clamp((float)maxBlocks, (float)LIGHTING_PARALLEL_MIN_BLOCKS_PER_JOB, (float)LIGHTING_PARALLEL_BLOCKS_PER_JOB);
+}
+
+void ChunkProvider::UpdateLightJobRate(double phaseSeconds)
+{
+	// phases too short to time well, or that left every job idle, keep the last rate
+	if (m_lightJobsMostProcessed < LIGHTING_PARALLEL_MIN_BLOCKS_PER_JOB || phaseSeconds <= 0.0)
+		return;
+
+	double rate = (double)m_lightJobsMostProcessed / phaseSeconds;
+	m_lightJobBlocksPerSecond += (rate - m_lightJobBlocksPerSecond) * LIGHTING_RATE_SMOOTHING;
+}
+
+void ChunkProvider::WaitForLightJobs(int jobCount)
+{
+	// sleep until the workers ran every job of the phase, then merge them back in OnFinished
+	{
+		std::unique_lock<std::mutex> lock(m_lightJobsMutex);
+		m_lightJobsDone.wait(lock, [this, jobCount]() { return m_lightJobsExecuted >= jobCount; });
+		m_lightJobsExecuted = 0;
+	}
+	while (m_lightJobsRunning > 0)
+	{
+		g_theJobSystem->FinishUpJobsOfType(JOB_TYPE_LIGHT_CHUNK);
+		if (m_lightJobsRunning > 0)
+			std::this_thread::yield(); // executed, its worker has not handed it back yet
+	}
+}
+
+void ChunkProvider::ProcessAllDirtyLighting(bool parallel)
+{
+	if (parallel)
+	{
+		ProcessDirtyLightingParallel(0.0);
+		return;
+	}
+
+	while (HasDirtyLighting())
+		ProcessNextDirtyLightBlock();
+}
+
+void ChunkProvider::RelightAllChunks(bool parallel)
+{
+	for (auto& chunks : m_chunksDirtyLighting)
+		chunks.clear();
+	m_chunksDarkLighting.clear();
+
+	for (auto& entry : m_chunksLoaded)
+	{
+		Chunk* chunk = entry.second;
+		chunk->m_lightQueue.Clear();
+		for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+		{
+			Block& block = chunk->m_blockArray[index];
+			block.SetIndoorLightInfluence(0);
+			block.SetOutdoorLightInfluence(0);
+		}
+	}
+
+	// same steps as a freshly loaded chunk, local light first then borders against each neighbor
+	for (auto& entry : m_chunksLoaded)
+	{
+		entry.second->PopulateLocalLight();
+		entry.second->m_lightDirty = true;
+		entry.second->MarkMeshDirty();
+	}
+	for (auto& entry : m_chunksLoaded)
+		for (BlockFace face : CHUNK_NEIGHBORS)
+			entry.second->PullBorderLight(face);
+
+	ProcessAllDirtyLighting(parallel);
+}
+
+size_t ChunkProvider::GetDirtyLightingCount() const
+{
+	size_t count = 0;
+	for (const Chunk* chunk : m_chunksDarkLighting)
+		count += chunk->m_lightQueue.GetRemovalCount();
+	for (auto& chunks : m_chunksDirtyLighting)
+		for (const Chunk* chunk : chunks)
+			count += chunk->m_lightQueue.GetSize();
+	return count;
+}
+
+bool ChunkProvider::HasDirtyLighting() const
+{
+	if (!m_chunksDarkLighting.empty())
+		return true;
+	for (auto& chunks : m_chunksDirtyLighting)
+		if (!chunks.empty())
+			return true;
+	return false;
+}
+
+bool ChunkProvider::IsLightingResolved(const Chunk* chunk) const
+{
+	if (WORLD_DEBUG_STEP_LIGHTING)
+		return true; // do not hold meshes back while stepping manually
+
+	// faces on the border sample light from neighbor blocks, so neighbors must be settled too
+	if (chunk->HasPendingLight())
+		return false;
+	for (const Chunk* neighbor : chunk->m_neighbors)
+		if (neighbor && neighbor->HasPendingLight())
+			return false;
+	return true;
 }
 
 void ChunkProvider::MarkLightingDirty(const WorldCoords& worldCoords)
@@ -299,20 +713,76 @@ void ChunkProvider::UndirtyAllBlocksInChunk(const ChunkCoords& chunkCoords)
 	if (!chunk)
 		return;
 
-	auto ite = m_dirtyLighting.begin();
-	while (ite != m_dirtyLighting.end())
+	// pending relaxations and removals live in the chunk itself, dropping them does not touch other chunks
+	for (auto& chunks : m_chunksDirtyLighting)
+		chunks.erase(chunk);
+	m_chunksDarkLighting.erase(chunk);
+	chunk->m_lightQueue.Clear();
+}
+
+void ChunkProvider::EnqueueMeshRebuild(Chunk* chunk)
+{
+	if (chunk->HasAllNeighbors())
+	{
+		m_chunksPendingNeighbors.erase(chunk);
+		if (chunk->m_meshQueueDistance < 0)
+		{
+			chunk->m_meshQueueDistance = GetHotspotDistanceSquared(chunk->m_chunkCoords);
+			m_chunksMeshDirty.insert(std::make_pair(chunk->m_meshQueueDistance, chunk));
+		}
+	}
+	else
+	{
+		DequeueMeshRebuild(chunk);
+		m_chunksPendingNeighbors.insert(chunk);
+	}
+}
+
+void ChunkProvider::DequeueMeshRebuild(Chunk* chunk)
+{
+	if (chunk->m_meshQueueDistance < 0)
+		return;
+	m_chunksMeshDirty.erase(std::make_pair(chunk->m_meshQueueDistance, chunk));
+	chunk->m_meshQueueDistance = -1;
+}
+
+void ChunkProvider::RebucketMeshRebuilds()
+{
+	std::set<std::pair<int, Chunk*>> queued;
+	queued.swap(m_chunksMeshDirty);
+	for (auto& entry : queued)
 	{
-		auto& blockIte = *ite;
-		if (blockIte.GetChunk() == chunk)
+		Chunk* chunk = entry.second;
+		chunk->m_meshQueueDistance = GetHotspotDistanceSquared(chunk->m_chunkCoords);
+		m_chunksMeshDirty.insert(std::make_pair(chunk->m_meshQueueDistance, chunk));
+	}
+}
+
+void ChunkProvider::ProcessMeshRebuilds()
+{
+	auto ite = m_chunksMeshDirty.begin();
+	while (ite != m_chunksMeshDirty.end() && m_rebuildMeshTicket > 0)
+	{
+		Chunk* chunk = ite->second;
+		if (!IsLightingResolved(chunk))
 		{
-			blockIte.GetBlock()->SetLightDirty(false);
-			ite = m_dirtyLighting.erase(ite);
+			ite++; // hold back until lighting settles, never show wrong light
 			continue;
 		}
-		ite++;
+		GetRebuildMeshTicket();
+		ite = m_chunksMeshDirty.erase(ite);
+		chunk->m_meshQueueDistance = -1;
+		chunk->RebuildMesh();
 	}
 }
 
+void ChunkProvider::SetDiskIOEnabled(bool enabled)
+{
+	m_disableLoadFromDisk = !enabled;
+	m_disableSaveToDisk = !enabled;
+	m_featureQueue.SetFileEnabled(enabled);
+}
+
 bool ChunkProvider::GetChunkIOTicket()
 {
 	if (m_chunkIOTicket > 0)
@@ -336,16 +806,46 @@ bool ChunkProvider::GetRebuildMeshTicket()
 void ChunkProvider::SetHotspotSize(int size)
 {
 	m_hotspots.resize(size);
+	m_hotspotFacings.resize(size);
+	m_loadQueueDirty = true;
+
+	RebuildTickingChunks();
+	RebuildUnloadQueue();
+	RebucketMeshRebuilds();
 }
 
-void ChunkProvider::SetHotspot(int index, const Vec3& worldPos)
+// GetFacingSector: Eighth of the circle a horizontal direction points into, -1 without one
+static int GetFacingSector(const Vec2& facing)
 {
+	if (facing.x == 0.0f && facing.y == 0.0f)
+		return -1;
+	return (int)floorf(atan2f(facing.y, facing.x) / LOAD_FACING_SECTOR + 0.5f) & 7;
+}
+
+void ChunkProvider::SetHotspot(int index, const Vec3& worldPos, const Vec3& forward)
+{
+	Vec2 facing;
+	float length = sqrtf(forward.x * forward.x + forward.y * forward.y);
+	if (length > 0.001f)
+		facing = Vec2(forward.x / length, forward.y / length);
+	if (GetFacingSector(facing) != GetFacingSector(m_hotspotFacings[index]))
+	{
+		m_hotspotFacings[index] = facing;
+		m_loadQueueDirty = true;
+	}
+
 	ChunkCoords newCoords = Chunk::GetChunkCoords(worldPos);
 	if (m_hotspots[index] != newCoords) 
 	{
 		m_hotspots[index] = newCoords;
+		m_loadQueueDirty = true;
 		if (m_chunksLoaded.find(newCoords) == m_chunksLoaded.end())
 			LoadChunk(newCoords); // make sure chunk is loaded otherwise player will fall into ground
+
+		RebuildTickingChunks();
+		RebuildUnloadQueue();
+		RebucketDirtyLighting();
+		RebucketMeshRebuilds();
 	}
 }
 
@@ -366,105 +866,111 @@ void ChunkProvider::UpdateRandomTick()
 		for (int i = 0; i < 1024; i++)
 			rndSource[i] = rng.RollRandomFloatZeroToOne();
 
-		int rndTickChunksRadius = 8;
-
-		for (auto& hotspot : m_hotspots)
-		{
-			Chunk* origin = FindLoadedChunk(hotspot);
-			if (origin)
-				origin->UpdateRandomTick(1024, rndSource, rng.RollRandomIntInRange(0, 1023));
-
-			for (int size = 1; size < rndTickChunksRadius; size++)
-			{
-				ChunkCoords coords = hotspot + IntVec2(size, size);
-				for (BlockFace face : { BLOCK_FACE_EAST, BLOCK_FACE_SOUTH, BLOCK_FACE_WEST, BLOCK_FACE_NORTH })
-				{
-					for (int i = 0; i < size * 2; i++)
-					{
-						if ((coords - hotspot).GetLengthSquared() < rndTickChunksRadius * rndTickChunksRadius)
-						{
-							Chunk* chunk = FindLoadedChunk(coords);
-							if (chunk)
-								chunk->UpdateRandomTick(1024, rndSource, rng.RollRandomIntInRange(0, 1023));
-						}
-						coords += Block::GetOffset2ByFace(face);
-					}
-				}
-			}
-		}
+		for (Chunk* chunk : m_chunksTicking)
+			chunk->UpdateRandomTick(1024, rndSource, rng.RollRandomIntInRange(0, 1023));
 	}
 }
 
 void ChunkProvider::DoChunkDeactivation()
 {
-	int chunkDeactivationRange = m_chunkActivationRange + CHUNK_SIZE_XY + CHUNK_SIZE_XY;
-	int unloadChunksRadius = 1 + chunkDeactivationRange / CHUNK_SIZE_XY;
-
-	std::vector<ChunkCoords> unloadingChunks;
-	for (const auto& entry : m_chunksLoaded)
+	while (!m_chunksUnloading.empty())
 	{
-		bool unload = true;
-		for (const auto& hotspot : m_hotspots)
+		ChunkCoords coords = m_chunksUnloading.back();
+		if (!FindLoadedChunk(coords))
 		{
-			if ((entry.first - hotspot).GetLengthSquared() < unloadChunksRadius * unloadChunksRadius)
-			{
-				unload = false;
-				break;
-			}
+			m_chunksUnloading.pop_back(); // already unloaded
+			continue;
 		}
-		if (unload)
-			unloadingChunks.push_back(entry.first);
-	}
 
-	ChunkCoords coordsMax;
-	int lenSqMax = -1;
-	for (const auto& coords : unloadingChunks)
-	{
-		int lenSqTemp = 0;
-		for (const auto& hotspot : m_hotspots)
-		{
-			lenSqTemp += (coords - hotspot).GetLengthSquared();
-		}
-		if (lenSqTemp > lenSqMax)
+		if (GetChunkIOTicket())
 		{
-			lenSqMax = lenSqTemp;
-			coordsMax = coords;
+			m_chunksUnloading.pop_back();
+			UnloadChunk(coords);
 		}
+		return;
 	}
-
-	if (lenSqMax >= 0 && GetChunkIOTicket())
-		UnloadChunk(coordsMax);
 }
 
 void ChunkProvider::DoChunkActivation()
+{
+	if (m_loadQueueDirty)
+		RebuildLoadQueue();
+
+	int loadChunksRadius = 1 + m_chunkActivationRange / CHUNK_SIZE_XY;
+	size_t maxChunks = (size_t)((2 * loadChunksRadius) * (2 * loadChunksRadius));
+
+	// already loaded or queued entries pop without a ticket, so a frame always spends its tickets on new chunks
+	while (!m_chunksLoading.empty() && m_chunksLoaded.size() < maxChunks)
+	{
+		if (!LoadChunkWithTicket(m_chunksLoading.back()))
+			return; // out of tickets, the same chunk leads next frame
+		m_chunksLoading.pop_back();
+	}
+}
+
+// BuildLoadOffsets: Offsets of every chunk in activation range sorted by distance, then by angle to spiral outward
+void ChunkProvider::BuildLoadOffsets()
 {
 	int loadChunksRadius = 1 + m_chunkActivationRange / CHUNK_SIZE_XY;
-	int maxChunks = (2 * loadChunksRadius) * (2 * loadChunksRadius);
 
-	if (m_chunksLoaded.size() < maxChunks)
+	m_loadOffsets.clear();
+	for (int y = -loadChunksRadius; y <= loadChunksRadius; y++)
+		for (int x = -loadChunksRadius; x <= loadChunksRadius; x++)
+			if (x * x + y * y < loadChunksRadius * loadChunksRadius)
+				m_loadOffsets.push_back(IntVec2(x, y));
+
+	std::sort(m_loadOffsets.begin(), m_loadOffsets.end(), [](const IntVec2& a, const IntVec2& b) {
+		int lengthA = a.GetLengthSquared();
+		int lengthB = b.GetLengthSquared();
+		if (lengthA != lengthB)
+			return lengthA < lengthB;
+		return atan2f((float)a.y, (float)a.x) < atan2f((float)b.y, (float)b.x);
+	});
+	m_loadQueueDirty = true;
+}
+
+// RebuildLoadQueue: Missing chunks around every hotspot, nearest first with the view cone boosted, kept for the frames that follow
+void ChunkProvider::RebuildLoadQueue()
+{
+	m_loadQueueDirty = false;
+	m_loadQueueRebuildCount++;
+
+	std::map<ChunkCoords, float> priorities; // lower loads sooner, the best over all hotspots
+	for (size_t index = 0; index < m_hotspots.size(); index++)
 	{
-		for (auto& hotspot : m_hotspots)
+		const ChunkCoords& hotspot = m_hotspots[index];
+		const Vec2& facing = m_hotspotFacings[index];
+		for (const IntVec2& offset : m_loadOffsets)
 		{
-			if (!LoadChunkWithTicket(hotspot))
-				return;
-			for (int size = 1; size < loadChunksRadius; size++)
-			{
-				ChunkCoords coords = hotspot + IntVec2(size, size);
-				for (BlockFace face : { BLOCK_FACE_EAST, BLOCK_FACE_SOUTH, BLOCK_FACE_WEST, BLOCK_FACE_NORTH })
-				{
-					for (int i = 0; i < size * 2; i++)
-					{
-						if ((coords - hotspot).GetLengthSquared() < loadChunksRadius * loadChunksRadius)
-						{
-							if (!LoadChunkWithTicket(coords))
-								return;
-						}
-						coords += Block::GetOffset2ByFace(face);
-					}
-				}
-			}
+			ChunkCoords coords = hotspot + offset;
+			if (m_chunksLoaded.find(coords) != m_chunksLoaded.end() || m_chunksGenerating.find(coords) != m_chunksGenerating.end())
+				continue;
+
+			float distanceSquared = (float)offset.GetLengthSquared();
+			float alongFacing = facing.x * (float)offset.x + facing.y * (float)offset.y;
+			if (alongFacing > 0.0f && alongFacing * alongFacing >= LOAD_VIEW_CONE_COS * LOAD_VIEW_CONE_COS * distanceSquared)
+				distanceSquared *= LOAD_VIEW_CONE_WEIGHT;
+
+			auto ite = priorities.find(coords);
+			if (ite == priorities.end())
+				priorities[coords] = distanceSquared;
+			else if (distanceSquared < ite->second)
+				ite->second = distanceSquared;
 		}
 	}
+
+	std::vector<std::pair<float, ChunkCoords>> sorted;
+	sorted.reserve(priorities.size());
+	for (const auto& entry : priorities)
+		sorted.emplace_back(entry.second, entry.first);
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<float, ChunkCoords>& a, const std::pair<float, ChunkCoords>& b) {
+		return a.first > b.first;
+	});
+
+	m_chunksLoading.clear();
+	m_chunksLoading.reserve(sorted.size());
+	for (const auto& entry : sorted)
+		m_chunksLoading.push_back(entry.second);
 }
 
 void ChunkProvider::EndFrame()
@@ -472,6 +978,118 @@ void ChunkProvider::EndFrame()
 	ProcessDirtyLighting();
 
 	g_theJobSystem->FinishUpJobsOfType(JOB_TYPE_GEN_CHUNK, 2);
+
+	UpdateAutosave();
+	m_journal.Flush(); // a crash from here on loses none of this frame's edits
+	m_featureQueue.Flush();
+
+	// reported when chunks start failing and once they are all written again
+	size_t failedChunks = m_chunkWriter.GetFailedChunkCount();
+	if ((failedChunks > 0) != (m_reportedFailedChunks > 0))
+	{
+		if (failedChunks > 0)
+			g_theConsole->AddLine(DevConsole::LOG_WARN, Stringf("Saving %d chunks failed, retrying", (int)failedChunks));
+		else
+			g_theConsole->AddLine(DevConsole::LOG_INFO, "Failed chunk saves are written now");
+	}
+	m_reportedFailedChunks = failedChunks;
+}
+
+void ChunkProvider::SetAutosave(double intervalSeconds, double budgetSeconds, int batchChunks)
+{
+	m_autosaveIntervalSeconds = intervalSeconds;
+	m_autosaveBudgetSeconds = budgetSeconds;
+	m_autosaveBatchChunks = batchChunks;
+	m_autosaveChunkSeconds = AUTOSAVE_INITIAL_ESTIMATE;
+	m_nextAutosaveSeconds = intervalSeconds > 0.0 ? GetCurrentTimeSeconds() + intervalSeconds : std::numeric_limits<double>::infinity();
+}
+
+void ChunkProvider::RequestAutosave()
+{
+	m_nextAutosaveSeconds = 0.0;
+}
+
+void ChunkProvider::UpdateAutosave()
+{
+	if (m_disableSaveToDisk)
+		return;
+
+	// a round is over once every save it queued is on disk, the journal before it is not needed anymore.
+	// a save that failed holds the round until the writer's retry lands
+	double start = GetCurrentTimeSeconds();
+	g_theJobSystem->FinishUpJobsOfType(JOB_TYPE_ROTATE_JOURNAL);
+	if (m_autosaveQueue.empty() && m_journal.HasPrevious() && m_chunkWriter.IsWrittenUpTo(m_autosaveTicket))
+		m_journal.DropPrevious();
+	if (m_autosaveQueue.empty() && !m_journal.HasPrevious() && !m_journal.IsRotating() && start >= m_nextAutosaveSeconds)
+		BeginAutosaveRound(start);
+
+	// a save only starts when its estimate fits the rest of the budget, a full writer would make it wait.
+	// an estimate over the whole budget decays each frame nothing fits, a one off spike does not stall the round
+	int saved = 0;
+	bool popped = false;
+	while (!m_autosaveQueue.empty() && saved < m_autosaveBatchChunks)
+	{
+		double saveStart = GetCurrentTimeSeconds();
+		if (saveStart - start + m_autosaveChunkSeconds > m_autosaveBudgetSeconds)
+		{
+			if (saved == 0 && m_autosaveChunkSeconds > m_autosaveBudgetSeconds)
+				m_autosaveChunkSeconds *= AUTOSAVE_ESTIMATE_DECAY;
+			break;
+		}
+		if (m_chunkWriter.GetQueuedCount() >= AUTOSAVE_WRITER_QUEUE_LIMIT)
+			break;
+
+		Chunk* chunk = FindLoadedChunk(m_autosaveQueue.back());
+		m_autosaveQueue.pop_back();
+		popped = true;
+		if (!chunk || !chunk->m_blocksDirty)
+			continue; // unloaded, saved on the way out
+
+		SaveChunkToDisk(chunk);
+		double saveTime = GetCurrentTimeSeconds() - saveStart;
+		if (saveTime > m_autosaveBudgetSeconds)
+			m_autosaveOverBudgetCount++;
+		m_autosaveChunkSeconds = Max(saveTime, m_autosaveChunkSeconds * AUTOSAVE_ESTIMATE_DECAY);
+		m_autosavedChunkCount++;
+		saved++;
+		if (GetCurrentTimeSeconds() - start > m_autosaveBudgetSeconds)
+			break; // the estimate was off, the rest of the queue waits for the next frame
+	}
+
+	// chunks unloaded before their turn were saved already, once the queue is empty this ticket covers them all
+	if (popped)
+		m_autosaveTicket = m_chunkWriter.GetLastTicket();
+	m_autosavePeakSeconds = Max(m_autosavePeakSeconds, GetCurrentTimeSeconds() - start);
+}
+
+// BeginAutosaveRound: Queue every chunk with block edits, the journal of those edits is kept until they are on disk.
+// the file is synced and renamed on a worker, the round saves chunks meanwhile and ends once it has landed
+void ChunkProvider::BeginAutosaveRound(double now)
+{
+	m_nextAutosaveSeconds = m_autosaveIntervalSeconds > 0.0 ? now + m_autosaveIntervalSeconds : std::numeric_limits<double>::infinity();
+	for (auto& entry : m_chunksLoaded)
+		if (entry.second->m_blocksDirty)
+			m_autosaveQueue.push_back(entry.first);
+	if (m_autosaveQueue.empty())
+		return;
+
+	if (!m_journal.BeginRotate(m_recoveredEdits))
+	{
+		m_autosaveQueue.clear(); // tried again next interval, the journal keeps growing meanwhile
+		return;
+	}
+	g_theJobSystem->QueueJob(new ChunkJournalRotateJob(this));
+	m_autosaveRoundCount++;
+}
+
+void ChunkProvider::FinishUpJournalRotation()
+{
+	while (m_journal.IsRotating())
+	{
+		g_theJobSystem->FinishUpJobsOfType(JOB_TYPE_ROTATE_JOURNAL);
+		if (m_journal.IsRotating())
+			std::this_thread::yield(); // only waited for when every chunk is unloaded
+	}
 }
 
 ChunkLoadStatus ChunkProvider::LoadChunk(const ChunkCoords& coords)
@@ -483,18 +1101,11 @@ ChunkLoadStatus ChunkProvider::LoadChunk(const ChunkCoords& coords)
 	if (iteGen != m_chunksGenerating.end())
 		return ChunkLoadStatus::QUEUED;
 
+	// the file is read on a worker as well, a slow disk never stalls the frame
 	Chunk* chunk = new Chunk(m_world, coords);
-	if (!LoadChunkFromDisk(chunk))
-	{
-		chunk->m_state = ChunkState::QUEUED;
-		m_chunksGenerating[coords] = chunk; // insert into m_chunksLoaded
-		g_theJobSystem->QueueJob(new ChunkPopulateJob(this, chunk));
-		return ChunkLoadStatus::LOADED;
-	}
-	else
-	{
-		FinishUpChunkLoading(chunk);
-	}
+	chunk->m_state = ChunkState::QUEUED;
+	m_chunksGenerating[coords] = chunk; // insert into m_chunksLoaded
+	g_theJobSystem->QueueJob(new ChunkPopulateJob(this, chunk));
 	return ChunkLoadStatus::LOADED;
 }
 
@@ -508,65 +1119,298 @@ void ChunkProvider::UnloadChunk(const ChunkCoords& coords)
 	for (BlockFace face : CHUNK_NEIGHBORS)
 		if (chunk->m_neighbors[(int)face])
 			chunk->m_neighbors[(int)face]->OnNeighborUnload(*ite->second);
+	SaveChunkToDisk(chunk); // before pending light is dropped, so unsettled light is not written
+	UndirtyAllBlocksInChunk(coords);
 	m_chunksLoaded.erase(ite);
-	SaveChunkToDisk(chunk);
+	OnChunkDeactivated(chunk);
 	delete chunk;
 }
 
+void ChunkProvider::OnChunkActivated(Chunk* chunk)
+{
+	chunk->MarkMeshDirty();
+
+	if (IsChunkInRange(chunk->m_chunkCoords, RANDOM_TICK_CHUNKS_RADIUS))
+		m_chunksTicking.insert(chunk);
+
+	int chunkDeactivationRange = m_chunkActivationRange + CHUNK_SIZE_XY + CHUNK_SIZE_XY;
+	int unloadChunksRadius = 1 + chunkDeactivationRange / CHUNK_SIZE_XY;
+	if (!IsChunkInRange(chunk->m_chunkCoords, unloadChunksRadius))
+	{
+		// loaded after its hotspot moved away, keep the unload queue sorted
+		int distSq = GetHotspotDistanceSquared(chunk->m_chunkCoords);
+		auto pos = std::lower_bound(m_chunksUnloading.begin(), m_chunksUnloading.end(), distSq, [this](const ChunkCoords& coords, int value) {
+			return GetHotspotDistanceSquared(coords) < value;
+		});
+		m_chunksUnloading.insert(pos, chunk->m_chunkCoords);
+	}
+}
+
+void ChunkProvider::OnChunkDeactivated(Chunk* chunk)
+{
+	DequeueMeshRebuild(chunk);
+	m_chunksPendingNeighbors.erase(chunk);
+	m_chunksTicking.erase(chunk);
+}
+
+bool ChunkProvider::IsChunkInRange(const ChunkCoords& coords, int radius) const
+{
+	for (const auto& hotspot : m_hotspots)
+		if ((coords - hotspot).GetLengthSquared() < radius * radius)
+			return true;
+	return false;
+}
+
+int ChunkProvider::GetHotspotDistanceSquared(const ChunkCoords& coords) const
+{
+	int lenSq = 0;
+	for (const auto& hotspot : m_hotspots)
+		lenSq += (coords - hotspot).GetLengthSquared();
+	return lenSq;
+}
+
+void ChunkProvider::RebuildTickingChunks()
+{
+	m_chunksTicking.clear();
+
+	for (const auto& hotspot : m_hotspots)
+		for (int y = -RANDOM_TICK_CHUNKS_RADIUS; y <= RANDOM_TICK_CHUNKS_RADIUS; y++)
+			for (int x = -RANDOM_TICK_CHUNKS_RADIUS; x <= RANDOM_TICK_CHUNKS_RADIUS; x++)
+			{
+				if (x * x + y * y >= RANDOM_TICK_CHUNKS_RADIUS * RANDOM_TICK_CHUNKS_RADIUS)
+					continue;
+				Chunk* chunk = FindLoadedChunk(hotspot + IntVec2(x, y));
+				if (chunk)
+					m_chunksTicking.insert(chunk);
+			}
+}
+
+void ChunkProvider::RebuildUnloadQueue()
+{
+	// only runs when a hotspot changes chunk, per frame deactivation just pops the farthest entry
+	int chunkDeactivationRange = m_chunkActivationRange + CHUNK_SIZE_XY + CHUNK_SIZE_XY;
+	int unloadChunksRadius = 1 + chunkDeactivationRange / CHUNK_SIZE_XY;
+
+	m_chunksUnloading.clear();
+	for (const auto& entry : m_chunksLoaded)
+		if (!IsChunkInRange(entry.first, unloadChunksRadius))
+			m_chunksUnloading.push_back(entry.first);
+
+	std::sort(m_chunksUnloading.begin(), m_chunksUnloading.end(), [this](const ChunkCoords& a, const ChunkCoords& b) {
+		return GetHotspotDistanceSquared(a) < GetHotspotDistanceSquared(b);
+	});
+}
+
 // ============ IO ================ //
 
 constexpr const char*   CHUNK_FILE_HEADER = "GCHK";
 constexpr unsigned char CHUNK_FILE_HEADER_SIZE = 4;
-constexpr unsigned char CHUNK_FILE_VERSION = 2;
+constexpr unsigned char CHUNK_FILE_VERSION = 5;             // adds block codecs, the encoding byte names the codec of blocks and light
+constexpr unsigned char CHUNK_FILE_VERSION_DELTA = 4;       // adds block encoding, delta against generator output
+constexpr unsigned char CHUNK_FILE_VERSION_LIGHT = 3;       // adds edit stamps and an optional light section
+constexpr unsigned char CHUNK_FILE_VERSION_BLOCKS_ONLY = 2; // still readable, light is computed on load
+constexpr unsigned char CHUNK_BLOCKS_RLE = CHUNK_CODEC_RLE;
+constexpr unsigned char CHUNK_BLOCKS_DELTA = 1;
+constexpr size_t        CHUNK_DELTA_MAX_EDITS = 2048;       // 6KB of edits, past that the full stream is usually smaller
 constexpr unsigned char CHUNK_FILE_BITS_X = (unsigned char)CHUNK_SIZE_BITWIDTH_XY;
 constexpr unsigned char CHUNK_FILE_BITS_Y = (unsigned char)CHUNK_SIZE_BITWIDTH_XY;
 constexpr unsigned char CHUNK_FILE_BITS_Z = (unsigned char)CHUNK_SIZE_BITWIDTH_Z;
 
 
-bool ChunkProvider::LoadChunkFromDisk(Chunk* chunk) const
+// fixed start of every chunk file, checked where it lies in the mapped region
+#pragma pack(push, 1)
+struct ChunkFileHeader
+{
+	char          m_magic[CHUNK_FILE_HEADER_SIZE];
+	unsigned char m_version;
+	unsigned int  m_worldSeed;
+	unsigned char m_bitsX;
+	unsigned char m_bitsY;
+	unsigned char m_bitsZ;
+};
+#pragma pack(pop)
+static_assert(sizeof(ChunkFileHeader) == 12, "the header is read in place, it must match the bytes SaveChunkToDisk writes");
+
+// reads over chunk file bytes without copying them out first, a read past the end fails
+struct ChunkFileCursor
+{
+	const unsigned char* m_data;
+	const unsigned char* m_end;
+
+	size_t GetRemaining() const { return (size_t)(m_end - m_data); }
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		if (GetRemaining() < sizeof(T))
+			return false;
+		memcpy(&value, m_data, sizeof(T));
+		m_data += sizeof(T);
+		return true;
+	}
+};
+
+ChunkFileResult ChunkProvider::LoadChunkFromDisk(Chunk* chunk) const
 {
 	if (m_disableLoadFromDisk)
-		return false; // Disabled load from disk.
+		return ChunkFileResult::MISSING; // Disabled load from disk.
+
+	// a snapshot still waiting for the writer is newer than the region
+	std::vector<unsigned char> readBuffer;
+	PendingWrite pendingWrite = m_chunkWriter.FindPending(chunk->m_chunkCoords, readBuffer);
+	if (pendingWrite == PendingWrite::DELETE)
+		return ChunkFileResult::MISSING;
+	if (pendingWrite == PendingWrite::DATA)
+		return DecodeChunk(chunk, readBuffer.data(), readBuffer.size());
+
+	// a mapped region is decoded where it lies, other reads land in the one buffer
+	std::shared_ptr<const MappedFile> mapping;
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	if (!ReadChunkBytes(chunk->m_chunkCoords, readBuffer, mapping, data, size))
+		return ChunkFileResult::MISSING; // Read chunk failed.
+	return DecodeChunk(chunk, data, size);
+}
 
-	ByteBuffer buffer;
-	int len = FileReadToBuffer(buffer, GetFileName(chunk->m_chunkCoords));
-	if (len == -1)
-		return false; // Read file failed.
-
-	unsigned char chunk_FILE_HEADER[CHUNK_FILE_HEADER_SIZE];
-	unsigned char chunk_FILE_VERSION;
-	unsigned int  worldSeed;
-	unsigned char chunk_FILE_BITS_X;
-	unsigned char chunk_FILE_BITS_Y;
-	unsigned char chunk_FILE_BITS_Z;
-
-	buffer.Read(CHUNK_FILE_HEADER_SIZE, &chunk_FILE_HEADER[0]);
-	buffer.Read(chunk_FILE_VERSION);
-	buffer.Read(worldSeed);
-	buffer.Read(chunk_FILE_BITS_X);
-	buffer.Read(chunk_FILE_BITS_Y);
-	buffer.Read(chunk_FILE_BITS_Z);
-
-	for (size_t i = 0; i < CHUNK_FILE_HEADER_SIZE; i++)
-		if (chunk_FILE_HEADER[i] != CHUNK_FILE_HEADER[i])
-			return false; // Corrupt chunk file.
-	if (chunk_FILE_VERSION != CHUNK_FILE_VERSION)
-		return false; // Incompatible chunk file version.
-	if (worldSeed != m_worldSeed)
-		return false; // Incompatible world seed.
-	if (chunk_FILE_BITS_X != CHUNK_FILE_BITS_X || chunk_FILE_BITS_Y != CHUNK_FILE_BITS_Y || chunk_FILE_BITS_Z != CHUNK_FILE_BITS_Z)
-		return false; // Incompatible chunk array bit length.
-
-	chunk->ReadBytes(&buffer);
-	return true;
+ChunkFileResult ChunkProvider::DecodeChunk(Chunk* chunk, const unsigned char* data, size_t size) const
+{
+	if (size < sizeof(ChunkFileHeader))
+		return ChunkFileResult::MISSING; // Truncated chunk file.
+
+	const ChunkFileHeader* header = (const ChunkFileHeader*)data;
+	if (memcmp(header->m_magic, CHUNK_FILE_HEADER, CHUNK_FILE_HEADER_SIZE) != 0)
+		return ChunkFileResult::MISSING; // Corrupt chunk file.
+	if (header->m_version != CHUNK_FILE_VERSION && header->m_version != CHUNK_FILE_VERSION_DELTA && header->m_version != CHUNK_FILE_VERSION_LIGHT && header->m_version != CHUNK_FILE_VERSION_BLOCKS_ONLY)
+		return ChunkFileResult::MISSING; // Incompatible chunk file version.
+	if (header->m_worldSeed != m_worldSeed)
+		return ChunkFileResult::MISSING; // Incompatible world seed.
+	if (header->m_bitsX != CHUNK_FILE_BITS_X || header->m_bitsY != CHUNK_FILE_BITS_Y || header->m_bitsZ != CHUNK_FILE_BITS_Z)
+		return ChunkFileResult::MISSING; // Incompatible chunk array bit length.
+
+	ChunkFileCursor cursor = { data + sizeof(ChunkFileHeader), data + size };
+	unsigned char blockEncoding = CHUNK_BLOCKS_RLE;
+	if (header->m_version >= CHUNK_FILE_VERSION_DELTA && !cursor.Read(blockEncoding))
+		return ChunkFileResult::MISSING; // Truncated chunk file.
+
+	// stamps are kept aside until the whole file proved readable
+	unsigned int editStamp = 0;
+	unsigned int neighborStamps[4] = { CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN, CHUNK_STAMP_UNKNOWN };
+	unsigned char hasLight = 0;
+	auto readStamps = [&]() {
+		bool read = cursor.Read(editStamp);
+		for (unsigned int& stamp : neighborStamps)
+			read = read && cursor.Read(stamp);
+		return read && cursor.Read(hasLight);
+	};
+
+	if (blockEncoding == CHUNK_BLOCKS_DELTA)
+	{
+		// edits hold the block they set, so after a generator change they still land where the player made them,
+		// over the new terrain. the chunk is written again under the new version once it is populated
+		unsigned int generatorHash;
+		unsigned int editCount;
+		if (!cursor.Read(generatorHash) || !cursor.Read(editCount) || editCount > cursor.GetRemaining() / 3)
+			return ChunkFileResult::MISSING; // Truncated chunk file.
+		chunk->m_generatorChanged = generatorHash != m_generator->GetVersionHash();
+		chunk->m_pendingEdits.resize(editCount);
+		for (BlockEdit& edit : chunk->m_pendingEdits)
+		{
+			cursor.Read(edit.m_blockIndex);
+			cursor.Read(edit.m_blockId);
+			if (edit.m_blockIndex >= CHUNK_SIZE_BLOCKS)
+				editCount = 0;
+		}
+		if (editCount == 0 && !chunk->m_pendingEdits.empty())
+		{
+			chunk->m_pendingEdits.clear();
+			return ChunkFileResult::MISSING; // Corrupt edit list.
+		}
+
+		// light is computed with the blocks in the populate job
+		if (readStamps())
+			chunk->m_editStamp = editStamp;
+		for (unsigned int& stamp : chunk->m_neighborStamps)
+			stamp = CHUNK_STAMP_UNKNOWN;
+		chunk->m_loadedFromDisk = true;
+		return ChunkFileResult::DELTA;
+	}
+
+	// run length streams decode straight into the blocks, other codecs through a plane checked whole first
+	const ChunkCodec* codec = ChunkCodec::Find(blockEncoding);
+	if (!codec || (blockEncoding != CHUNK_BLOCKS_RLE && header->m_version < CHUNK_FILE_VERSION))
+		return ChunkFileResult::MISSING; // Unknown block encoding.
+	unsigned char plane[CHUNK_SIZE_BLOCKS];
+	if (blockEncoding == CHUNK_BLOCKS_RLE)
+	{
+		if (!chunk->ReadBytes(cursor.m_data, cursor.m_end))
+			return ChunkFileResult::MISSING; // Corrupt block stream.
+	}
+	else
+	{
+		if (!codec->Decode(cursor.m_data, cursor.m_end, plane))
+			return ChunkFileResult::MISSING; // Corrupt block stream.
+		chunk->SetBlockIds(plane);
+	}
+	if (header->m_version >= CHUNK_FILE_VERSION_LIGHT && !readStamps())
+		return ChunkFileResult::MISSING; // Truncated chunk file.
+
+	// stored light is final unless a neighbor changed meanwhile, checked by stamp when it links
+	bool lightRead = false;
+	if (hasLight && blockEncoding == CHUNK_BLOCKS_RLE)
+	{
+		lightRead = chunk->ReadLightBytes(cursor.m_data, cursor.m_end);
+	}
+	else if (hasLight && codec->Decode(cursor.m_data, cursor.m_end, plane))
+	{
+		chunk->SetLightBytes(plane);
+		lightRead = true;
+	}
+	chunk->RebuildHeightMap();
+	chunk->m_loadedFromDisk = true;
+	chunk->m_editStamp = editStamp;
+	if (lightRead)
+	{
+		for (int face = 0; face < 4; face++)
+			chunk->m_neighborStamps[face] = neighborStamps[face];
+	}
+	else
+	{
+		for (unsigned int& stamp : chunk->m_neighborStamps)
+			stamp = CHUNK_STAMP_UNKNOWN;
+		chunk->PopulateLocalLight();
+		chunk->m_lightDirty = true; // write it back with light next time
+	}
+	return ChunkFileResult::LOADED;
 }
 
-bool ChunkProvider::SaveChunkToDisk(const Chunk* chunk) const
+bool ChunkProvider::SaveChunkToDisk(Chunk* chunk)
 {
-	if (!chunk->m_blocksDirty)
+	if (!chunk->m_blocksDirty && !chunk->m_lightDirty)
 		return true;
+	if (m_disableSaveToDisk)
+		return true; // Disabled save to disk.
+
+	// chunks still matching the generator need no file at all, a few edits are stored as a diff
+	std::vector<BlockEdit> edits;
+	bool delta = m_deltaSaveEnabled && chunk->m_hasGeneratedBase;
+	if (delta)
+	{
+		chunk->CollectEdits(edits);
+		if (edits.empty())
+		{
+			if (chunk->m_loadedFromDisk || chunk->m_savedToDisk)
+				DeleteChunkFile(chunk->m_chunkCoords);
+			chunk->m_blocksDirty = false;
+			chunk->m_lightDirty = false;
+			chunk->m_savedToDisk = false;
+			return true;
+		}
+		delta = edits.size() <= CHUNK_DELTA_MAX_EDITS;
+	}
 
 	ByteBuffer buffer;
+	unsigned char plane[CHUNK_SIZE_BLOCKS]; // blocks then light for codecs other than the run length stream
+	std::vector<unsigned char> encoded;
 
 	// write info
 	buffer.Write(CHUNK_FILE_HEADER_SIZE, &CHUNK_FILE_HEADER[0]);
@@ -575,15 +1419,161 @@ bool ChunkProvider::SaveChunkToDisk(const Chunk* chunk) const
 	buffer.Write(CHUNK_FILE_BITS_X);
 	buffer.Write(CHUNK_FILE_BITS_Y);
 	buffer.Write(CHUNK_FILE_BITS_Z);
-	
-	chunk->WriteBytes(&buffer);
-	int len = FileWriteFromBuffer(buffer, GetFileName(chunk->m_chunkCoords));
-	return len != -1;
+
+	if (delta)
+	{
+		buffer.Write(CHUNK_BLOCKS_DELTA);
+		buffer.Write(m_generator->GetVersionHash());
+		buffer.Write((unsigned int)edits.size());
+		for (const BlockEdit& edit : edits)
+		{
+			buffer.Write(edit.m_blockIndex);
+			buffer.Write(edit.m_blockId);
+		}
+	}
+	else if (m_codec->GetId() == CHUNK_BLOCKS_RLE)
+	{
+		buffer.Write(CHUNK_BLOCKS_RLE);
+		chunk->WriteBytes(&buffer);
+	}
+	else
+	{
+		chunk->GetBlockIds(plane);
+		encoded.clear();
+		m_codec->Encode(plane, encoded);
+		buffer.Write(m_codec->GetId());
+		buffer.Write(encoded.size(), encoded.data());
+	}
+
+	buffer.Write(chunk->m_editStamp);
+	for (int face = 0; face < 4; face++)
+		buffer.Write(chunk->m_neighbors[face] ? chunk->m_neighbors[face]->m_editStamp : chunk->m_neighborStamps[face]);
+
+	// light still propagating is not worth keeping, the loader computes it again.
+	// delta chunks are regenerated on load and light up in the same job
+	unsigned char hasLight = (delta || chunk->HasPendingLight()) ? 0 : 1;
+	for (const Chunk* neighbor : chunk->m_neighbors)
+		if (neighbor && neighbor->HasPendingLight())
+			hasLight = 0;
+	buffer.Write(hasLight);
+	if (hasLight && m_codec->GetId() == CHUNK_BLOCKS_RLE)
+	{
+		chunk->WriteLightBytes(&buffer);
+	}
+	else if (hasLight)
+	{
+		chunk->GetLightBytes(plane);
+		encoded.clear();
+		m_codec->Encode(plane, encoded);
+		buffer.Write(encoded.size(), encoded.data());
+	}
+
+	const unsigned char* bytes = (const unsigned char*)buffer.GetData();
+	m_chunkWriter.Write(chunk->m_chunkCoords, std::vector<unsigned char>(bytes, bytes + buffer.GetSize()));
+	m_savedChunkCount++;
+	m_savedBytes += buffer.GetSize();
+
+	// unsettled light was left out, it is written again once the chunk saves next
+	chunk->m_blocksDirty = false;
+	chunk->m_lightDirty = !delta && !hasLight;
+	chunk->m_savedToDisk = true;
+	return true;
+}
+
+void ChunkProvider::JournalBlockEdit(const Chunk* chunk, int blockIndex, BlockId blockId)
+{
+	if (!m_disableSaveToDisk)
+		m_journal.Append(chunk->m_chunkCoords, (unsigned short)blockIndex, blockId);
+}
+
+size_t ChunkProvider::GetRecoveredEditCount() const
+{
+	size_t count = 0;
+	for (const auto& entry : m_recoveredEdits)
+		count += entry.second.size();
+	return count;
+}
+
+// RecoverJournal: Edits a crashed session made after its last save, kept in one new journal until their chunks load
+void ChunkProvider::RecoverJournal()
+{
+	m_journal.SetWorldSeed(m_worldSeed);
+	bool hadPrevious = m_journal.HasPrevious();
+	size_t records = m_journal.Recover(m_recoveredEdits);
+	if (records == 0 && !hadPrevious)
+		return;
+
+	m_journal.Restart(m_recoveredEdits);
+	g_theConsole->AddLine(DevConsole::LOG_WARN, Stringf("The last session did not shut down cleanly, recovered %d block edits of %d chunks from the edit journal",
+		(int)records, (int)m_recoveredEdits.size()));
+}
+
+// ApplyRecoveredEdits: Replays journal edits over the chunk as it was last saved, they are journaled again until it saves
+void ChunkProvider::ApplyRecoveredEdits(Chunk* chunk)
+{
+	if (m_disableLoadFromDisk)
+		return; // the chunk did not come from disk, the edits wait for one that does
+
+	auto ite = m_recoveredEdits.find(chunk->m_chunkCoords);
+	if (ite == m_recoveredEdits.end())
+		return;
+
+	std::vector<BlockEdit> edits = std::move(ite->second);
+	m_recoveredEdits.erase(ite);
+	for (const BlockEdit& edit : edits)
+		chunk->SetBlockId(Chunk::GetLocalCoords(edit.m_blockIndex), edit.m_blockId);
+}
+
+void ChunkProvider::DeleteChunkFile(const ChunkCoords& coords) const
+{
+	m_chunkWriter.Delete(coords); // after any save still queued
+}
+
+bool ChunkProvider::HasChunkFile(const ChunkCoords& coords) const
+{
+	std::vector<unsigned char> pending;
+	PendingWrite pendingWrite = m_chunkWriter.FindPending(coords, pending);
+	if (pendingWrite != PendingWrite::NONE)
+		return pendingWrite == PendingWrite::DATA;
+
+	std::shared_ptr<RegionFile> region = m_regions.Get(RegionFile::GetRegionCoords(coords), false);
+	if (region && region->HasChunk(RegionFile::GetChunkIndex(coords)))
+		return true;
+
+	std::error_code error;
+	return m_regions.HasLooseChunkFiles() && std::filesystem::exists(std::filesystem::path(m_regions.GetChunkFilePath(coords)), error);
+}
+
+bool ChunkProvider::ReadChunkBytes(const ChunkCoords& coords, std::vector<unsigned char>& readBuffer, std::shared_ptr<const MappedFile>& mapping, const unsigned char*& data, size_t& size) const
+{
+	int chunkIndex = RegionFile::GetChunkIndex(coords);
+	std::shared_ptr<RegionFile> region = m_regions.Get(RegionFile::GetRegionCoords(coords), false);
+	if (region && region->HasChunk(chunkIndex))
+	{
+		// a payload failing its checksum is not replaced by an older loose file
+		if (m_mappedReads && !m_fileReader)
+			return region->ReadMapped(chunkIndex, mapping, data, size);
+		if (!(m_fileReader ? m_fileReader(*region, chunkIndex, readBuffer) : region->Read(chunkIndex, readBuffer)))
+			return false;
+	}
+	else
+	{
+		// loose file of an older save, it moves into the region when the chunk is saved or the folder compacted
+		ByteBuffer buffer;
+		if (!m_regions.HasLooseChunkFiles() || FileReadToBuffer(buffer, m_regions.GetChunkFilePath(coords)) == -1)
+			return false;
+		const unsigned char* bytes = (const unsigned char*)buffer.GetData();
+		readBuffer.assign(bytes, bytes + buffer.GetSize());
+	}
+	data = readBuffer.data();
+	size = readBuffer.size();
+	return true;
 }
 
 void ChunkProvider::FinishUpChunkLoading(Chunk* chunk)
 {
 	m_chunksLoaded[chunk->m_chunkCoords] = chunk;
+	chunk->m_state = ChunkState::LOADED;
 
 	for (BlockFace face : CHUNK_NEIGHBORS)
 	{
@@ -595,7 +1585,118 @@ void ChunkProvider::FinishUpChunkLoading(Chunk* chunk)
 		}
 	}
 
-	chunk->m_state = ChunkState::LOADED;
+	OnChunkActivated(chunk);
+	ApplyQueuedFeatures(chunk);
+	ApplyRecoveredEdits(chunk);
+
+	if (chunk->m_generatorChanged && m_generatorChangedChunkCount++ == 0)
+		g_theConsole->AddLine(DevConsole::LOG_WARN, Stringf("Chunk (%d, %d) was saved by another generator version, its edits are applied over the new terrain",
+			chunk->m_chunkCoords.x, chunk->m_chunkCoords.y));
+}
+
+// ApplyQueuedFeatures: Blocks of features rooted in neighbor chunks, as edits into air only so they are journaled and
+// saved like any other. sorted first, of two blocks queued for the same air the order they were pushed in does not pick
+void ChunkProvider::ApplyQueuedFeatures(Chunk* chunk)
+{
+	std::vector<BlockEdit> blocks;
+	if (!m_featureQueue.Take(chunk->m_chunkCoords, blocks))
+		return;
+
+	std::sort(blocks.begin(), blocks.end(), [](const BlockEdit& a, const BlockEdit& b) {
+		return a.m_blockIndex != b.m_blockIndex ? a.m_blockIndex < b.m_blockIndex : a.m_blockId < b.m_blockId;
+	});
+	for (const BlockEdit& edit : blocks)
+	{
+		LocalCoords coords = Chunk::GetLocalCoords(edit.m_blockIndex);
+		if (chunk->GetBlockId(coords) == Blocks::BLOCK_AIR)
+			chunk->SetBlockId(coords, edit.m_blockId);
+	}
+}
+
+void ChunkProvider::ApplyNewQueuedFeatures()
+{
+	std::vector<ChunkCoords> targets;
+	m_featureQueue.TakeNewTargets(targets);
+	for (const ChunkCoords& coords : targets)
+	{
+		Chunk* chunk = FindLoadedChunk(coords); // the rest wait in the queue until their chunk loads
+		if (chunk)
+			ApplyQueuedFeatures(chunk);
+	}
+}
+
+ChunkLightJob::ChunkLightJob(ChunkProvider* provider, Chunk* chunk, int maxBlocks) : Job(JOB_TYPE_LIGHT_CHUNK)
+	, m_chunk(chunk)
+	, m_chunkProvider(provider)
+	, m_maxBlocks(maxBlocks)
+{
+}
+
+void ChunkLightJob::Execute()
+{
+	ChunkLightQueue& queue = m_chunk->m_lightQueue;
+	int processed = 0;
+	while (!queue.IsEmpty() && processed < m_maxBlocks)
+	{
+		BlockIterator ite(m_chunk, queue.Pop());
+		processed++;
+
+		BlockIterator iteNbrs[BlockFace::BLOCK_FACE_SIZE] = {};
+		Block*        nbrs[BlockFace::BLOCK_FACE_SIZE]    = {};
+		if (!ChunkProvider::RelaxBlockLight(ite, iteNbrs, nbrs))
+			continue;
+
+		m_chunk->OnLightChanged(ite.GetBlockIndex());
+		m_meshDirtyChunks.insert(m_chunk);
+		for (BlockFace face : BLOCK_NEIGHBORS)
+		{
+			const BlockIterator& iteNbr = iteNbrs[face];
+			Block* nbr = nbrs[face];
+			if (!nbr->IsValid())
+				continue;
+
+			if (nbr->IsOpaque())
+				m_meshDirtyChunks.insert(iteNbr.GetChunk());
+			else if (iteNbr.GetChunk() != m_chunk)
+				m_borderBlocks.push_back(iteNbr); // owned by another region, merge on main thread
+			else
+				queue.Push(iteNbr.GetBlockIndex());
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_chunkProvider->m_lightJobsMutex);
+	m_chunkProvider->m_lightJobsMostProcessed = std::max(m_chunkProvider->m_lightJobsMostProcessed, processed);
+	m_chunkProvider->m_lightJobsExecuted++;
+	m_chunkProvider->m_lightJobsDone.notify_one();
+}
+
+void ChunkLightJob::OnFinished()
+{
+	// leftovers simply stay in the chunk queue
+	for (auto& blockIte : m_borderBlocks)
+		m_chunkProvider->MarkLightingDirty(blockIte);
+	for (Chunk* chunk : m_meshDirtyChunks)
+		chunk->MarkMeshDirty();
+
+	m_chunkProvider->m_lightJobsRunning--;
+}
+
+ChunkJournalRotateJob::ChunkJournalRotateJob(ChunkProvider* provider) : Job(JOB_TYPE_ROTATE_JOURNAL)
+	, m_chunkProvider(provider)
+{
+}
+
+void ChunkJournalRotateJob::Execute()
+{
+	m_rotated = m_chunkProvider->m_journal.FinishRotate();
+	m_chunkProvider->m_featureQueue.Rewrite(); // blocks taken so far are edits of chunks in this round or saved before
+}
+
+void ChunkJournalRotateJob::OnFinished()
+{
+	m_chunkProvider->m_journal.EndRotate(m_rotated);
+	if (!m_rotated)
+		g_theConsole->AddLine(DevConsole::LOG_WARN, "The edit journal could not be rotated, its edits are kept for the next autosave round");
 }
 
 ChunkPopulateJob::ChunkPopulateJob(ChunkProvider* provider, Chunk* chunk) : Job(JOB_TYPE_GEN_CHUNK)
@@ -607,7 +1708,8 @@ ChunkPopulateJob::ChunkPopulateJob(ChunkProvider* provider, Chunk* chunk) : Job(
 void ChunkPopulateJob::Execute()
 {
 	m_chunk->m_state = ChunkState::GENERATING;
-	m_chunkProvider->PopulateChunk(m_chunk);
+	if (m_chunkProvider->LoadChunkFromDisk(m_chunk) != ChunkFileResult::LOADED)
+		m_chunkProvider->PopulateChunk(m_chunk); // delta files only filled in the pending edits
 	m_chunk->m_state = ChunkState::GENERATED;
 }
 
@@ -1,15 +1,34 @@
 #include "Game/BlockIterator.hpp"
 #include "Game/Chunk.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/ChunkJournal.hpp"
+#include "Game/ChunkWriter.hpp"
+#include "Game/FeatureQueue.hpp"
+#include "Game/WorldGenerator.hpp"
 #include "Engine/Core/JobSystem.hpp"
 #include "Engine/Core/Stopwatch.hpp"
+#include "Engine/Math/Vec2.hpp"
 
+#include <condition_variable>
 #include <map>
-#include <deque>
+#include <mutex>
+#include <set>
 
 class World;
-class WorldGenerator;
+class ByteBuffer;
 
 constexpr int JOB_TYPE_GEN_CHUNK = 999;
+constexpr int JOB_TYPE_LIGHT_CHUNK = 1000;
+constexpr int JOB_TYPE_ROTATE_JOURNAL = 1001;
+
+typedef bool (*ChunkFileReadFunc)(RegionFile& region, int chunkIndex, std::vector<unsigned char>& data); // false when the chunk cannot be read
+
+enum LightPriority
+{
+	LIGHT_PRIORITY_NEAR,  // chunks close to a hotspot, drained first
+	LIGHT_PRIORITY_FAR,
+	LIGHT_PRIORITY_SIZE,
+};
 
 enum class ChunkLoadStatus
 {
@@ -19,8 +38,16 @@ enum class ChunkLoadStatus
 	FAILED,
 };
 
+enum class ChunkFileResult
+{
+	MISSING, // no usable file, generate the chunk
+	LOADED,  // blocks read in full
+	DELTA,   // edits read, applied over generator output in the populate job
+};
+
 class ChunkProvider;
 
+// reads the chunk file on a worker, generates the chunk when the file is missing or invalid
 class ChunkPopulateJob : public Job
 {
 public:
@@ -35,9 +62,43 @@ private:
 	ChunkProvider* const            m_chunkProvider;
 };
 
+class ChunkLightJob : public Job
+{
+public:
+	ChunkLightJob(ChunkProvider* provider, Chunk* chunk, int maxBlocks);
+
+private:
+	virtual void Execute() override;
+	virtual void OnFinished() override;
+
+private:
+	Chunk* const                    m_chunk;
+	ChunkProvider* const            m_chunkProvider;
+	std::vector<BlockIterator>      m_borderBlocks;    // dirty requests for blocks of neighbor chunks
+	std::set<Chunk*>                m_meshDirtyChunks;
+	int                             m_maxBlocks = 0;
+};
+
+// syncs and rotates the journal for an autosave round, then compacts the feature queue file
+class ChunkJournalRotateJob : public Job
+{
+public:
+	ChunkJournalRotateJob(ChunkProvider* provider);
+
+private:
+	virtual void Execute() override;
+	virtual void OnFinished() override;
+
+private:
+	ChunkProvider* const            m_chunkProvider;
+	bool                            m_rotated = false;
+};
+
 class ChunkProvider
 {
 	friend class ChunkPopulateJob;
+	friend class ChunkLightJob;
+	friend class ChunkJournalRotateJob;
 
 public:
 	ChunkProvider(World* world, const char* folderPath, WorldGenerator* generator);
@@ -53,6 +114,7 @@ public:
 	void UnloadChunk(const ChunkCoords& coords);
 	Chunk* FindLoadedChunk(const ChunkCoords& coords) const;
 	void UnloadAllChunks();
+	void FinishUpChunkGeneration();
 
 	// block access
 	const Block& GetBlock(const WorldCoords& worldCoords) const;
@@ -64,21 +126,61 @@ public:
 	void ProcessNextDirtyLightBlock();
 	void MarkLightingDirty(const BlockIterator& blockIte);
 	void MarkLightingDirty(const WorldCoords& worldCoords);
+	void InvalidateLighting(const BlockIterator& blockIte);
+	void SetLightRemovalEnabled(bool enabled) { m_lightRemovalEnabled = enabled; }
+	size_t GetLightingUpdateCount() const { return m_lightingUpdateCount; }
 	void UndirtyAllBlocksInChunk(const ChunkCoords& chunkCoords);
+	void ProcessAllDirtyLighting(bool parallel);
+	void RelightAllChunks(bool parallel);
+	bool HasDirtyLighting() const;
+	size_t GetDirtyLightingCount() const;
+	bool IsLightingResolved(const Chunk* chunk) const;
+	static bool RelaxBlockLight(const BlockIterator& blockIte, BlockIterator* iteNbrs, Block** nbrs);
+
+	// active chunk lists
+	void EnqueueMeshRebuild(Chunk* chunk);
 
 	// utils
 	int  GetChunkActiveRange() const { return m_chunkActivationRange; }
+	void SetDiskIOEnabled(bool enabled);
+	void SetDeltaSaveEnabled(bool enabled) { m_deltaSaveEnabled = enabled; } // chunks generated before save in full
+	void SetFileReader(ChunkFileReadFunc reader) { m_fileReader = reader; } // nullptr reads regions directly, called from job workers
+	void SetMappedReads(bool enabled) { m_mappedReads = enabled; }
+	void SetCodec(const ChunkCodec* codec) { m_codec = codec; } // of full chunk saves, every codec stays readable
+	void SetAutosave(double intervalSeconds, double budgetSeconds, int batchChunks); // an interval of 0 saves only on request
+	void RequestAutosave(); // a round starts next frame, once the last one is on disk
+	bool IsAutosaveRunning() const { return !m_autosaveQueue.empty() || m_journal.HasPrevious() || m_journal.IsRotating(); }
+	size_t GetAutosaveRoundCount() const { return m_autosaveRoundCount; }
+	size_t GetAutosavedChunkCount() const { return m_autosavedChunkCount; }
+	size_t GetAutosaveOverBudgetCount() const { return m_autosaveOverBudgetCount; } // single chunk saves that took more than the frame budget
+	double GetAutosavePeakSeconds() const { return m_autosavePeakSeconds; } // most one frame spent on autosave
+	void ResetAutosavePeak() { m_autosavePeakSeconds = 0.0; }
+	ChunkJournal& GetJournal() { return m_journal; }
+	size_t GetRecoveredEditCount() const; // journal edits of a crashed session still waiting for their chunk
+	void JournalBlockEdit(const Chunk* chunk, int blockIndex, BlockId blockId);
+	const ChunkCodec* GetCodec() const { return m_codec; }
+	void DeleteChunkFile(const ChunkCoords& coords) const;
+	bool HasChunkFile(const ChunkCoords& coords) const;
+	size_t GetSavedChunkCount() const { return m_savedChunkCount; }
+	size_t GetSavedBytes() const { return m_savedBytes; }
+	FeatureQueue& GetFeatureQueue() { return m_featureQueue; }
+	const FeatureQueue& GetFeatureQueue() const { return m_featureQueue; }
+	ChunkWriter& GetChunkWriter() { return m_chunkWriter; }
+	const ChunkWriter& GetChunkWriter() const { return m_chunkWriter; }
+	RegionCache& GetRegions() { return m_regions; }
+	WorldGenerator* GetGenerator() const { return m_generator; }
+	ChunkFileResult LoadChunkFromDisk(Chunk* chunk) const; // called from job workers
 	bool GetChunkIOTicket();
 	bool GetRebuildMeshTicket();
 	void SetHotspotSize(int size);
-	void SetHotspot(int index, const Vec3& worldPos);
+	void SetHotspot(int index, const Vec3& worldPos, const Vec3& forward = Vec3::ZERO); // chunks ahead of forward load first
+	const std::vector<ChunkCoords>& GetLoadQueue() const { return m_chunksLoading; } // the back loads first
+	size_t GetLoadQueueRebuildCount() const { return m_loadQueueRebuildCount; }
 
 	// tick
 	void BeginFrame();
 	void EndFrame();
-
-	// file utils
-	std::string GetFileName(const ChunkCoords& coords) const;
+	void UpdateAutosave(); // dirty chunks of the running round, within the frame budget
 
 
 private:
@@ -87,26 +189,97 @@ private:
 	void DoChunkDeactivation();
 	void DoChunkActivation();
 
-	bool LoadChunkFromDisk(Chunk* chunk) const;
+	void ProcessMeshRebuilds();
+	void RebuildTickingChunks();
+	void RebuildUnloadQueue();
+	void OnChunkActivated(Chunk* chunk);
+	void OnChunkDeactivated(Chunk* chunk);
+	bool IsChunkInRange(const ChunkCoords& coords, int radius) const;
+	void ProcessDirtyLightBlock(const BlockIterator& blockIte);
+	void QueueLightRemoval(Chunk* chunk, const LightRemoval& removal);
+	void ProcessNextLightRemoval();
+	void RemoveSettledLightChunks();
+	void ProcessDirtyLightingParallel(double deadline);
+	int  GetLightJobBlockLimit(double deadline, int phasesLeft) const;
+	void UpdateLightJobRate(double phaseSeconds);
+	void RebucketDirtyLighting();
+	void WaitForLightJobs(int jobCount);
+	void RebucketMeshRebuilds();
+	void DequeueMeshRebuild(Chunk* chunk);
+	int  GetHotspotDistanceSquared(const ChunkCoords& coords) const;
+	void BuildLoadOffsets();
+	void RebuildLoadQueue();
+
+	ChunkFileResult DecodeChunk(Chunk* chunk, const unsigned char* data, size_t size) const; // data is not copied, it may be a mapped region
+	bool ReadChunkBytes(const ChunkCoords& coords, std::vector<unsigned char>& readBuffer, std::shared_ptr<const MappedFile>& mapping, const unsigned char*& data, size_t& size) const;
 	void PopulateChunk(Chunk* chunk);
-	bool SaveChunkToDisk(const Chunk* chunk) const;
+	bool SaveChunkToDisk(Chunk* chunk); // clears the dirty flags of what reached the file
+	void BeginAutosaveRound(double now);
+	void FinishUpJournalRotation();
+	void RecoverJournal();
+	void ApplyRecoveredEdits(Chunk* chunk);
 
 	void FinishUpChunkLoading(Chunk* chunk);
+	void ApplyQueuedFeatures(Chunk* chunk);
+	void ApplyNewQueuedFeatures();
 
 private:
 	World* m_world = nullptr;
 	std::string m_path;
 	bool m_disableLoadFromDisk = false;
+	bool m_disableSaveToDisk = false;
+	bool m_deltaSaveEnabled = false; // chunks matching the generator store only their edits, kept over new terrain when the generator changes
+	size_t m_generatorChangedChunkCount = 0; // delta chunks loaded over another generator version, the first one is logged
+	bool m_mappedReads = true; // region reads go through a mapping of the file rather than buffered reads
+	const ChunkCodec* m_codec = nullptr; // blocks and light of full chunk saves
+	ChunkFileReadFunc m_fileReader = nullptr;
+	mutable RegionCache m_regions;     // chunks are stored 32x32 to a region file
+	mutable ChunkWriter m_chunkWriter; // saves and deletes land on disk in the background, reads check it first
+	size_t m_savedChunkCount = 0;
+	size_t m_savedBytes = 0;
+	size_t m_reportedFailedChunks = 0;          // writer failures last reported to the console
+	ChunkJournal m_journal;                      // block edits since their chunks were last saved
+	std::map<ChunkCoords, std::vector<BlockEdit>> m_recoveredEdits; // replayed from the journal of a crashed session as their chunks load
+	double m_autosaveIntervalSeconds = 30.0;
+	double m_autosaveBudgetSeconds = 0.001;      // per frame, a save only starts when the estimate of its cost still fits
+	int m_autosaveBatchChunks = 4;               // per frame
+	double m_nextAutosaveSeconds = 0.0;
+	double m_autosaveChunkSeconds = 0.0;         // estimated cost of one save, follows spikes at once and decays slowly
+	std::vector<ChunkCoords> m_autosaveQueue;    // dirty chunks of the running round, the back saves first
+	size_t m_autosaveTicket = 0;                 // writer ticket the round's saves are all covered by
+	size_t m_autosaveRoundCount = 0;
+	size_t m_autosavedChunkCount = 0;
+	size_t m_autosaveOverBudgetCount = 0;
+	double m_autosavePeakSeconds = 0.0;
 	unsigned int m_worldSeed = 781031139;
 	int m_chunkActivationRange = 250;
 	WorldGenerator* m_generator = nullptr;
+	FeatureQueue m_featureQueue;                 // feature blocks generated chunks left for their neighbors, kept in the world folder
 	std::map<ChunkCoords, Chunk*> m_chunksLoaded;
 	std::map<ChunkCoords, Chunk*> m_chunksGenerating;
 	int m_rebuildMeshTicket = 0;
 	int m_chunkIOTicket = 0;
 	std::vector<ChunkCoords> m_hotspots;
-	std::deque<BlockIterator> m_dirtyLighting;
-	std::deque<BlockIterator> m_debugLighting;
+	std::vector<Vec2> m_hotspotFacings;          // horizontal view direction the load queue was sorted with, zero if none
+	std::vector<IntVec2> m_loadOffsets;          // offsets in activation range of a hotspot, spiraling out from the nearest
+	std::vector<ChunkCoords> m_chunksLoading;    // chunks to load, sorted from lowest to highest priority
+	bool m_loadQueueDirty = true;                // rebuilt on the next activation, when a hotspot changes chunk or turns
+	size_t m_loadQueueRebuildCount = 0;
+	std::set<std::pair<int, Chunk*>> m_chunksMeshDirty; // mesh dirty chunks with all neighbors loaded, nearest hotspot distance first
+	std::set<Chunk*> m_chunksPendingNeighbors;   // mesh dirty chunks waiting for a neighbor to load
+	std::set<Chunk*> m_chunksTicking;            // chunks inside random tick range of a hotspot
+	std::vector<ChunkCoords> m_chunksUnloading;  // chunks out of range, sorted from nearest to farthest
+	std::set<Chunk*> m_chunksDirtyLighting[LIGHT_PRIORITY_SIZE]; // chunks with blocks in their light queue
+	std::set<Chunk*> m_chunksDarkLighting;       // chunks with light removals queued, drained before any dirty block so stale light is never spread
+	bool m_lightRemovalEnabled = true;
+	size_t m_lightingUpdateCount = 0;
+	double m_lightingBudgetSeconds = 0.002;
+	int m_lightJobsRunning = 0;
+	int m_lightJobsExecuted = 0;              // jobs of the phase past Execute, guarded by m_lightJobsMutex
+	int m_lightJobsMostProcessed = 0;         // blocks relaxed by the busiest job of the phase, guarded by m_lightJobsMutex
+	double m_lightJobBlocksPerSecond = 2000000.0; // measured per job, sizes the jobs of the next phases
+	std::mutex m_lightJobsMutex;
+	std::condition_variable m_lightJobsDone;
 	Stopwatch m_rndTickWatch;
 };
 
@@ -0,0 +1,817 @@
+#include "Game/WorldCommands.hpp"
+
+#include "Game/BlockDef.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/ChunkJournal.hpp"
+#include "Game/ChunkProvider.hpp"
+#include "Game/ChunkWriter.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/WorldGenerator.hpp"
+
+#include "Engine/Core/ByteBuffer.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+
+bool Command_ChunkSaveTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 4);
+
+	const char* modeNames[2] = { "full", "delta" };
+	for (int mode = 0; mode < 2; mode++)
+	{
+		HeadlessWorld world(radius);
+		ChunkProvider* provider = world.GetProvider();
+		world.DeleteChunkFiles(radius);
+		provider->SetDeltaSaveEnabled(mode == 1);
+		provider->UnloadAllChunks(); // generated without disk, nothing tracked their edits for a delta save
+		provider->SetDiskIOEnabled(true);
+		world.LoadChunks(radius);
+
+		// a few edits around the origin, a dug shaft and a line of glowstone across chunk borders
+		std::vector<std::pair<WorldCoords, BlockId>> edits;
+		int surface = FindSurfaceHeight(provider, 8, 8);
+		for (int z = surface; z > surface - 20 && z > 1; z--)
+			edits.emplace_back(WorldCoords(8, 8, z), Blocks::BLOCK_AIR);
+		for (int x = -20; x < 20; x++)
+			edits.emplace_back(WorldCoords(x, 0, Min(surface + 2, (int)CHUNK_MAX_Z)), Blocks::BLOCK_GLOWSTONE);
+		for (auto& edit : edits)
+			provider->SetBlockId(edit.first, edit.second);
+		std::map<ChunkCoords, std::vector<BlockId>> expected = SnapshotBlocks(provider);
+
+		double start = GetCurrentTimeSeconds();
+		provider->UnloadAllChunks();
+		double saveTime = GetCurrentTimeSeconds() - start;
+
+		world.LoadChunks(radius);
+		bool match = SnapshotBlocks(provider) == expected;
+
+		// delta files of another generator output keep their edits over the new terrain, and are written again under it
+		bool staleKept = true;
+		if (mode == 1)
+		{
+			provider->UnloadAllChunks();
+			provider->GetGenerator()->SetFieldLatticeStep(NOISE_FIELD_HILLINESS, NOISE_LATTICE_STEP);
+			world.LoadChunks(radius);
+			for (auto& edit : edits)
+				staleKept = provider->GetBlockId(edit.first) == edit.second && staleKept;
+			std::map<ChunkCoords, std::vector<BlockId>> reloaded = SnapshotBlocks(provider);
+
+			provider->UnloadAllChunks();
+			world.LoadChunks(radius);
+			staleKept = SnapshotBlocks(provider) == reloaded && staleKept;
+		}
+
+		g_theConsole->AddLine(match && staleKept ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk save %s: %d of %d chunks written, %d bytes, %.2fms, reload %s%s",
+			modeNames[mode], (int)provider->GetSavedChunkCount(), (int)expected.size(), (int)provider->GetSavedBytes(), saveTime * 1000.0, match ? "matches" : "DIFFERS",
+			mode == 1 ? (staleKept ? ", edits kept over a new generator" : ", edits LOST over a new generator") : ""));
+
+		provider->SetDiskIOEnabled(false);
+		world.DeleteChunkFiles(radius);
+	}
+	return true;
+}
+
+std::atomic<int> g_slowReadDelayMs = 0;
+std::atomic<int> g_slowReadCount = 0;
+
+// SlowFileRead: Region reader standing in for a slow disk
+bool SlowFileRead(RegionFile& region, int chunkIndex, std::vector<unsigned char>& data)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(g_slowReadDelayMs.load()));
+	g_slowReadCount++;
+	return region.Read(chunkIndex, data);
+}
+
+bool Command_ChunkAsyncLoadTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 3);
+	int delayMs = args.GetValue("delayMs", 20);
+
+	// full files for every chunk, so loads read rather than generate
+	HeadlessWorld world(radius);
+	ChunkProvider* provider = world.GetProvider();
+	world.DeleteChunkFiles(radius);
+	provider->SetDiskIOEnabled(true);
+	provider->SetDeltaSaveEnabled(false);
+
+	int surface = FindSurfaceHeight(provider, 8, 8);
+	for (int x = -20; x < 20; x++)
+		provider->SetBlockId(WorldCoords(x, 0, Min(surface + 2, (int)CHUNK_MAX_Z)), Blocks::BLOCK_GLOWSTONE);
+	std::map<ChunkCoords, std::vector<BlockId>> expected = SnapshotBlocks(provider);
+	provider->UnloadAllChunks();
+
+	// one file gone and one broken, both unedited and expected to come back from the generator.
+	// their neighbors load from files and spill no leaves, so they match a chunk generated alone
+	ChunkCoords missingCoords = ChunkCoords(radius, radius);
+	ChunkCoords brokenCoords = ChunkCoords(-radius, radius);
+	OverworldWorldGenerator generator;
+	generator.m_seed = provider->GetGenerator()->m_seed;
+	for (const ChunkCoords& coords : { missingCoords, brokenCoords })
+	{
+		Chunk chunk(nullptr, coords);
+		generator.GenerateChunk(&chunk);
+		for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+			expected[coords][index] = chunk.m_blockArray[index].GetBlockId();
+	}
+	provider->DeleteChunkFile(missingCoords);
+	std::vector<unsigned char> garbage;
+	for (int index = 0; index < 64; index++)
+		garbage.push_back((unsigned char)(index * 37));
+	provider->GetChunkWriter().Write(brokenCoords, std::move(garbage));
+	provider->GetChunkWriter().Flush();
+
+	g_slowReadDelayMs = delayMs;
+	g_slowReadCount = 0;
+	provider->SetFileReader(SlowFileRead);
+
+	double slowestCall = 0.0;
+	double start = GetCurrentTimeSeconds();
+	for (int y = -radius; y <= radius; y++)
+		for (int x = -radius; x <= radius; x++)
+		{
+			double callStart = GetCurrentTimeSeconds();
+			provider->LoadChunk(ChunkCoords(x, y));
+			slowestCall = Max(slowestCall, GetCurrentTimeSeconds() - callStart);
+		}
+	double queueTime = GetCurrentTimeSeconds() - start;
+	provider->FinishUpChunkGeneration();
+	double loadTime = GetCurrentTimeSeconds() - start;
+
+	bool match = SnapshotBlocks(provider) == expected;
+	bool fellBack = !provider->FindLoadedChunk(missingCoords)->m_loadedFromDisk && !provider->FindLoadedChunk(brokenCoords)->m_loadedFromDisk;
+	int reads = g_slowReadCount;
+	int chunks = (int)expected.size();
+
+	provider->SetFileReader(nullptr);
+	provider->SetDiskIOEnabled(false);
+	world.DeleteChunkFiles(radius);
+
+	// the main thread only queues jobs, no call may wait on a read
+	bool pass = match && fellBack && slowestCall * 1000.0 < 0.5 * delayMs;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Async chunk load: %s (%d chunks, %d reads at %dms, reload %s, missing and broken files %s)",
+		pass ? "PASS" : "FAIL", chunks, reads, delayMs, match ? "matches" : "DIFFERS", fellBack ? "generated" : "NOT generated"));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Main thread: %.3fms to queue all, %.3fms slowest LoadChunk call, %.2fms until all loaded (%.2fms if read serially)",
+		queueTime * 1000.0, slowestCall * 1000.0, loadTime * 1000.0, (double)reads * delayMs));
+	return true;
+}
+
+bool Command_ChunkWriterTest(EventArgs& args)
+{
+	int chunkCount = args.GetValue("chunks", 256);
+	int chunkSize = args.GetValue("chunkSize", 12 * 1024);
+	const std::string folder = "Map/WriterTest";
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path(folder), error);
+	std::filesystem::create_directories(std::filesystem::path(folder));
+	RegionCache regions(folder);
+
+	std::vector<unsigned char> payload(chunkSize);
+	for (int index = 0; index < chunkSize; index++)
+		payload[index] = (unsigned char)(index * 131 + 7);
+
+	// chunks spread over four regions, so batches sync more than one file
+	auto getCoords = [](int index) { return ChunkCoords(index % 48 - 24, index / 48 - 2); };
+
+	// repeated saves of one chunk coalesce, a reader sees the newest snapshot before it lands
+	bool coalesced = false;
+	bool newestRead = false;
+	bool newestWritten = false;
+	{
+		ChunkWriter writer(&regions);
+		for (int version = 0; version < 100; version++)
+		{
+			std::vector<unsigned char> data = payload;
+			data[0] = (unsigned char)version;
+			writer.Write(ChunkCoords(0, 0), std::move(data));
+		}
+		std::vector<unsigned char> pending;
+		newestRead = writer.FindPending(ChunkCoords(0, 0), pending) != PendingWrite::DATA || pending[0] == 99;
+		writer.Flush();
+		coalesced = writer.GetCoalescedCount() > 0 && writer.GetWrittenCount() + writer.GetCoalescedCount() == 100;
+
+		std::vector<unsigned char> data;
+		std::shared_ptr<RegionFile> region = regions.Get(IntVec2(0, 0), false);
+		newestWritten = region && region->Read(RegionFile::GetChunkIndex(ChunkCoords(0, 0)), data) && data.size() == payload.size() && data[0] == 99;
+	}
+
+	// a small queue holds the saving thread back instead of growing
+	constexpr size_t smallCapacity = 8;
+	size_t peakQueued = 0;
+	size_t stalls = 0;
+	double stallSeconds = 0.0;
+	{
+		ChunkWriter writer(&regions, smallCapacity);
+		for (int index = 0; index < chunkCount; index++)
+			writer.Write(getCoords(index), std::vector<unsigned char>(payload));
+		writer.Flush();
+		peakQueued = writer.GetPeakQueuedCount();
+		stalls = writer.GetStallCount();
+		stallSeconds = writer.GetStallSeconds();
+	}
+
+	// shutdown flush, the writer thread alone against helpers draining the same queue
+	double flushTimes[2] = {};
+	size_t batches[2] = {};
+	size_t failed = 0;
+	int threadCounts[2] = { 1, CHUNK_FLUSH_THREADS };
+	for (int run = 0; run < 2; run++)
+	{
+		ChunkWriter writer(&regions, chunkCount);
+		for (int index = 0; index < chunkCount; index++)
+		{
+			std::vector<unsigned char> data = payload;
+			data[1] = (unsigned char)run;
+			writer.Write(getCoords(index), std::move(data));
+		}
+		writer.Flush(threadCounts[run]);
+		flushTimes[run] = writer.GetLastFlushSeconds();
+		batches[run] = writer.GetBatchCount();
+		failed += writer.GetFailedCount();
+	}
+
+	// every chunk holds the last run
+	int lost = 0;
+	std::vector<unsigned char> data;
+	for (int index = 0; index < chunkCount; index++)
+	{
+		std::shared_ptr<RegionFile> region = regions.Get(RegionFile::GetRegionCoords(getCoords(index)), false);
+		if (!region || !region->Read(RegionFile::GetChunkIndex(getCoords(index)), data) || data.size() != payload.size() || data[1] != 1)
+			lost++;
+	}
+	regions.CloseAll();
+	std::filesystem::remove_all(std::filesystem::path(folder), error);
+
+	bool pass = coalesced && newestRead && newestWritten && peakQueued <= smallCapacity && stalls > 0 && lost == 0 && failed == 0;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk writer: %s (coalescing %s, newest snapshot %s, peak queue %d of %d with %d stalls over %.2fms, %d chunks lost, %d writes failed)",
+		pass ? "PASS" : "FAIL", coalesced ? "ok" : "FAILED", (newestRead && newestWritten) ? "ok" : "LOST", (int)peakQueued, (int)smallCapacity, (int)stalls, stallSeconds * 1000.0, lost, (int)failed));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Flush of %d chunks of %dKB: %.2fms on 1 thread (%d batches), %.2fms on %d threads (%d batches), %.2fx",
+		chunkCount, chunkSize / 1024, flushTimes[0] * 1000.0, (int)batches[0], flushTimes[1] * 1000.0, CHUNK_FLUSH_THREADS, (int)batches[1], flushTimes[0] / flushTimes[1]));
+	return true;
+}
+
+bool Command_RegionFileTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 6);
+	int repeats = args.GetValue("repeats", 4);
+	const std::string folder = "Map/RegionTest";
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path(folder), error);
+	std::filesystem::create_directories(std::filesystem::path(folder + "/Loose"));
+
+	// block streams of generated chunks, around the origin so they spread over four regions
+	std::map<ChunkCoords, std::vector<unsigned char>> payloads;
+	{
+		HeadlessWorld world(radius);
+		for (auto& entry : world.GetProvider()->GetLoadedChunks())
+		{
+			ByteBuffer buffer;
+			entry.second->WriteBytes(&buffer);
+			const unsigned char* bytes = (const unsigned char*)buffer.GetData();
+			payloads[entry.first].assign(bytes, bytes + buffer.GetSize());
+		}
+	}
+
+	// written, grown past their sectors, written back at the old size into the gaps the grown ones left
+	RegionCache regions(folder);
+	std::set<IntVec2> regionCoords;
+	bool written = true;
+	for (int pass = 0; pass < 3; pass++)
+	{
+		for (auto& entry : payloads)
+		{
+			std::vector<unsigned char> data = entry.second;
+			if (pass == 1)
+				data.insert(data.end(), entry.second.begin(), entry.second.end());
+			std::shared_ptr<RegionFile> region = regions.Get(RegionFile::GetRegionCoords(entry.first), true);
+			written = region && region->Write(RegionFile::GetChunkIndex(entry.first), data.data(), data.size()) && written;
+			regionCoords.insert(RegionFile::GetRegionCoords(entry.first));
+		}
+		for (const IntVec2& coords : regionCoords)
+			written = regions.Get(coords, false)->Sync() && written;
+	}
+
+	size_t reused = 0;
+	size_t appended = 0;
+	size_t gapSectors = 0;
+	for (const IntVec2& coords : regionCoords)
+	{
+		std::shared_ptr<RegionFile> region = regions.Get(coords, false);
+		reused += region->GetReusedGapCount();
+		appended += region->GetAppendedCount();
+		gapSectors += region->GetFileSectorCount() - region->GetUsedSectorCount();
+	}
+
+	// both read paths return what was written
+	auto readsBack = [&](const ChunkCoords& coords, const std::vector<unsigned char>& expected) {
+		std::shared_ptr<RegionFile> region = regions.Get(RegionFile::GetRegionCoords(coords), false);
+		std::vector<unsigned char> data;
+		std::shared_ptr<const MappedFile> mapping;
+		const unsigned char* mapped = nullptr;
+		size_t size = 0;
+		return region && region->Read(RegionFile::GetChunkIndex(coords), data) && data == expected
+			&& region->ReadMapped(RegionFile::GetChunkIndex(coords), mapping, mapped, size) && size == expected.size() && memcmp(mapped, expected.data(), size) == 0;
+	};
+	bool readBack = true;
+	for (auto& entry : payloads)
+		readBack = readsBack(entry.first, entry.second) && readBack;
+
+	// writes never synced are lost as in a crash, the copies they were replacing are still whole
+	for (auto& entry : payloads)
+	{
+		std::vector<unsigned char> data(entry.second.size(), 0xCD);
+		regions.Get(RegionFile::GetRegionCoords(entry.first), false)->Write(RegionFile::GetChunkIndex(entry.first), data.data(), data.size());
+	}
+	regions.CloseAll();
+	bool unsyncedKept = true;
+	for (auto& entry : payloads)
+		unsyncedKept = readsBack(entry.first, entry.second) && unsyncedKept;
+
+	// a payload damaged behind the region's back fails its checksum and is dropped by compaction
+	ChunkCoords tornCoords = payloads.begin()->first;
+	regions.CloseAll();
+	bool tornDetected = false;
+	std::fstream file(regions.GetRegionFilePath(RegionFile::GetRegionCoords(tornCoords)), std::ios::in | std::ios::out | std::ios::binary);
+	if (file)
+	{
+		RegionEntry entry;
+		file.seekg(REGION_PREAMBLE_SIZE + RegionFile::GetChunkIndex(tornCoords) * sizeof(RegionEntry));
+		file.read((char*)&entry, sizeof(entry));
+		file.seekp((std::streamoff)entry.m_sector * REGION_SECTOR_SIZE + entry.m_length / 2);
+		file.put((char)~payloads[tornCoords][entry.m_length / 2]);
+		file.close();
+		std::vector<unsigned char> data;
+		std::shared_ptr<RegionFile> region = regions.Get(RegionFile::GetRegionCoords(tornCoords), false);
+		tornDetected = region && region->HasChunk(RegionFile::GetChunkIndex(tornCoords)) && !region->Read(RegionFile::GetChunkIndex(tornCoords), data);
+	}
+	payloads.erase(tornCoords);
+
+	// a loose chunk file of an older save is imported, gaps are squeezed out
+	ChunkCoords looseCoords = ChunkCoords(100, 100);
+	payloads[looseCoords] = payloads.begin()->second;
+	ByteBuffer looseBuffer;
+	looseBuffer.Write(payloads[looseCoords].size(), payloads[looseCoords].data());
+	FileWriteFromBuffer(looseBuffer, regions.GetChunkFilePath(looseCoords));
+	regions.CloseAll();
+	RegionCompactStats stats;
+	bool compacted = CompactRegionFolder(folder, stats);
+
+	// a loose file that cannot be read is kept and the compaction reported as failed
+	std::string unreadablePath = regions.GetChunkFilePath(ChunkCoords(101, 100));
+	std::ofstream(unreadablePath, std::ios::binary).close();
+	RegionCompactStats unreadableStats;
+	bool unreadableKept = !CompactRegionFolder(folder, unreadableStats) && unreadableStats.m_failedFiles == 1 && std::filesystem::exists(std::filesystem::path(unreadablePath), error);
+	std::filesystem::remove(std::filesystem::path(unreadablePath), error);
+
+	bool packed = true;
+	for (const IntVec2& coords : regionCoords)
+	{
+		std::shared_ptr<RegionFile> region = regions.Get(coords, false);
+		packed = region && region->GetFileSectorCount() == region->GetUsedSectorCount() && packed;
+	}
+	for (auto& entry : payloads)
+		readBack = readsBack(entry.first, entry.second) && readBack;
+	regions.CloseAll();
+
+	// loads of the same chunks from a file each against one region, after a first pass warmed the OS cache
+	for (auto& entry : payloads)
+	{
+		ByteBuffer buffer;
+		buffer.Write(entry.second.size(), entry.second.data());
+		FileWriteFromBuffer(buffer, Stringf("%s/Loose/Chunk(%d,%d).chunk", folder.c_str(), entry.first.x, entry.first.y));
+	}
+	double readTimes[3] = {};
+	for (int repeat = 0; repeat <= repeats; repeat++)
+	{
+		double start = GetCurrentTimeSeconds();
+		for (auto& entry : payloads)
+		{
+			ByteBuffer buffer;
+			FileReadToBuffer(buffer, Stringf("%s/Loose/Chunk(%d,%d).chunk", folder.c_str(), entry.first.x, entry.first.y));
+		}
+		double looseTime = GetCurrentTimeSeconds() - start;
+
+		RegionCache readRegions(folder);
+		start = GetCurrentTimeSeconds();
+		for (auto& entry : payloads)
+		{
+			std::vector<unsigned char> data;
+			readRegions.Get(RegionFile::GetRegionCoords(entry.first), false)->Read(RegionFile::GetChunkIndex(entry.first), data);
+		}
+		double bufferedTime = GetCurrentTimeSeconds() - start;
+
+		RegionCache mappedRegions(folder);
+		start = GetCurrentTimeSeconds();
+		for (auto& entry : payloads)
+		{
+			std::shared_ptr<const MappedFile> mapping;
+			const unsigned char* data = nullptr;
+			size_t size = 0;
+			mappedRegions.Get(RegionFile::GetRegionCoords(entry.first), false)->ReadMapped(RegionFile::GetChunkIndex(entry.first), mapping, data, size);
+		}
+		double mappedTime = GetCurrentTimeSeconds() - start;
+
+		if (repeat > 0)
+		{
+			readTimes[0] += looseTime;
+			readTimes[1] += bufferedTime;
+			readTimes[2] += mappedTime;
+		}
+	}
+	std::filesystem::remove_all(std::filesystem::path(folder), error);
+
+	double perChunk = 1000000.0 / (double)(payloads.size() * Max(repeats, 1));
+	bool pass = written && readBack && unsyncedKept && tornDetected && compacted && packed && stats.m_importedFiles == 1 && unreadableKept && appended > 0 && reused > 0;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Region files: %s (%d chunks in %d regions, reads %s, unsynced writes %s, %d into gaps, %d appended leaving %d gap sectors, torn payload %s, compaction %dKB to %dKB, %d loose file imported, unreadable file %s)",
+		pass ? "PASS" : "FAIL", (int)payloads.size(), (int)regionCoords.size(), readBack ? "match" : "DIFFER", unsyncedKept ? "dropped" : "CORRUPTED", (int)reused, (int)appended, (int)gapSectors, tornDetected ? "detected" : "MISSED",
+		(int)(stats.m_bytesBefore / 1024), (int)(stats.m_bytesAfter / 1024), (int)stats.m_importedFiles, unreadableKept ? "kept" : "LOST"));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Chunk reads, %d chunks x %d: loose files %.2fus, region buffered %.2fus, region mapped %.2fus per chunk, %d files against %d",
+		(int)payloads.size(), repeats, readTimes[0] * perChunk, readTimes[1] * perChunk, readTimes[2] * perChunk, (int)payloads.size(), (int)regionCoords.size() + 1));
+	return true;
+}
+
+// allocations made on a thread while it has a counter set, for the chunk load benchmark. replacing the global
+// operator new affects the whole game, only builds defining BENCHMARK_COUNT_ALLOCATIONS count them
+thread_local size_t* t_allocationCounter = nullptr;
+
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+void* operator new(size_t size)
+{
+	if (t_allocationCounter)
+		(*t_allocationCounter)++;
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+#endif
+
+// LoadChunkThroughByteBuffer: Chunk load as it was before decoding in place, a buffered read copied into a
+// ByteBuffer and read field by field. full chunk files only, the benchmark reference
+ChunkFileResult LoadChunkThroughByteBuffer(RegionCache& regions, Chunk& chunk)
+{
+	std::vector<unsigned char> data;
+	std::shared_ptr<RegionFile> region = regions.Get(RegionFile::GetRegionCoords(chunk.m_chunkCoords), false);
+	if (!region || !region->Read(RegionFile::GetChunkIndex(chunk.m_chunkCoords), data))
+		return ChunkFileResult::MISSING;
+
+	ByteBuffer buffer;
+	buffer.Write(data.size(), data.data());
+	unsigned char magic[4];
+	unsigned char version;
+	unsigned int worldSeed;
+	unsigned char bits[3];
+	unsigned char blockEncoding;
+	unsigned char hasLight;
+	buffer.Read(4, &magic[0]);
+	buffer.Read(version);
+	buffer.Read(worldSeed);
+	for (unsigned char& bit : bits)
+		buffer.Read(bit);
+	buffer.Read(blockEncoding);
+
+	if (!chunk.ReadBytes(&buffer))
+		return ChunkFileResult::MISSING;
+	chunk.RebuildHeightMap();
+	buffer.Read(chunk.m_editStamp);
+	for (unsigned int& stamp : chunk.m_neighborStamps)
+		buffer.Read(stamp);
+	buffer.Read(hasLight);
+	if (!hasLight || !chunk.ReadLightBytes(&buffer))
+		chunk.PopulateLocalLight();
+	return ChunkFileResult::LOADED;
+}
+
+bool Command_ChunkLoadBenchmark(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 6);
+	int repeats = args.GetValue("repeats", 4);
+
+	// full files with light for every chunk, written into regions
+	HeadlessWorld world(radius);
+	ChunkProvider* provider = world.GetProvider();
+	provider->SetDiskIOEnabled(true);
+	provider->SetDeltaSaveEnabled(false);
+	provider->SetCodec(ChunkCodec::Find(CHUNK_CODEC_RLE)); // the ByteBuffer path only reads run length streams
+	provider->ProcessAllDirtyLighting(true);
+	for (auto& entry : provider->GetLoadedChunks())
+		entry.second->m_blocksDirty = true;
+	std::vector<ChunkCoords> coordsList;
+	for (auto& entry : provider->GetLoadedChunks())
+		coordsList.push_back(entry.first);
+	provider->UnloadAllChunks();
+
+	// the same chunks through each path, one chunk object reused so its own allocation is not counted.
+	// a first pass warms the OS cache and the mapping
+	const char* pathNames[3] = { "ByteBuffer copy", "buffered in place", "mapped in place" };
+	double loadTimes[3] = {};
+	size_t allocations[3] = {};
+	std::vector<unsigned char> results[3];
+	int failed = 0;
+	for (int path = 0; path < 3; path++)
+	{
+		provider->SetMappedReads(path == 2);
+		Chunk chunk(nullptr, ChunkCoords(0, 0));
+		for (int repeat = 0; repeat <= repeats; repeat++)
+		{
+			for (const ChunkCoords& coords : coordsList)
+			{
+				chunk.m_chunkCoords = coords;
+				size_t counter = 0;
+				t_allocationCounter = &counter;
+				double start = GetCurrentTimeSeconds();
+				ChunkFileResult result = path == 0 ? LoadChunkThroughByteBuffer(provider->GetRegions(), chunk) : provider->LoadChunkFromDisk(&chunk);
+				double loadTime = GetCurrentTimeSeconds() - start;
+				t_allocationCounter = nullptr;
+
+				if (result != ChunkFileResult::LOADED)
+					failed++;
+				if (repeat == 0)
+				{
+					for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+					{
+						const Block& block = chunk.m_blockArray[index];
+						results[path].push_back(block.GetBlockId());
+						results[path].push_back((unsigned char)((block.GetOutdoorLightInfluence() << 4) | block.GetIndoorLightInfluence()));
+					}
+					continue;
+				}
+				loadTimes[path] += loadTime;
+				allocations[path] += counter;
+			}
+		}
+	}
+	provider->SetMappedReads(g_gameConfigBlackboard.GetValue("chunkMappedReads", true));
+
+	// broken payloads fail without touching the chunk, a real file cut every 61 bytes and a run of length 0
+	std::vector<unsigned char> payload;
+	std::shared_ptr<RegionFile> region = provider->GetRegions().Get(RegionFile::GetRegionCoords(coordsList[0]), false);
+	region->Read(RegionFile::GetChunkIndex(coordsList[0]), payload);
+	Chunk untouched(nullptr, coordsList[0]);
+	for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+		untouched.m_blockArray[index].SetBlockId(Blocks::BLOCK_GLOWSTONE);
+	int brokenAccepted = 0;
+	int brokenTouched = 0;
+	std::vector<size_t> cuts = { 1, 5, 11, 12, 13, payload.size() / 2, payload.size() - 1 };
+	for (size_t cut = 13; cut < payload.size(); cut += 61)
+		cuts.push_back(cut);
+	for (size_t cut : cuts)
+	{
+		std::vector<unsigned char> broken(payload.begin(), payload.begin() + cut);
+		if (cut == 5)
+		{
+			broken = payload;
+			broken[14] = 0; // length of the first block run
+		}
+		provider->GetChunkWriter().Write(coordsList[0], std::move(broken));
+		ChunkFileResult result = provider->LoadChunkFromDisk(&untouched);
+		if (result == ChunkFileResult::LOADED || result == ChunkFileResult::DELTA)
+			brokenAccepted++;
+		else if (untouched.m_blockArray[0].GetBlockId() != Blocks::BLOCK_GLOWSTONE || untouched.m_blockArray[CHUNK_SIZE_BLOCKS - 1].GetBlockId() != Blocks::BLOCK_GLOWSTONE)
+			brokenTouched++;
+	}
+
+	for (const ChunkCoords& coords : coordsList)
+		provider->DeleteChunkFile(coords);
+	provider->SetDiskIOEnabled(false);
+
+	bool match = results[0] == results[1] && results[0] == results[2];
+	bool pass = match && failed == 0 && brokenAccepted == 0 && brokenTouched == 0;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk load paths: %s (%d chunks, results %s, %d loads failed, %d of %d broken payloads accepted, %d left the chunk changed)",
+		pass ? "PASS" : "FAIL", (int)coordsList.size(), match ? "match" : "DIFFER", failed, brokenAccepted, (int)cuts.size(), brokenTouched));
+	double loads = (double)(coordsList.size() * Max(repeats, 1));
+	for (int path = 0; path < 3; path++)
+	{
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+		g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("  %-18s %8.2fus %6.2f allocations per chunk", pathNames[path], loadTimes[path] * 1000000.0 / loads, (double)allocations[path] / loads));
+#else
+		g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("  %-18s %8.2fus per chunk", pathNames[path], loadTimes[path] * 1000000.0 / loads));
+#endif
+	}
+#if !defined(BENCHMARK_COUNT_ALLOCATIONS)
+	g_theConsole->AddLine(DevConsole::LOG_INFO, "  allocations are counted in builds defining BENCHMARK_COUNT_ALLOCATIONS");
+#endif
+	return true;
+}
+
+bool Command_ChunkCodecBenchmark(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 3);
+	int repeats = Max(args.GetValue("repeats", 3), 1);
+	const std::vector<const ChunkCodec*>& codecs = ChunkCodec::GetAll();
+
+	// block and light planes of generated and lit chunks, the workloads differ enough to pick a codec per world type
+	OverworldWorldGenerator overworld;
+	SkyBlockWorldGenerator skyBlock;
+	DensityWorldGenerator density;
+	PerlinWorldGenerator perlin;
+	WorldGenerator* generators[] = { &overworld, &skyBlock, &density, &perlin };
+	const char* generatorNames[] = { "Overworld", "SkyBlock", "Density", "Perlin" };
+	bool pass = true;
+	for (int generatorIndex = 0; generatorIndex < 4; generatorIndex++)
+	{
+		std::vector<unsigned char> blockPlanes;
+		std::vector<unsigned char> lightPlanes;
+		for (int y = -radius; y <= radius; y++)
+			for (int x = -radius; x <= radius; x++)
+			{
+				Chunk chunk(nullptr, ChunkCoords(x, y));
+				generators[generatorIndex]->GenerateChunk(&chunk);
+				chunk.PopulateLocalLight();
+				blockPlanes.resize(blockPlanes.size() + CHUNK_SIZE_BLOCKS);
+				lightPlanes.resize(lightPlanes.size() + CHUNK_SIZE_BLOCKS);
+				chunk.GetBlockIds(blockPlanes.data() + blockPlanes.size() - CHUNK_SIZE_BLOCKS);
+				chunk.GetLightBytes(lightPlanes.data() + lightPlanes.size() - CHUNK_SIZE_BLOCKS);
+			}
+		size_t planeCount = blockPlanes.size() / CHUNK_SIZE_BLOCKS;
+
+		g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Chunk codecs, %s (%d chunks):", generatorNames[generatorIndex], (int)planeCount));
+		for (const ChunkCodec* codec : codecs)
+		{
+			size_t encodedBytes[2] = {};
+			double encodeTime = 0.0;
+			double decodeTime = 0.0;
+			bool match = true;
+			std::vector<unsigned char> encoded;
+			std::vector<unsigned char> decoded(CHUNK_SIZE_BLOCKS);
+			for (int plane = 0; plane < 2; plane++)
+			{
+				const std::vector<unsigned char>& planes = plane == 0 ? blockPlanes : lightPlanes;
+				for (size_t index = 0; index < planeCount; index++)
+				{
+					const unsigned char* source = planes.data() + index * CHUNK_SIZE_BLOCKS;
+					double start = GetCurrentTimeSeconds();
+					for (int repeat = 0; repeat < repeats; repeat++)
+					{
+						encoded.clear();
+						codec->Encode(source, encoded);
+					}
+					encodeTime += GetCurrentTimeSeconds() - start;
+					encodedBytes[plane] += encoded.size();
+
+					start = GetCurrentTimeSeconds();
+					for (int repeat = 0; repeat < repeats; repeat++)
+					{
+						const unsigned char* data = encoded.data();
+						match = codec->Decode(data, encoded.data() + encoded.size(), decoded.data()) && data == encoded.data() + encoded.size() && match;
+					}
+					decodeTime += GetCurrentTimeSeconds() - start;
+					match = match && memcmp(decoded.data(), source, CHUNK_SIZE_BLOCKS) == 0;
+				}
+			}
+			pass = pass && match;
+
+			double rawBytes = (double)(planeCount * CHUNK_SIZE_BLOCKS);
+			double megabytes = rawBytes * 2.0 * repeats / (1024.0 * 1024.0);
+			g_theConsole->AddLine(match ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("  %-9s %7.1fB/chunk, ratio %6.1f (blocks %6.1f, light %6.1f), encode %7.1fMB/s, decode %7.1fMB/s, round trip %s",
+				codec->GetName(), (double)(encodedBytes[0] + encodedBytes[1]) / planeCount, rawBytes * 2.0 / (encodedBytes[0] + encodedBytes[1]),
+				rawBytes / encodedBytes[0], rawBytes / encodedBytes[1], megabytes / encodeTime, megabytes / decodeTime, match ? "matches" : "DIFFERS"));
+		}
+	}
+
+	// every codec through chunk files in a region and back, blocks and stored light must come back the same
+	for (const ChunkCodec* codec : codecs)
+	{
+		HeadlessWorld world(1);
+		ChunkProvider* provider = world.GetProvider();
+		provider->SetDiskIOEnabled(true);
+		provider->SetDeltaSaveEnabled(false);
+		provider->SetCodec(codec);
+		provider->ProcessAllDirtyLighting(true);
+		std::map<ChunkCoords, std::vector<unsigned char>> expected;
+		for (auto& entry : provider->GetLoadedChunks())
+		{
+			std::vector<unsigned char>& planes = expected[entry.first];
+			planes.resize(CHUNK_SIZE_BLOCKS * 2);
+			entry.second->GetBlockIds(planes.data());
+			entry.second->GetLightBytes(planes.data() + CHUNK_SIZE_BLOCKS);
+			entry.second->m_blocksDirty = true;
+		}
+		size_t savedBytes = provider->GetSavedBytes();
+		provider->UnloadAllChunks();
+		savedBytes = provider->GetSavedBytes() - savedBytes;
+
+		int mismatches = 0;
+		Chunk chunk(nullptr, ChunkCoords(0, 0));
+		std::vector<unsigned char> planes(CHUNK_SIZE_BLOCKS * 2);
+		for (auto& entry : expected)
+		{
+			chunk.m_chunkCoords = entry.first;
+			ChunkFileResult result = provider->LoadChunkFromDisk(&chunk);
+			chunk.GetBlockIds(planes.data());
+			chunk.GetLightBytes(planes.data() + CHUNK_SIZE_BLOCKS);
+			if (result != ChunkFileResult::LOADED || planes != entry.second)
+				mismatches++;
+			provider->DeleteChunkFile(entry.first);
+		}
+		provider->SetDiskIOEnabled(false);
+
+		pass = pass && mismatches == 0;
+		g_theConsole->AddLine(mismatches == 0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk files %-9s %d chunks, %d bytes, %d reloaded different",
+			codec->GetName(), (int)expected.size(), (int)savedBytes, mismatches));
+	}
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk codec benchmark: %s", pass ? "PASS" : "FAIL"));
+	return true;
+}
+
+bool Command_AutosaveTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 3);
+	double budget = 0.001 * (double)args.GetValue("budgetMs", 1.0f);
+	std::string journalPath = std::string(HEADLESS_WORLD_PATH) + "/" + CHUNK_JOURNAL_FILE_NAME;
+	std::string previousPath = std::string(HEADLESS_WORLD_PATH) + "/" + CHUNK_JOURNAL_PREVIOUS_FILE_NAME;
+	std::error_code error;
+	std::filesystem::remove(std::filesystem::path(journalPath), error);
+	std::filesystem::remove(std::filesystem::path(previousPath), error);
+
+	int frames = 0;
+	int framesOverBudget = 0;
+	double peak = 0.0;
+	int dirtyLeft = 0;
+	size_t autosaved = 0;
+	size_t savesOverBudget = 0;
+	size_t journaled = 0;
+	std::map<ChunkCoords, std::vector<BlockId>> expected;
+	{
+		HeadlessWorld world(radius);
+		ChunkProvider* provider = world.GetProvider();
+		world.DeleteChunkFiles(radius);
+		provider->SetDiskIOEnabled(true);
+		provider->SetAutosave(0.0, budget, 4);
+
+		// edits before the round are saved by it, a shaft and a line of glowstone across chunk borders
+		int surface = FindSurfaceHeight(provider, 8, 8);
+		for (int z = surface; z > surface - 20 && z > 1; z--)
+			provider->SetBlockId(WorldCoords(8, 8, z), Blocks::BLOCK_AIR);
+		for (int x = -20; x < 20; x++)
+			provider->SetBlockId(WorldCoords(x, 0, Min(surface + 2, (int)CHUNK_MAX_Z)), Blocks::BLOCK_GLOWSTONE);
+
+		// autosave alone each frame so its cost is what is measured, until the round is on disk
+		provider->RequestAutosave();
+		do
+		{
+			provider->ResetAutosavePeak();
+			provider->UpdateAutosave();
+			peak = Max(peak, provider->GetAutosavePeakSeconds());
+			if (provider->GetAutosavePeakSeconds() > budget)
+				framesOverBudget++;
+			frames++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} while ((provider->IsAutosaveRunning() || provider->GetAutosaveRoundCount() == 0) && frames < 10000);
+		for (auto& entry : provider->GetLoadedChunks())
+			if (entry.second->m_blocksDirty)
+				dirtyLeft++;
+		autosaved = provider->GetAutosavedChunkCount();
+		savesOverBudget = provider->GetAutosaveOverBudgetCount();
+
+		// edits after the round only live in the journal, then the game dies without saving
+		for (int x = -20; x < 20; x++)
+			provider->SetBlockId(WorldCoords(x, 5, Min(surface + 3, (int)CHUNK_MAX_Z)), Blocks::BLOCK_GLOWSTONE);
+		provider->SetBlockId(WorldCoords(8, 8, surface - 2), Blocks::BLOCK_GLOWSTONE);
+		provider->GetJournal().Flush();
+		journaled = provider->GetJournal().GetRecordCount();
+		expected = SnapshotBlocks(provider);
+	}
+
+	// the next start loads the autosaved chunks and replays the journal over them as they load
+	HeadlessWorld world(0);
+	ChunkProvider* provider = world.GetProvider();
+	size_t recovered = provider->GetRecoveredEditCount();
+	provider->UnloadAllChunks(); // generated without disk, the edits wait for the chunk from disk
+	provider->SetDiskIOEnabled(true);
+	world.LoadChunks(radius);
+	bool match = SnapshotBlocks(provider) == expected;
+	size_t pending = provider->GetRecoveredEditCount();
+
+	// a clean shutdown saves everything and leaves no journal behind
+	provider->UnloadAllChunks();
+	bool journalLeft = std::filesystem::exists(std::filesystem::path(journalPath), error) || std::filesystem::exists(std::filesystem::path(previousPath), error);
+	world.DeleteChunkFiles(radius);
+	provider->SetDiskIOEnabled(false);
+
+	bool pass = dirtyLeft == 0 && framesOverBudget == 0 && match && recovered > 0 && pending == 0 && !journalLeft;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Autosave: %s (%d chunks saved over %d frames, %d left dirty, peak %.3fms of %.3fms budget, %d frames over, %d single saves over)",
+		pass ? "PASS" : "FAIL", (int)autosaved, frames, dirtyLeft, peak * 1000.0, budget * 1000.0, framesOverBudget, (int)savesOverBudget));
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Journal recovery: %d records journaled, %d replayed, %d left pending, reload %s, journal %s after shutdown",
+		(int)journaled, (int)recovered, (int)pending, match ? "matches" : "DIFFERS", journalLeft ? "LEFT" : "removed"));
+	return true;
+}
@@ -0,0 +1,310 @@
+#include "Game/ChunkWriter.hpp"
+
+#include "Engine/Core/Time.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+ChunkWriter::ChunkWriter(RegionCache* regions, size_t capacity)
+	: m_regions(regions)
+	, m_capacity(capacity < 1 ? 1 : capacity)
+{
+	m_thread = std::thread([this]() { RunWriter(); });
+}
+
+ChunkWriter::~ChunkWriter()
+{
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_thread.join();
+}
+
+void ChunkWriter::Write(const ChunkCoords& coords, std::vector<unsigned char>&& data)
+{
+	Entry entry;
+	entry.m_data = std::make_shared<const std::vector<unsigned char>>(std::move(data));
+	Enqueue(coords, std::move(entry));
+}
+
+void ChunkWriter::Delete(const ChunkCoords& coords)
+{
+	Entry entry;
+	entry.m_delete = true;
+	Enqueue(coords, std::move(entry));
+}
+
+void ChunkWriter::Enqueue(const ChunkCoords& coords, Entry&& entry)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	entry.m_ticket = ++m_lastTicket;
+
+	// looked up again after each wait for space, the chunk may have been queued or failed meanwhile
+	double stallStart = 0.0;
+	auto ite = m_queued.find(coords);
+	while (ite == m_queued.end() && m_queued.size() >= m_capacity)
+	{
+		if (stallStart == 0.0)
+		{
+			stallStart = GetCurrentTimeSeconds();
+			m_stalls++;
+		}
+		m_space.wait(lock);
+		ite = m_queued.find(coords);
+	}
+	if (stallStart != 0.0)
+		m_stallSeconds += GetCurrentTimeSeconds() - stallStart;
+
+	if (ite != m_queued.end())
+	{
+		entry.m_ticket = ite->second.m_ticket;
+		ite->second = std::move(entry); // the older snapshot was never written
+		m_coalesced++;
+		return;
+	}
+	auto failed = m_retry.find(coords);
+	if (failed != m_retry.end())
+	{
+		entry.m_ticket = failed->second.m_ticket;
+		m_retry.erase(failed); // the failed snapshot is not needed anymore
+		m_coalesced++;
+	}
+
+	m_queued[coords] = std::move(entry);
+	m_order.push_back(coords);
+	if (m_queued.size() > m_peakQueued)
+		m_peakQueued = m_queued.size();
+	lock.unlock();
+	m_wake.notify_one();
+}
+
+PendingWrite ChunkWriter::FindPending(const ChunkCoords& coords, std::vector<unsigned char>& data) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// the queued snapshot is newer than one being written
+	const Entry* entry = nullptr;
+	auto ite = m_queued.find(coords);
+	if (ite != m_queued.end())
+		entry = &ite->second;
+	else if ((ite = m_inFlight.find(coords)) != m_inFlight.end())
+		entry = &ite->second;
+	else if ((ite = m_retry.find(coords)) != m_retry.end())
+		entry = &ite->second;
+
+	if (!entry)
+		return PendingWrite::NONE;
+	if (entry->m_delete)
+		return PendingWrite::DELETE;
+	data = *entry->m_data;
+	return PendingWrite::DATA;
+}
+
+bool ChunkWriter::Flush(int threadCount)
+{
+	double start = GetCurrentTimeSeconds();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		RequeueFailed();
+	}
+	m_wake.notify_all();
+
+	// helpers take batches next to the writer thread until nothing is left to take
+	std::vector<std::thread> helpers;
+	for (int helper = 1; helper < threadCount; helper++)
+		helpers.emplace_back([this]() {
+			Batch batch;
+			std::vector<ChunkCoords> failed;
+			for (;;)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!TakeBatch(batch))
+						return;
+				}
+				WriteBatch(batch, failed);
+				FinishBatch(batch, failed);
+			}
+		});
+	for (std::thread& helper : helpers)
+		helper.join();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_queued.empty() && m_inFlight.empty(); });
+	m_lastFlushSeconds = GetCurrentTimeSeconds() - start;
+	return m_retry.empty();
+}
+
+size_t ChunkWriter::GetQueuedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queued.size() + m_inFlight.size();
+}
+
+bool ChunkWriter::IsWrittenUpTo(size_t ticket) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const std::map<ChunkCoords, Entry>* entries : { &m_queued, &m_inFlight, &m_retry })
+		for (const auto& entry : *entries)
+			if (entry.second.m_ticket <= ticket)
+				return false;
+	return true;
+}
+
+size_t ChunkWriter::GetFailedChunkCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t count = m_retry.size();
+	for (const std::map<ChunkCoords, Entry>* entries : { &m_queued, &m_inFlight })
+		for (const auto& entry : *entries)
+			count += entry.second.m_failed ? 1 : 0;
+	return count;
+}
+
+void ChunkWriter::RunWriter()
+{
+	Batch batch;
+	std::vector<ChunkCoords> failed;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto ready = [&]() { return TakeBatch(batch) || m_stop; };
+			if (m_retry.empty())
+			{
+				m_wake.wait(lock, ready);
+			}
+			else if (!m_wake.wait_for(lock, std::chrono::duration<double>(CHUNK_WRITE_RETRY_SECONDS), ready))
+			{
+				RequeueFailed();
+				continue;
+			}
+			if (batch.empty())
+				return; // stopping with nothing left, failures are left to the owner's flush
+		}
+		WriteBatch(batch, failed);
+		FinishBatch(batch, failed);
+	}
+}
+
+void ChunkWriter::RequeueFailed()
+{
+	for (auto& entry : m_retry)
+	{
+		if (m_queued.find(entry.first) != m_queued.end())
+			continue;
+		entry.second.m_failed = true;
+		m_queued[entry.first] = std::move(entry.second);
+		m_order.push_back(entry.first);
+	}
+	m_retry.clear();
+}
+
+bool ChunkWriter::TakeBatch(Batch& batch)
+{
+	batch.clear();
+
+	// oldest first, a chunk still being written by another thread stays queued behind it
+	for (auto ite = m_order.begin(); ite != m_order.end() && batch.size() < CHUNK_WRITE_BATCH_SIZE;)
+	{
+		if (m_inFlight.find(*ite) != m_inFlight.end())
+		{
+			++ite;
+			continue;
+		}
+
+		auto entry = m_queued.find(*ite);
+		m_inFlight[*ite] = entry->second;
+		batch.emplace_back(*ite, std::move(entry->second));
+		m_queued.erase(entry);
+		ite = m_order.erase(ite);
+	}
+
+	if (!batch.empty())
+		m_space.notify_all();
+	return !batch.empty();
+}
+
+void ChunkWriter::WriteBatch(const Batch& batch, std::vector<ChunkCoords>& failed)
+{
+	failed.clear();
+
+	// grouped by region, each region is synced once after all of its chunks are written
+	std::vector<const std::pair<ChunkCoords, Entry>*> sorted;
+	for (const auto& entry : batch)
+		sorted.push_back(&entry);
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<ChunkCoords, Entry>* a, const std::pair<ChunkCoords, Entry>* b) {
+		return RegionFile::GetRegionCoords(a->first) < RegionFile::GetRegionCoords(b->first);
+	});
+
+	for (size_t first = 0; first < sorted.size();)
+	{
+		IntVec2 regionCoords = RegionFile::GetRegionCoords(sorted[first]->first);
+		size_t last = first;
+		bool hasData = false;
+		while (last < sorted.size() && RegionFile::GetRegionCoords(sorted[last]->first) == regionCoords)
+			hasData |= !sorted[last++]->second.m_delete;
+
+		// a region only holding deletes is not created
+		std::shared_ptr<RegionFile> region = m_regions->Get(regionCoords, hasData);
+		size_t firstFailed = failed.size();
+		size_t written = 0;
+		for (size_t index = first; index < last; index++)
+		{
+			const ChunkCoords& coords = sorted[index]->first;
+			const Entry& entry = sorted[index]->second;
+			bool success;
+			if (entry.m_delete)
+			{
+				std::error_code error;
+				std::filesystem::remove(std::filesystem::path(m_regions->GetChunkFilePath(coords)), error); // missing files are fine
+				success = !region || region->Erase(RegionFile::GetChunkIndex(coords));
+			}
+			else
+			{
+				success = region && region->Write(RegionFile::GetChunkIndex(coords), entry.m_data->data(), entry.m_data->size());
+				written += success ? 1 : 0;
+			}
+			if (!success)
+				failed.push_back(coords); // the region keeps the old payload until the retry lands
+		}
+
+		// nothing is known to have reached the disk, every chunk of the region is tried again
+		if (region && !region->Sync())
+		{
+			failed.resize(firstFailed);
+			for (size_t index = first; index < last; index++)
+				failed.push_back(sorted[index]->first);
+			written = 0;
+		}
+		m_written += written;
+		m_failed += failed.size() - firstFailed;
+		first = last;
+	}
+	m_batches++;
+}
+
+void ChunkWriter::FinishBatch(const Batch& batch, const std::vector<ChunkCoords>& failed)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const ChunkCoords& coords : failed)
+		{
+			// a snapshot queued meanwhile replaces the failed one and stands for its ticket too
+			auto ite = m_inFlight.find(coords);
+			auto queued = m_queued.find(coords);
+			if (queued == m_queued.end())
+				m_retry[coords] = std::move(ite->second);
+			else
+				queued->second.m_ticket = std::min(queued->second.m_ticket, ite->second.m_ticket);
+		}
+		for (const auto& entry : batch)
+			m_inFlight.erase(entry.first);
+	}
+	m_idle.notify_all();
+	m_wake.notify_all(); // chunks held back behind these can go now
+}
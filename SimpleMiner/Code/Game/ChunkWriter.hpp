@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Game/RegionFile.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t CHUNK_WRITE_QUEUE_CAPACITY = 256; // queued chunks before a save waits for the writer
+constexpr size_t CHUNK_WRITE_BATCH_SIZE     = 32;  // chunks written before one sync of every region they went to
+constexpr int    CHUNK_FLUSH_THREADS        = 4;   // writers draining the queue on shutdown
+constexpr double CHUNK_WRITE_RETRY_SECONDS  = 1.0; // failed writes wait this long before they are tried again
+
+enum class PendingWrite
+{
+	NONE,   // nothing queued, the chunk on disk is current
+	DATA,   // a newer snapshot is queued or being written
+	DELETE, // the chunk is about to be removed
+};
+
+// writes chunks into their region files on a thread of its own. a snapshot queued for a chunk replaces the one
+// still waiting, a batch is written and every region it touched synced once. a chunk torn by a crash fails its
+// checksum and generates again. a full queue blocks the saving thread until the writer catches up. a write that
+// failed keeps its snapshot, readers still see it and it is tried again until it lands or a newer one replaces it
+class ChunkWriter
+{
+public:
+	ChunkWriter(RegionCache* regions, size_t capacity = CHUNK_WRITE_QUEUE_CAPACITY);
+	~ChunkWriter(); // flushes
+
+	void         Write(const ChunkCoords& coords, std::vector<unsigned char>&& data);
+	void         Delete(const ChunkCoords& coords); // loose file of an older save included
+	PendingWrite FindPending(const ChunkCoords& coords, std::vector<unsigned char>& data) const; // what a reader must see instead of the region
+	bool         Flush(int threadCount = 1); // returns once everything queued was tried once more, false when some failed
+
+	size_t GetQueuedCount() const; // failed ones not included
+	size_t GetLastTicket() const { return m_lastTicket; } // of the latest write or delete queued
+	bool   IsWrittenUpTo(size_t ticket) const; // everything queued up to the ticket is on disk, or deleted
+	size_t GetFailedChunkCount() const; // held for a retry or being retried
+	bool   HasFailures() const { return GetFailedChunkCount() > 0; }
+	size_t GetPeakQueuedCount() const  { return m_peakQueued; }
+	size_t GetWrittenCount() const     { return m_written; }
+	size_t GetCoalescedCount() const   { return m_coalesced; }
+	size_t GetBatchCount() const       { return m_batches; }
+	size_t GetFailedCount() const      { return m_failed; } // attempts, a chunk retried twice counts twice
+	size_t GetStallCount() const       { return m_stalls; }
+	double GetStallSeconds() const     { return m_stallSeconds; }
+	double GetLastFlushSeconds() const { return m_lastFlushSeconds; }
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<const std::vector<unsigned char>> m_data; // shared with readers while it is written
+		bool m_delete = false;
+		size_t m_ticket = 0; // of the oldest snapshot it replaced, written only once this one is
+		bool m_failed = false; // queued again for a retry
+	};
+	typedef std::vector<std::pair<ChunkCoords, Entry>> Batch;
+
+	void RunWriter();
+	bool TakeBatch(Batch& batch); // false when nothing can be taken, call with the lock held
+	void WriteBatch(const Batch& batch, std::vector<ChunkCoords>& failed);
+	void FinishBatch(const Batch& batch, const std::vector<ChunkCoords>& failed);
+	void RequeueFailed(); // call with the lock held
+	void Enqueue(const ChunkCoords& coords, Entry&& entry);
+
+private:
+	mutable std::mutex           m_mutex;
+	std::condition_variable      m_wake;    // work queued or stopping
+	std::condition_variable      m_space;   // an entry left the queue
+	std::condition_variable      m_idle;    // a batch finished
+	RegionCache* const           m_regions;
+	std::map<ChunkCoords, Entry> m_queued;
+	std::map<ChunkCoords, Entry> m_inFlight; // taken by a writer, a newer snapshot of the same chunk waits in m_queued
+	std::map<ChunkCoords, Entry> m_retry;    // failed and not replaced by a newer snapshot yet
+	std::deque<ChunkCoords>      m_order;    // queued chunks, oldest first
+	size_t                       m_capacity;
+	bool                         m_stop = false;
+	std::atomic<size_t>          m_lastTicket = 0;
+	std::thread                  m_thread;
+
+	std::atomic<size_t> m_peakQueued = 0;
+	std::atomic<size_t> m_written = 0;
+	std::atomic<size_t> m_coalesced = 0;
+	std::atomic<size_t> m_batches = 0;
+	std::atomic<size_t> m_failed = 0;
+	std::atomic<size_t> m_stalls = 0;
+	double m_stallSeconds = 0.0;     // saving thread only
+	double m_lastFlushSeconds = 0.0;
+};
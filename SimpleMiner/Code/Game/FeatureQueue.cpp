@@ -0,0 +1,260 @@
+#include "Game/FeatureQueue.hpp"
+#include "Game/RegionFile.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+constexpr const char*  FEATURE_QUEUE_MAGIC = "SFTQ";
+constexpr unsigned int FEATURE_QUEUE_VERSION = 1;
+constexpr size_t       FEATURE_QUEUE_HEADER_SIZE = 12; // magic, version, world seed
+constexpr size_t       FEATURE_QUEUE_READ_RECORDS = 1024;
+
+// MakeRecord: Queued blocks are stored like journal records, with the chunk they are queued for
+static ChunkJournalRecord MakeRecord(const ChunkCoords& coords, const BlockEdit& edit)
+{
+	ChunkJournalRecord record;
+	record.m_chunkX = coords.x;
+	record.m_chunkY = coords.y;
+	record.m_blockIndex = edit.m_blockIndex;
+	record.m_blockId = edit.m_blockId;
+	record.m_check = ChunkJournal::GetRecordCheck(record);
+	return record;
+}
+
+FeatureQueue::FeatureQueue(const std::string& folderPath)
+	: m_filePath(folderPath + "/" + FEATURE_QUEUE_FILE_NAME)
+	, m_fileEnabled(true)
+{
+}
+
+FeatureQueue::~FeatureQueue()
+{
+	Close(); // appended records are on the OS already, the provider rewrites the file on shutdown
+}
+
+void FeatureQueue::Push(std::map<ChunkCoords, std::vector<BlockEdit>>& blocks)
+{
+	if (blocks.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& entry : blocks)
+	{
+		std::vector<BlockEdit>& pending = m_pending[entry.first];
+		pending.insert(pending.end(), entry.second.begin(), entry.second.end());
+		m_pendingBlockCount += entry.second.size();
+		m_newTargets.push_back(entry.first);
+
+		if (!m_fileEnabled)
+			continue;
+		for (const BlockEdit& edit : entry.second)
+			m_unflushed.push_back(MakeRecord(entry.first, edit));
+	}
+}
+
+bool FeatureQueue::Take(const ChunkCoords& target, std::vector<BlockEdit>& blocks)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto ite = m_pending.find(target);
+	if (ite == m_pending.end())
+		return false;
+
+	m_pendingBlockCount -= ite->second.size();
+	blocks.swap(ite->second);
+	m_pending.erase(ite);
+	return true;
+}
+
+void FeatureQueue::TakeNewTargets(std::vector<ChunkCoords>& targets)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	targets.swap(m_newTargets);
+	m_newTargets.clear();
+}
+
+void FeatureQueue::GetPendingTargets(std::vector<ChunkCoords>& targets) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	targets.clear();
+	for (auto& entry : m_pending)
+		targets.push_back(entry.first);
+}
+
+size_t FeatureQueue::GetPendingChunkCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending.size();
+}
+
+size_t FeatureQueue::GetPendingBlockCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pendingBlockCount;
+}
+
+void FeatureQueue::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pending.clear();
+	m_newTargets.clear();
+	m_pendingBlockCount = 0;
+	m_unflushed.clear();
+}
+
+void FeatureQueue::SetFileEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> fileLock(m_fileMutex);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fileEnabled = enabled && !m_filePath.empty();
+	if (m_fileEnabled)
+		return;
+
+	// blocks pushed while disabled are only written by the next rewrite
+	m_unflushed.clear();
+	Close();
+}
+
+size_t FeatureQueue::Load()
+{
+	if (m_filePath.empty())
+		return 0;
+
+	FILE* file = OpenFile(m_filePath, "rb");
+	if (!file)
+		return 0;
+
+	unsigned char header[FEATURE_QUEUE_HEADER_SIZE];
+	unsigned int version = 0;
+	unsigned int worldSeed = 0;
+	bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, FEATURE_QUEUE_MAGIC, 4) == 0;
+	memcpy(&version, header + 4, 4);
+	memcpy(&worldSeed, header + 8, 4);
+	if (!valid || version != FEATURE_QUEUE_VERSION || worldSeed != m_worldSeed)
+	{
+		fclose(file);
+		return 0;
+	}
+
+	// a torn tail from a crash mid append ends the read, every record before it is whole
+	std::map<ChunkCoords, std::vector<BlockEdit>> blocks;
+	size_t count = 0;
+	std::vector<ChunkJournalRecord> records(FEATURE_QUEUE_READ_RECORDS);
+	bool torn = false;
+	while (!torn)
+	{
+		size_t read = fread(records.data(), sizeof(ChunkJournalRecord), records.size(), file);
+		for (size_t index = 0; index < read && !torn; index++)
+		{
+			const ChunkJournalRecord& record = records[index];
+			torn = record.m_check != ChunkJournal::GetRecordCheck(record) || record.m_blockIndex >= CHUNK_SIZE_BLOCKS;
+			if (!torn)
+			{
+				blocks[ChunkCoords(record.m_chunkX, record.m_chunkY)].push_back({ record.m_blockIndex, record.m_blockId });
+				count++;
+			}
+		}
+		if (read < records.size())
+			break;
+	}
+	fclose(file);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& entry : blocks)
+	{
+		std::vector<BlockEdit>& pending = m_pending[entry.first];
+		pending.insert(pending.end(), entry.second.begin(), entry.second.end());
+	}
+	m_pendingBlockCount += count;
+	return count;
+}
+
+bool FeatureQueue::Flush()
+{
+	// a rewrite running on a worker writes these blocks as well or leaves them for the next flush
+	std::unique_lock<std::mutex> fileLock(m_fileMutex, std::try_to_lock);
+	if (!fileLock.owns_lock())
+		return true;
+
+	std::vector<ChunkJournalRecord> records;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		records.swap(m_unflushed);
+	}
+	if (records.empty())
+		return true;
+
+	// the file read on start may be of another seed or torn, the first flush and one after a failed append start it over
+	if (!m_file)
+		return RewriteFile();
+
+	size_t bytes = records.size() * sizeof(ChunkJournalRecord);
+	if (fwrite(records.data(), 1, bytes, m_file) == bytes && fflush(m_file) == 0)
+		return true;
+
+	Close();
+	return RewriteFile();
+}
+
+bool FeatureQueue::Rewrite()
+{
+	std::lock_guard<std::mutex> fileLock(m_fileMutex);
+	return RewriteFile();
+}
+
+bool FeatureQueue::RewriteFile()
+{
+	std::vector<ChunkJournalRecord> records;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_fileEnabled)
+			return true;
+
+		m_unflushed.clear(); // they are pending as well
+		records.reserve(m_pendingBlockCount);
+		for (const auto& entry : m_pending)
+			for (const BlockEdit& edit : entry.second)
+				records.push_back(MakeRecord(entry.first, edit));
+	}
+	Close();
+
+	std::error_code error;
+	if (records.empty())
+	{
+		std::filesystem::remove(std::filesystem::path(m_filePath), error);
+		return !error;
+	}
+
+	// the new file lands under a temporary name first, a crash meanwhile still finds the old one
+	std::string tempPath = m_filePath + ".tmp";
+	FILE* file = OpenFile(tempPath, "wb");
+	size_t bytes = records.size() * sizeof(ChunkJournalRecord);
+	bool written = file && WriteHeader(file) && fwrite(records.data(), 1, bytes, file) == bytes && SyncFile(file);
+	if (file)
+		fclose(file);
+	if (written)
+		std::filesystem::rename(std::filesystem::path(tempPath), std::filesystem::path(m_filePath), error);
+	if (!written || error)
+	{
+		std::filesystem::remove(std::filesystem::path(tempPath), error);
+		return false; // tried again by the next flush with blocks or the next rewrite
+	}
+
+	m_file = OpenFile(m_filePath, "ab");
+	return m_file != nullptr;
+}
+
+bool FeatureQueue::WriteHeader(FILE* file) const
+{
+	unsigned char header[FEATURE_QUEUE_HEADER_SIZE];
+	memcpy(header, FEATURE_QUEUE_MAGIC, 4);
+	memcpy(header + 4, &FEATURE_QUEUE_VERSION, 4);
+	memcpy(header + 8, &m_worldSeed, 4);
+	return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+void FeatureQueue::Close()
+{
+	if (m_file)
+		fclose(m_file);
+	m_file = nullptr;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Game/Chunk.hpp"
+#include "Game/ChunkJournal.hpp"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr const char* FEATURE_QUEUE_FILE_NAME = "Features.queue";
+
+// feature blocks that reached out of the chunk placing them, held until the target chunk generates or loads.
+// pushed from generation jobs and taken on the main thread. what is pushed is appended to a file once a frame,
+// the file is rewritten with the pending blocks only when an autosave round starts and on shutdown. blocks taken
+// meanwhile stay in the file, the chunk they landed in journals them like any edit
+class FeatureQueue
+{
+public:
+	FeatureQueue() = default; // in memory only
+	explicit FeatureQueue(const std::string& folderPath);
+	FeatureQueue(const FeatureQueue&) = delete;
+	FeatureQueue& operator=(const FeatureQueue&) = delete;
+	~FeatureQueue();
+
+	void   Push(std::map<ChunkCoords, std::vector<BlockEdit>>& blocks);
+	bool   Take(const ChunkCoords& target, std::vector<BlockEdit>& blocks);
+	void   TakeNewTargets(std::vector<ChunkCoords>& targets); // targets pushed to since the last call
+	void   GetPendingTargets(std::vector<ChunkCoords>& targets) const;
+	size_t GetPendingChunkCount() const;
+	size_t GetPendingBlockCount() const;
+	void   Clear(); // the file is left as it is until the next write
+
+	// main thread only but for Rewrite, nothing is written while the file is disabled
+	void   SetWorldSeed(unsigned int worldSeed) { m_worldSeed = worldSeed; } // files of another seed are not read
+	void   SetFileEnabled(bool enabled);
+	size_t Load(); // blocks read into the pending ones
+	bool   Flush(); // blocks pushed since the last flush, the first one rewrites the file. skipped while a rewrite runs
+	bool   Rewrite(); // pending blocks only, the file is removed when there are none. may run on a worker
+
+private:
+	bool   RewriteFile(); // m_fileMutex held
+	bool   WriteHeader(FILE* file) const;
+	void   Close();
+
+private:
+	mutable std::mutex                            m_mutex;
+	std::mutex                                    m_fileMutex; // the file and its handle, held by a whole rewrite
+	std::map<ChunkCoords, std::vector<BlockEdit>> m_pending;
+	std::vector<ChunkCoords>                      m_newTargets;
+	size_t                                        m_pendingBlockCount = 0;
+	std::vector<ChunkJournalRecord>               m_unflushed; // pushed since the last flush, guarded by m_mutex
+	std::string                                   m_filePath;
+	FILE*                                         m_file = nullptr;
+	unsigned int                                  m_worldSeed = 0;
+	bool                                          m_fileEnabled = false;
+};
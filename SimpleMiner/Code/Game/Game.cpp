@@ -10,6 +10,7 @@
 #include "BlockMaterialDef.hpp"
 #include "BlockSetDefinition.hpp"
 #include "SoundClip.hpp"
+#include "WorldCommands.hpp"
 
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Core/DevConsole.hpp"
@@ -154,6 +155,7 @@ bool InitializeDebugCommands()
 	g_theEventSystem->SubscribeEventCallbackFunction("Disconnect", Command_Disconnect);
 	g_theEventSystem->SubscribeEventCallbackFunction("Stop", Command_Stop);
 	g_theEventSystem->SubscribeEventCallbackFunction("RaycastDebugToggle", Command_RaycastDebugToggle);
+	InitializeWorldCommands();
 	DebugAddMessage("", -5.0f, Rgba8(255, 0, 0), Rgba8(0, 255, 0));
 
 	NET_CLIENT->RegisterHandler(PacketType::MESSAGE, [](Packet& pkt) {
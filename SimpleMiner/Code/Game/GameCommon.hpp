@@ -18,6 +18,7 @@ constexpr unsigned int CHUNK_SIZE_BITWIDTH_XY = 4;
 constexpr unsigned int CHUNK_SIZE_BITWIDTH_Z  = 7;
 constexpr unsigned int CHUNK_SIZE_XY          = 1 << CHUNK_SIZE_BITWIDTH_XY;
 constexpr unsigned int CHUNK_SIZE_Z           = 1 << CHUNK_SIZE_BITWIDTH_Z;
+constexpr unsigned int CHUNK_SIZE_COLUMNS     = CHUNK_SIZE_XY * CHUNK_SIZE_XY;
 constexpr unsigned int CHUNK_SIZE_BLOCKS      = CHUNK_SIZE_XY * CHUNK_SIZE_XY * CHUNK_SIZE_Z;
 constexpr unsigned int CHUNK_MAX_X            = CHUNK_SIZE_XY - 1;
 constexpr unsigned int CHUNK_MAX_Y            = CHUNK_SIZE_XY - 1;
@@ -0,0 +1,125 @@
+#include "Game/WorldCommands.hpp"
+
+#include "Game/BlockDef.hpp"
+#include "Game/ChunkProvider.hpp"
+#include "Game/WorldGenerator.hpp"
+
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <vector>
+
+std::vector<unsigned char> SnapshotLighting(const ChunkProvider* provider)
+{
+	std::vector<unsigned char> lights;
+	lights.reserve(provider->GetLoadedChunks().size() * CHUNK_SIZE_BLOCKS);
+	for (auto& entry : provider->GetLoadedChunks())
+		for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+		{
+			const Block& block = entry.second->m_blockArray[index];
+			lights.push_back((unsigned char)((block.GetOutdoorLightInfluence() << 4) | block.GetIndoorLightInfluence()));
+		}
+	return lights;
+}
+
+bool Command_LightingDeterminismTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 4);
+
+	HeadlessWorld world(radius);
+	ChunkProvider* provider = world.GetProvider();
+
+	provider->ProcessAllDirtyLighting(false);
+	std::vector<unsigned char> incremental = SnapshotLighting(provider);
+
+	double start = GetCurrentTimeSeconds();
+	provider->RelightAllChunks(false);
+	double serialTime = GetCurrentTimeSeconds() - start;
+	std::vector<unsigned char> serial = SnapshotLighting(provider);
+
+	start = GetCurrentTimeSeconds();
+	provider->RelightAllChunks(true);
+	double parallelTime = GetCurrentTimeSeconds() - start;
+	std::vector<unsigned char> parallel = SnapshotLighting(provider);
+
+	size_t chunks = provider->GetLoadedChunks().size();
+
+	bool pass = serial == parallel && serial == incremental;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Lighting determinism: %s (%d chunks)", pass ? "PASS" : "FAIL", (int)chunks));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Full relight: serial %.2fms, parallel %.2fms, speedup %.2fx", serialTime * 1000.0, parallelTime * 1000.0, serialTime / parallelTime));
+	return true;
+}
+
+double TimeLightingEdit(ChunkProvider* provider, const std::vector<WorldCoords>& blocks, BlockId blockId, size_t& updates)
+{
+	size_t updatesBefore = provider->GetLightingUpdateCount();
+	double start = GetCurrentTimeSeconds();
+	for (auto& coords : blocks)
+		provider->SetBlockId(coords, blockId);
+	provider->ProcessAllDirtyLighting(false);
+	double elapsed = GetCurrentTimeSeconds() - start;
+	updates = provider->GetLightingUpdateCount() - updatesBefore;
+	return elapsed;
+}
+
+bool Command_LightingRemovalBenchmark(EventArgs& args)
+{
+	UNUSED(args);
+
+	constexpr int NUM_SCENARIOS = 3;
+	const char* scenarioNames[NUM_SCENARIOS] = { "glowstone removal", "roof placement", "roof removal" };
+	const char* methodNames[2] = { "relaxation", "two-phase" };
+	double seconds[2][NUM_SCENARIOS] = {};
+	size_t updates[2][NUM_SCENARIOS] = {};
+	std::vector<unsigned char> results[2][NUM_SCENARIOS];
+
+	for (int method = 0; method < 2; method++)
+	{
+		HeadlessWorld world(3);
+		ChunkProvider* provider = world.GetProvider();
+		provider->SetLightRemovalEnabled(method == 1);
+		provider->ProcessAllDirtyLighting(false);
+
+		// a closed cave under the origin chunk lit by a single glowstone
+		int caveZ = Max(FindSurfaceHeight(provider, 8, 8) - 12, 8);
+		for (int z = caveZ - 3; z <= caveZ + 3; z++)
+			for (int y = 1; y < CHUNK_SIZE_XY; y++)
+				for (int x = 1; x < CHUNK_SIZE_XY; x++)
+					provider->SetBlockId(WorldCoords(x, y, z), Blocks::BLOCK_AIR);
+		provider->SetBlockId(WorldCoords(8, 8, caveZ), Blocks::BLOCK_GLOWSTONE);
+		provider->ProcessAllDirtyLighting(false);
+
+		seconds[method][0] = TimeLightingEdit(provider, { WorldCoords(8, 8, caveZ) }, Blocks::BLOCK_AIR, updates[method][0]);
+		results[method][0] = SnapshotLighting(provider);
+
+		// a flat roof above the terrain shading two chunks around the origin
+		std::vector<WorldCoords> roof;
+		int roofZ = 0;
+		for (int y = -CHUNK_SIZE_XY; y < CHUNK_SIZE_XY * 2; y++)
+			for (int x = -CHUNK_SIZE_XY; x < CHUNK_SIZE_XY * 2; x++)
+				roofZ = Max(roofZ, FindSurfaceHeight(provider, x, y) + 3);
+		roofZ = Min(roofZ, CHUNK_MAX_Z);
+		for (int y = -CHUNK_SIZE_XY; y < CHUNK_SIZE_XY * 2; y++)
+			for (int x = -CHUNK_SIZE_XY; x < CHUNK_SIZE_XY * 2; x++)
+				roof.push_back(WorldCoords(x, y, roofZ));
+
+		seconds[method][1] = TimeLightingEdit(provider, roof, Blocks::BLOCK_STONE, updates[method][1]);
+		results[method][1] = SnapshotLighting(provider);
+		seconds[method][2] = TimeLightingEdit(provider, roof, Blocks::BLOCK_AIR, updates[method][2]);
+		results[method][2] = SnapshotLighting(provider);
+	}
+
+	for (int scenario = 0; scenario < NUM_SCENARIOS; scenario++)
+	{
+		bool match = results[0][scenario] == results[1][scenario];
+		g_theConsole->AddLine(match ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("%s: %s %.2fms (%d updates), %s %.2fms (%d updates), results %s",
+			scenarioNames[scenario],
+			methodNames[0], seconds[0][scenario] * 1000.0, (int)updates[0][scenario],
+			methodNames[1], seconds[1][scenario] * 1000.0, (int)updates[1][scenario],
+			match ? "match" : "DIFFER"));
+	}
+	return true;
+}
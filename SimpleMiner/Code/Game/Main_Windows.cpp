@@ -11,7 +11,6 @@ bool DebugMain();
 int WINAPI WinMain(HINSTANCE applicationInstanceHandle, HINSTANCE, LPSTR commandLineString, int)
 {
 	UNUSED(applicationInstanceHandle);
-	UNUSED(commandLineString);
 	::CoInitialize(nullptr);
 
 	g_theApp = new App();
@@ -19,7 +18,8 @@ int WINAPI WinMain(HINSTANCE applicationInstanceHandle, HINSTANCE, LPSTR command
 	if (!DebugMain())
 	{
 		g_theApp->Startup();
-		g_theApp->RunMainLoop();
+		if (!g_theApp->RunCommandLine(commandLineString))
+			g_theApp->RunMainLoop();
 		g_theApp->Shutdown();
 	}
 	
@@ -0,0 +1,409 @@
+#include "Game/NoiseKernels.hpp"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+//------------------------------------------------------------------------------------------------
+// constants of the squirrel smooth noise implementation
+constexpr float        PERLIN_OCTAVE_OFFSET = 0.636764989593174f; // irrational offset added to each octave
+constexpr float        PERLIN_NORMALIZE     = 1.f / 0.662578106f; // 2d perlin is in [-.662578106,.662578106]
+constexpr int          NOISE_PRIME_Y        = 198491317;
+constexpr unsigned int SQ5_BIT_NOISE1       = 0xd2a80a3f;
+constexpr unsigned int SQ5_BIT_NOISE2       = 0xa884f197;
+constexpr unsigned int SQ5_BIT_NOISE3       = 0x6C736F4B;
+constexpr unsigned int SQ5_BIT_NOISE4       = 0xB79F3ABB;
+constexpr unsigned int SQ5_BIT_NOISE5       = 0x1b56c4f5;
+
+// unit gradients in 8 quarter-cardinal directions
+alignas(32) static const float GRADIENTS_X[8] = { +0.923879533f, +0.382683432f, -0.382683432f, -0.923879533f, -0.923879533f, -0.382683432f, +0.382683432f, +0.923879533f };
+alignas(32) static const float GRADIENTS_Y[8] = { +0.382683432f, +0.923879533f, +0.923879533f, +0.382683432f, -0.382683432f, -0.923879533f, -0.923879533f, -0.382683432f };
+
+static NoiseKernel s_noiseKernel = GetBestNoiseKernel();
+
+//------------------------------------------------------------------------------------------------
+NoiseKernel GetBestNoiseKernel()
+{
+	int info[4] = {};
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse41   = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx     = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && avx && osxsave && (_xgetbv(0) & 0x6) == 0x6) // os saves ymm registers
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2)
+		return NoiseKernel::AVX2;
+	if (sse41)
+		return NoiseKernel::SSE;
+	return NoiseKernel::SCALAR;
+}
+
+NoiseKernel GetNoiseKernel()
+{
+	return s_noiseKernel;
+}
+
+void SetNoiseKernel(NoiseKernel kernel)
+{
+	NoiseKernel best = GetBestNoiseKernel();
+	s_noiseKernel = (int)kernel > (int)best ? best : kernel;
+}
+
+const char* GetNoiseKernelName(NoiseKernel kernel)
+{
+	switch (kernel)
+	{
+	case NoiseKernel::SCALAR: return "scalar";
+	case NoiseKernel::SSE:    return "sse4.1";
+	case NoiseKernel::AVX2:   return "avx2";
+	default:                  return "unknown";
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+// scalar reference, operation order here defines the results of every kernel
+static inline unsigned int Get2dNoiseUint(int x, int y, unsigned int seed)
+{
+	unsigned int bits = (unsigned int)(x + NOISE_PRIME_Y * y);
+	bits *= SQ5_BIT_NOISE1;
+	bits += seed;
+	bits ^= (bits >> 9);
+	bits += SQ5_BIT_NOISE2;
+	bits ^= (bits >> 11);
+	bits *= SQ5_BIT_NOISE3;
+	bits ^= (bits >> 13);
+	bits += SQ5_BIT_NOISE4;
+	bits ^= (bits >> 15);
+	bits *= SQ5_BIT_NOISE5;
+	bits ^= (bits >> 17);
+	return bits;
+}
+
+static inline float FastFloor(float f)
+{
+	return f >= 0.f ? (float)(int)f : (float)((int)f - 1);
+}
+
+static inline float SmoothStep(float t)
+{
+	return t * t * (3.f - (2.f * t));
+}
+
+static float ComputePerlinNoise2dScalar(float posX, float posY, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed)
+{
+	float totalNoise = 0.f;
+	float totalAmplitude = 0.f;
+	float currentAmplitude = 1.f;
+	float invScale = 1.f / scale;
+	float currentX = posX * invScale;
+	float currentY = posY * invScale;
+
+	for (unsigned int octave = 0; octave < numOctaves; octave++)
+	{
+		float minX = FastFloor(currentX);
+		float minY = FastFloor(currentY);
+		int westX = (int)minX;
+		int southY = (int)minY;
+
+		unsigned int noiseSW = Get2dNoiseUint(westX,     southY,     seed);
+		unsigned int noiseSE = Get2dNoiseUint(westX + 1, southY,     seed);
+		unsigned int noiseNW = Get2dNoiseUint(westX,     southY + 1, seed);
+		unsigned int noiseNE = Get2dNoiseUint(westX + 1, southY + 1, seed);
+
+		float dispWestX  = currentX - minX;
+		float dispSouthY = currentY - minY;
+		float dispEastX  = currentX - (minX + 1.f);
+		float dispNorthY = currentY - (minY + 1.f);
+
+		float dotSW = GRADIENTS_X[noiseSW & 7] * dispWestX + GRADIENTS_Y[noiseSW & 7] * dispSouthY;
+		float dotSE = GRADIENTS_X[noiseSE & 7] * dispEastX + GRADIENTS_Y[noiseSE & 7] * dispSouthY;
+		float dotNW = GRADIENTS_X[noiseNW & 7] * dispWestX + GRADIENTS_Y[noiseNW & 7] * dispNorthY;
+		float dotNE = GRADIENTS_X[noiseNE & 7] * dispEastX + GRADIENTS_Y[noiseNE & 7] * dispNorthY;
+
+		float weightEast = SmoothStep(dispWestX);
+		float weightNorth = SmoothStep(dispSouthY);
+		float weightWest = 1.f - weightEast;
+		float weightSouth = 1.f - weightNorth;
+
+		float blendSouth = (weightEast * dotSE) + (weightWest * dotSW);
+		float blendNorth = (weightEast * dotNE) + (weightWest * dotNW);
+		float blendTotal = (weightSouth * blendSouth) + (weightNorth * blendNorth);
+
+		totalNoise += (blendTotal * PERLIN_NORMALIZE) * currentAmplitude;
+		totalAmplitude += currentAmplitude;
+		currentAmplitude *= octavePersistence;
+		currentX = currentX * octaveScale + PERLIN_OCTAVE_OFFSET;
+		currentY = currentY * octaveScale + PERLIN_OCTAVE_OFFSET;
+		seed++;
+	}
+
+	if (renormalize && totalAmplitude > 0.f)
+	{
+		totalNoise /= totalAmplitude;
+		totalNoise = (totalNoise * .5f) + .5f;
+		totalNoise = SmoothStep(totalNoise);
+		totalNoise = (totalNoise * 2.f) - 1.f;
+	}
+	return totalNoise;
+}
+
+//------------------------------------------------------------------------------------------------
+// sse4.1, gradients are looked up through memory since there is no 8 lane permute
+static inline __m128i Get2dNoiseUint4(__m128i x, __m128i y, __m128i seed)
+{
+	__m128i bits = _mm_add_epi32(x, _mm_mullo_epi32(y, _mm_set1_epi32(NOISE_PRIME_Y)));
+	bits = _mm_mullo_epi32(bits, _mm_set1_epi32((int)SQ5_BIT_NOISE1));
+	bits = _mm_add_epi32(bits, seed);
+	bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 9));
+	bits = _mm_add_epi32(bits, _mm_set1_epi32((int)SQ5_BIT_NOISE2));
+	bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 11));
+	bits = _mm_mullo_epi32(bits, _mm_set1_epi32((int)SQ5_BIT_NOISE3));
+	bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 13));
+	bits = _mm_add_epi32(bits, _mm_set1_epi32((int)SQ5_BIT_NOISE4));
+	bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 15));
+	bits = _mm_mullo_epi32(bits, _mm_set1_epi32((int)SQ5_BIT_NOISE5));
+	bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 17));
+	return bits;
+}
+
+static inline __m128 FastFloor4(__m128 f, __m128i& truncated)
+{
+	truncated = _mm_cvttps_epi32(f);
+	__m128i negative = _mm_castps_si128(_mm_cmplt_ps(f, _mm_setzero_ps()));
+	truncated = _mm_add_epi32(truncated, negative); // all ones is -1
+	return _mm_cvtepi32_ps(truncated);
+}
+
+static inline __m128 SmoothStep4(__m128 t)
+{
+	__m128 t2 = _mm_mul_ps(t, t);
+	return _mm_mul_ps(t2, _mm_sub_ps(_mm_set1_ps(3.f), _mm_mul_ps(_mm_set1_ps(2.f), t)));
+}
+
+static inline __m128 GradientDot4(__m128i noise, __m128 dispX, __m128 dispY)
+{
+	alignas(16) int indices[4];
+	_mm_store_si128((__m128i*)indices, _mm_and_si128(noise, _mm_set1_epi32(7)));
+	__m128 gradX = _mm_setr_ps(GRADIENTS_X[indices[0]], GRADIENTS_X[indices[1]], GRADIENTS_X[indices[2]], GRADIENTS_X[indices[3]]);
+	__m128 gradY = _mm_setr_ps(GRADIENTS_Y[indices[0]], GRADIENTS_Y[indices[1]], GRADIENTS_Y[indices[2]], GRADIENTS_Y[indices[3]]);
+	return _mm_add_ps(_mm_mul_ps(gradX, dispX), _mm_mul_ps(gradY, dispY));
+}
+
+static void ComputePerlinNoise2dSSE(float* results, const float* posX, const float* posY, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128i oneInt = _mm_set1_epi32(1);
+
+	__m128 totalNoise = _mm_setzero_ps();
+	float totalAmplitude = 0.f;
+	float currentAmplitude = 1.f;
+	__m128 invScale = _mm_set1_ps(1.f / scale);
+	__m128 currentX = _mm_mul_ps(_mm_loadu_ps(posX), invScale);
+	__m128 currentY = _mm_mul_ps(_mm_loadu_ps(posY), invScale);
+
+	for (unsigned int octave = 0; octave < numOctaves; octave++)
+	{
+		__m128i westX, southY;
+		__m128 minX = FastFloor4(currentX, westX);
+		__m128 minY = FastFloor4(currentY, southY);
+		__m128i eastX = _mm_add_epi32(westX, oneInt);
+		__m128i northY = _mm_add_epi32(southY, oneInt);
+		__m128i seedInt = _mm_set1_epi32((int)seed);
+
+		__m128i noiseSW = Get2dNoiseUint4(westX, southY, seedInt);
+		__m128i noiseSE = Get2dNoiseUint4(eastX, southY, seedInt);
+		__m128i noiseNW = Get2dNoiseUint4(westX, northY, seedInt);
+		__m128i noiseNE = Get2dNoiseUint4(eastX, northY, seedInt);
+
+		__m128 dispWestX = _mm_sub_ps(currentX, minX);
+		__m128 dispSouthY = _mm_sub_ps(currentY, minY);
+		__m128 dispEastX = _mm_sub_ps(currentX, _mm_add_ps(minX, one));
+		__m128 dispNorthY = _mm_sub_ps(currentY, _mm_add_ps(minY, one));
+
+		__m128 dotSW = GradientDot4(noiseSW, dispWestX, dispSouthY);
+		__m128 dotSE = GradientDot4(noiseSE, dispEastX, dispSouthY);
+		__m128 dotNW = GradientDot4(noiseNW, dispWestX, dispNorthY);
+		__m128 dotNE = GradientDot4(noiseNE, dispEastX, dispNorthY);
+
+		__m128 weightEast = SmoothStep4(dispWestX);
+		__m128 weightNorth = SmoothStep4(dispSouthY);
+		__m128 weightWest = _mm_sub_ps(one, weightEast);
+		__m128 weightSouth = _mm_sub_ps(one, weightNorth);
+
+		__m128 blendSouth = _mm_add_ps(_mm_mul_ps(weightEast, dotSE), _mm_mul_ps(weightWest, dotSW));
+		__m128 blendNorth = _mm_add_ps(_mm_mul_ps(weightEast, dotNE), _mm_mul_ps(weightWest, dotNW));
+		__m128 blendTotal = _mm_add_ps(_mm_mul_ps(weightSouth, blendSouth), _mm_mul_ps(weightNorth, blendNorth));
+
+		__m128 octaveNoise = _mm_mul_ps(blendTotal, _mm_set1_ps(PERLIN_NORMALIZE));
+		totalNoise = _mm_add_ps(totalNoise, _mm_mul_ps(octaveNoise, _mm_set1_ps(currentAmplitude)));
+		totalAmplitude += currentAmplitude;
+		currentAmplitude *= octavePersistence;
+		currentX = _mm_add_ps(_mm_mul_ps(currentX, _mm_set1_ps(octaveScale)), _mm_set1_ps(PERLIN_OCTAVE_OFFSET));
+		currentY = _mm_add_ps(_mm_mul_ps(currentY, _mm_set1_ps(octaveScale)), _mm_set1_ps(PERLIN_OCTAVE_OFFSET));
+		seed++;
+	}
+
+	if (renormalize && totalAmplitude > 0.f)
+	{
+		totalNoise = _mm_div_ps(totalNoise, _mm_set1_ps(totalAmplitude));
+		totalNoise = _mm_add_ps(_mm_mul_ps(totalNoise, _mm_set1_ps(.5f)), _mm_set1_ps(.5f));
+		totalNoise = SmoothStep4(totalNoise);
+		totalNoise = _mm_sub_ps(_mm_mul_ps(totalNoise, _mm_set1_ps(2.f)), one);
+	}
+	_mm_storeu_ps(results, totalNoise);
+}
+
+//------------------------------------------------------------------------------------------------
+// avx2, the 8 gradients fit a single permute. mul and add stay separate, fma would change results
+static inline __m256i Get2dNoiseUint8(__m256i x, __m256i y, __m256i seed)
+{
+	__m256i bits = _mm256_add_epi32(x, _mm256_mullo_epi32(y, _mm256_set1_epi32(NOISE_PRIME_Y)));
+	bits = _mm256_mullo_epi32(bits, _mm256_set1_epi32((int)SQ5_BIT_NOISE1));
+	bits = _mm256_add_epi32(bits, seed);
+	bits = _mm256_xor_si256(bits, _mm256_srli_epi32(bits, 9));
+	bits = _mm256_add_epi32(bits, _mm256_set1_epi32((int)SQ5_BIT_NOISE2));
+	bits = _mm256_xor_si256(bits, _mm256_srli_epi32(bits, 11));
+	bits = _mm256_mullo_epi32(bits, _mm256_set1_epi32((int)SQ5_BIT_NOISE3));
+	bits = _mm256_xor_si256(bits, _mm256_srli_epi32(bits, 13));
+	bits = _mm256_add_epi32(bits, _mm256_set1_epi32((int)SQ5_BIT_NOISE4));
+	bits = _mm256_xor_si256(bits, _mm256_srli_epi32(bits, 15));
+	bits = _mm256_mullo_epi32(bits, _mm256_set1_epi32((int)SQ5_BIT_NOISE5));
+	bits = _mm256_xor_si256(bits, _mm256_srli_epi32(bits, 17));
+	return bits;
+}
+
+static inline __m256 FastFloor8(__m256 f, __m256i& truncated)
+{
+	truncated = _mm256_cvttps_epi32(f);
+	__m256i negative = _mm256_castps_si256(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ));
+	truncated = _mm256_add_epi32(truncated, negative);
+	return _mm256_cvtepi32_ps(truncated);
+}
+
+static inline __m256 SmoothStep8(__m256 t)
+{
+	__m256 t2 = _mm256_mul_ps(t, t);
+	return _mm256_mul_ps(t2, _mm256_sub_ps(_mm256_set1_ps(3.f), _mm256_mul_ps(_mm256_set1_ps(2.f), t)));
+}
+
+static inline __m256 GradientDot8(__m256i noise, __m256 dispX, __m256 dispY, __m256 gradientsX, __m256 gradientsY)
+{
+	__m256 gradX = _mm256_permutevar8x32_ps(gradientsX, noise); // only the low 3 bits pick a lane
+	__m256 gradY = _mm256_permutevar8x32_ps(gradientsY, noise);
+	return _mm256_add_ps(_mm256_mul_ps(gradX, dispX), _mm256_mul_ps(gradY, dispY));
+}
+
+static void ComputePerlinNoise2dAVX2(float* results, const float* posX, const float* posY, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed)
+{
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256i oneInt = _mm256_set1_epi32(1);
+	const __m256 gradientsX = _mm256_load_ps(GRADIENTS_X);
+	const __m256 gradientsY = _mm256_load_ps(GRADIENTS_Y);
+
+	__m256 totalNoise = _mm256_setzero_ps();
+	float totalAmplitude = 0.f;
+	float currentAmplitude = 1.f;
+	__m256 invScale = _mm256_set1_ps(1.f / scale);
+	__m256 currentX = _mm256_mul_ps(_mm256_loadu_ps(posX), invScale);
+	__m256 currentY = _mm256_mul_ps(_mm256_loadu_ps(posY), invScale);
+
+	for (unsigned int octave = 0; octave < numOctaves; octave++)
+	{
+		__m256i westX, southY;
+		__m256 minX = FastFloor8(currentX, westX);
+		__m256 minY = FastFloor8(currentY, southY);
+		__m256i eastX = _mm256_add_epi32(westX, oneInt);
+		__m256i northY = _mm256_add_epi32(southY, oneInt);
+		__m256i seedInt = _mm256_set1_epi32((int)seed);
+
+		__m256i noiseSW = Get2dNoiseUint8(westX, southY, seedInt);
+		__m256i noiseSE = Get2dNoiseUint8(eastX, southY, seedInt);
+		__m256i noiseNW = Get2dNoiseUint8(westX, northY, seedInt);
+		__m256i noiseNE = Get2dNoiseUint8(eastX, northY, seedInt);
+
+		__m256 dispWestX = _mm256_sub_ps(currentX, minX);
+		__m256 dispSouthY = _mm256_sub_ps(currentY, minY);
+		__m256 dispEastX = _mm256_sub_ps(currentX, _mm256_add_ps(minX, one));
+		__m256 dispNorthY = _mm256_sub_ps(currentY, _mm256_add_ps(minY, one));
+
+		__m256 dotSW = GradientDot8(noiseSW, dispWestX, dispSouthY, gradientsX, gradientsY);
+		__m256 dotSE = GradientDot8(noiseSE, dispEastX, dispSouthY, gradientsX, gradientsY);
+		__m256 dotNW = GradientDot8(noiseNW, dispWestX, dispNorthY, gradientsX, gradientsY);
+		__m256 dotNE = GradientDot8(noiseNE, dispEastX, dispNorthY, gradientsX, gradientsY);
+
+		__m256 weightEast = SmoothStep8(dispWestX);
+		__m256 weightNorth = SmoothStep8(dispSouthY);
+		__m256 weightWest = _mm256_sub_ps(one, weightEast);
+		__m256 weightSouth = _mm256_sub_ps(one, weightNorth);
+
+		__m256 blendSouth = _mm256_add_ps(_mm256_mul_ps(weightEast, dotSE), _mm256_mul_ps(weightWest, dotSW));
+		__m256 blendNorth = _mm256_add_ps(_mm256_mul_ps(weightEast, dotNE), _mm256_mul_ps(weightWest, dotNW));
+		__m256 blendTotal = _mm256_add_ps(_mm256_mul_ps(weightSouth, blendSouth), _mm256_mul_ps(weightNorth, blendNorth));
+
+		__m256 octaveNoise = _mm256_mul_ps(blendTotal, _mm256_set1_ps(PERLIN_NORMALIZE));
+		totalNoise = _mm256_add_ps(totalNoise, _mm256_mul_ps(octaveNoise, _mm256_set1_ps(currentAmplitude)));
+		totalAmplitude += currentAmplitude;
+		currentAmplitude *= octavePersistence;
+		currentX = _mm256_add_ps(_mm256_mul_ps(currentX, _mm256_set1_ps(octaveScale)), _mm256_set1_ps(PERLIN_OCTAVE_OFFSET));
+		currentY = _mm256_add_ps(_mm256_mul_ps(currentY, _mm256_set1_ps(octaveScale)), _mm256_set1_ps(PERLIN_OCTAVE_OFFSET));
+		seed++;
+	}
+
+	if (renormalize && totalAmplitude > 0.f)
+	{
+		totalNoise = _mm256_div_ps(totalNoise, _mm256_set1_ps(totalAmplitude));
+		totalNoise = _mm256_add_ps(_mm256_mul_ps(totalNoise, _mm256_set1_ps(.5f)), _mm256_set1_ps(.5f));
+		totalNoise = SmoothStep8(totalNoise);
+		totalNoise = _mm256_sub_ps(_mm256_mul_ps(totalNoise, _mm256_set1_ps(2.f)), one);
+	}
+	_mm256_storeu_ps(results, totalNoise);
+}
+
+//------------------------------------------------------------------------------------------------
+void ComputePerlinNoise2dBatch(float* results, const float* posX, const float* posY, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed)
+{
+	ComputePerlinNoise2dBatch(s_noiseKernel, results, posX, posY, count, scale, numOctaves, octavePersistence, octaveScale, renormalize, seed);
+}
+
+void ComputePerlinNoise2dBatch(NoiseKernel kernel, float* results, const float* posX, const float* posY, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed)
+{
+	int index = 0;
+	if (kernel == NoiseKernel::AVX2)
+	{
+		for (; index + 8 <= count; index += 8)
+			ComputePerlinNoise2dAVX2(results + index, posX + index, posY + index, scale, numOctaves, octavePersistence, octaveScale, renormalize, seed);
+	}
+	if (kernel == NoiseKernel::AVX2 || kernel == NoiseKernel::SSE)
+	{
+		for (; index + 4 <= count; index += 4)
+			ComputePerlinNoise2dSSE(results + index, posX + index, posY + index, scale, numOctaves, octavePersistence, octaveScale, renormalize, seed);
+	}
+	for (; index < count; index++)
+		results[index] = ComputePerlinNoise2dScalar(posX[index], posY[index], scale, numOctaves, octavePersistence, octaveScale, renormalize, seed);
+}
+
+void ComputePerlinNoise2dRow(float* results, int startX, int y, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed, int stepX)
+{
+	constexpr int ROW_BATCH = 64;
+
+	float posX[ROW_BATCH];
+	float posY[ROW_BATCH];
+	for (int index = 0; index < ROW_BATCH; index++)
+		posY[index] = float(y);
+
+	for (int offset = 0; offset < count; offset += ROW_BATCH)
+	{
+		int batch = count - offset < ROW_BATCH ? count - offset : ROW_BATCH;
+		for (int index = 0; index < batch; index++)
+			posX[index] = float(startX + (offset + index) * stepX);
+		ComputePerlinNoise2dBatch(results + offset, posX, posY, batch, scale, numOctaves, octavePersistence, octaveScale, renormalize, seed);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// batched 2d perlin noise, same algorithm and parameters as Compute2dPerlinNoise.
+// every kernel produces bit identical results, the scalar kernel is the reference.
+enum class NoiseKernel
+{
+	SCALAR,
+	SSE,  // 4 positions per step
+	AVX2, // 8 positions per step
+	COUNT,
+};
+
+NoiseKernel GetBestNoiseKernel();          // widest kernel the cpu supports
+NoiseKernel GetNoiseKernel();
+void        SetNoiseKernel(NoiseKernel kernel); // clamped to the widest supported kernel
+const char* GetNoiseKernelName(NoiseKernel kernel);
+
+void ComputePerlinNoise2dBatch(float* results, const float* posX, const float* posY, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed);
+void ComputePerlinNoise2dBatch(NoiseKernel kernel, float* results, const float* posX, const float* posY, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed);
+
+// one row of block columns, x from startX to startX + (count - 1) * stepX
+void ComputePerlinNoise2dRow(float* results, int startX, int y, int count, float scale, unsigned int numOctaves, float octavePersistence, float octaveScale, bool renormalize, unsigned int seed, int stepX = 1);
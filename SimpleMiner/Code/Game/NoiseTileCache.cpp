@@ -0,0 +1,161 @@
+#include "Game/NoiseTileCache.hpp"
+
+#include <vector>
+
+NoiseTileCache::NoiseTileCache(size_t capacity)
+	: m_capacity(capacity)
+{
+}
+
+void NoiseTileCache::ComputeField(float* values, int stride, const IntVec2& worldMins, const IntVec2& size, unsigned int seed, NoiseFieldFunc func, int latticeStep)
+{
+	if (latticeStep <= 1)
+	{
+		for (int y = 0; y < size.y; y++)
+			func(values + y * stride, size.x, IntVec3(worldMins.x, worldMins.y + y, 0), 1, seed);
+		return;
+	}
+
+	// lattice points sit on world multiples of the step, so any rect sees the same values
+	int mask = latticeStep - 1;
+	IntVec2 latticeMins = IntVec2(worldMins.x & ~mask, worldMins.y & ~mask);
+	int latticeSizeX = ((worldMins.x + size.x - 1 - latticeMins.x) / latticeStep) + 2;
+	int latticeSizeY = ((worldMins.y + size.y - 1 - latticeMins.y) / latticeStep) + 2;
+
+	std::vector<float> lattice(latticeSizeX * latticeSizeY);
+	for (int y = 0; y < latticeSizeY; y++)
+		func(lattice.data() + y * latticeSizeX, latticeSizeX, IntVec3(latticeMins.x, latticeMins.y + y * latticeStep, 0), latticeStep, seed);
+
+	float invStep = 1.0f / float(latticeStep);
+	for (int y = 0; y < size.y; y++)
+	{
+		int offsetY = worldMins.y + y - latticeMins.y;
+		int cellY = offsetY / latticeStep;
+		float fractionY = float(offsetY & mask) * invStep;
+		for (int x = 0; x < size.x; x++)
+		{
+			int offsetX = worldMins.x + x - latticeMins.x;
+			int cellX = offsetX / latticeStep;
+			float fractionX = float(offsetX & mask) * invStep;
+
+			const float* cell = lattice.data() + cellX + cellY * latticeSizeX;
+			float south = cell[0] + (cell[1] - cell[0]) * fractionX;
+			float north = cell[latticeSizeX] + (cell[latticeSizeX + 1] - cell[latticeSizeX]) * fractionX;
+			values[x + y * stride] = south + (north - south) * fractionY;
+		}
+	}
+}
+
+void NoiseTileCache::Sample(float* values, int stride, const IntVec2& worldMins, const IntVec2& size, int field, unsigned int seed, NoiseFieldFunc func, int latticeStep)
+{
+	if (m_capacity == 0)
+	{
+		ComputeField(values, stride, worldMins, size, seed, func, latticeStep);
+		return;
+	}
+
+	IntVec2 worldMaxs = IntVec2(worldMins.x + size.x - 1, worldMins.y + size.y - 1);
+	IntVec2 tileMins = IntVec2(worldMins.x >> NOISE_TILE_SIZE_BITWIDTH, worldMins.y >> NOISE_TILE_SIZE_BITWIDTH);
+	IntVec2 tileMaxs = IntVec2(worldMaxs.x >> NOISE_TILE_SIZE_BITWIDTH, worldMaxs.y >> NOISE_TILE_SIZE_BITWIDTH);
+
+	Key key;
+	key.m_field = field;
+	key.m_seed = seed;
+	key.m_latticeStep = latticeStep;
+	for (key.m_tileCoords.y = tileMins.y; key.m_tileCoords.y <= tileMaxs.y; key.m_tileCoords.y++)
+		for (key.m_tileCoords.x = tileMins.x; key.m_tileCoords.x <= tileMaxs.x; key.m_tileCoords.x++)
+		{
+			std::shared_ptr<const NoiseTile> tile = GetTile(key, func);
+
+			// copy the overlap of this tile and the requested rect
+			IntVec2 tileOrigin = IntVec2(key.m_tileCoords.x << NOISE_TILE_SIZE_BITWIDTH, key.m_tileCoords.y << NOISE_TILE_SIZE_BITWIDTH);
+			int minX = worldMins.x > tileOrigin.x ? worldMins.x : tileOrigin.x;
+			int minY = worldMins.y > tileOrigin.y ? worldMins.y : tileOrigin.y;
+			int maxX = worldMaxs.x < tileOrigin.x + NOISE_TILE_SIZE - 1 ? worldMaxs.x : tileOrigin.x + NOISE_TILE_SIZE - 1;
+			int maxY = worldMaxs.y < tileOrigin.y + NOISE_TILE_SIZE - 1 ? worldMaxs.y : tileOrigin.y + NOISE_TILE_SIZE - 1;
+			for (int y = minY; y <= maxY; y++)
+				for (int x = minX; x <= maxX; x++)
+					values[(x - worldMins.x) + (y - worldMins.y) * stride] = tile->m_values[(x - tileOrigin.x) + (y - tileOrigin.y) * NOISE_TILE_SIZE];
+		}
+}
+
+std::shared_ptr<const NoiseTile> NoiseTileCache::GetTile(const Key& key, NoiseFieldFunc func)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto ite = m_tiles.find(key);
+		if (ite != m_tiles.end())
+		{
+			m_lru.splice(m_lru.begin(), m_lru, ite->second.m_lruPos);
+			m_hits++;
+			return ite->second.m_tile;
+		}
+	}
+
+	// compute outside the lock, two jobs racing on the same tile just produce the same values
+	m_misses++;
+	std::shared_ptr<NoiseTile> tile = std::make_shared<NoiseTile>();
+	IntVec2 tileOrigin = IntVec2(key.m_tileCoords.x << NOISE_TILE_SIZE_BITWIDTH, key.m_tileCoords.y << NOISE_TILE_SIZE_BITWIDTH);
+	ComputeField(tile->m_values, NOISE_TILE_SIZE, tileOrigin, IntVec2(NOISE_TILE_SIZE, NOISE_TILE_SIZE), key.m_seed, func, key.m_latticeStep);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto ite = m_tiles.find(key);
+	if (ite != m_tiles.end())
+		return ite->second.m_tile;
+
+	m_lru.push_front(key);
+	Entry& entry = m_tiles[key];
+	entry.m_tile = tile;
+	entry.m_lruPos = m_lru.begin();
+	EvictOverCapacity();
+	return tile;
+}
+
+void NoiseTileCache::EvictOverCapacity()
+{
+	// tiles still held by a sampling job stay alive through their shared pointer
+	while (m_tiles.size() > m_capacity)
+	{
+		m_tiles.erase(m_lru.back());
+		m_lru.pop_back();
+	}
+}
+
+void NoiseTileCache::SetCapacity(size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_capacity = capacity;
+	EvictOverCapacity();
+}
+
+void NoiseTileCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_tiles.clear();
+	m_lru.clear();
+}
+
+float NoiseTileCache::GetHitRate() const
+{
+	size_t total = m_hits + m_misses;
+	return total ? (float)m_hits / (float)total : 0.0f;
+}
+
+void NoiseTileCache::ResetStats()
+{
+	m_hits = 0;
+	m_misses = 0;
+}
+
+bool NoiseTileCache::Key::operator<(const Key& other) const
+{
+	if (m_field != other.m_field)
+		return m_field < other.m_field;
+	if (m_seed != other.m_seed)
+		return m_seed < other.m_seed;
+	if (m_latticeStep != other.m_latticeStep)
+		return m_latticeStep < other.m_latticeStep;
+	if (m_tileCoords.y != other.m_tileCoords.y)
+		return m_tileCoords.y < other.m_tileCoords.y;
+	return m_tileCoords.x < other.m_tileCoords.x;
+}
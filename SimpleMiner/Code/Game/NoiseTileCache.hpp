@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Engine/Math/IntVec2.hpp"
+#include "Engine/Math/IntVec3.hpp"
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+constexpr int    NOISE_TILE_SIZE_BITWIDTH = 4;
+constexpr int    NOISE_TILE_SIZE          = 1 << NOISE_TILE_SIZE_BITWIDTH; // tiles line up with chunks
+constexpr size_t NOISE_TILE_CACHE_CAPACITY = 8192;                          // ~8MB of tiles, about 1000 chunks worth of fields
+
+typedef void (*NoiseFieldFunc)(float* values, int count, const IntVec3& rowStart, int step, unsigned int seed); // fills a row of columns along +x, step blocks apart
+
+struct NoiseTile
+{
+	float m_values[NOISE_TILE_SIZE * NOISE_TILE_SIZE];
+};
+
+// 2d noise fields sampled per world column, computed a tile at a time and shared between adjacent chunks.
+// thread safe, generation jobs sample it concurrently, least recently used tiles are evicted first.
+class NoiseTileCache
+{
+public:
+	NoiseTileCache(size_t capacity = NOISE_TILE_CACHE_CAPACITY);
+
+	// latticeStep > 1 samples the field on a lattice of that spacing (power of two) and interpolates bilinearly
+	void   Sample(float* values, int stride, const IntVec2& worldMins, const IntVec2& size, int field, unsigned int seed, NoiseFieldFunc func, int latticeStep = 1);
+	void   SetCapacity(size_t capacity); // 0 bypasses the cache
+	void   Clear();
+
+	size_t GetHitCount() const  { return m_hits; }
+	size_t GetMissCount() const { return m_misses; }
+	float  GetHitRate() const;
+	void   ResetStats();
+
+private:
+	struct Key
+	{
+		int          m_field;
+		unsigned int m_seed;
+		int          m_latticeStep;
+		IntVec2      m_tileCoords;
+
+		bool operator<(const Key& other) const;
+	};
+	struct Entry
+	{
+		std::shared_ptr<const NoiseTile> m_tile;
+		std::list<Key>::iterator         m_lruPos;
+	};
+
+	static void ComputeField(float* values, int stride, const IntVec2& worldMins, const IntVec2& size, unsigned int seed, NoiseFieldFunc func, int latticeStep);
+	std::shared_ptr<const NoiseTile> GetTile(const Key& key, NoiseFieldFunc func);
+	void EvictOverCapacity();
+
+private:
+	std::mutex          m_mutex;
+	std::map<Key, Entry> m_tiles;
+	std::list<Key>      m_lru; // front is most recently used
+	size_t              m_capacity = NOISE_TILE_CACHE_CAPACITY;
+	std::atomic<size_t> m_hits = 0;
+	std::atomic<size_t> m_misses = 0;
+};
@@ -0,0 +1,640 @@
+#include "Game/RegionFile.hpp"
+
+#include "Engine/Core/ByteBuffer.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/StringUtils.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr const char*  REGION_FILE_MAGIC = "SREG";
+constexpr unsigned int REGION_FILE_VERSION = 1;
+
+// OpenFile: fopen without the deprecation of the secure CRT
+FILE* OpenFile(const std::string& filePath, const char* mode)
+{
+#ifdef _WIN32
+	FILE* file = nullptr;
+	return fopen_s(&file, filePath.c_str(), mode) == 0 ? file : nullptr;
+#else
+	return fopen(filePath.c_str(), mode);
+#endif
+}
+
+// SyncFile: Push the written bytes past the OS cache onto the disk
+bool SyncFile(FILE* file)
+{
+	if (fflush(file) != 0)
+		return false;
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+// SeekFile: fseek with 64 bit offsets, region files may outgrow a long
+static bool SeekFile(FILE* file, long long offset, int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, origin) == 0;
+#else
+	return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+}
+
+static long long TellFile(FILE* file)
+{
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return (long long)ftello(file);
+#endif
+}
+
+static unsigned int GetSectorCount(size_t bytes)
+{
+	return (unsigned int)((bytes + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+#ifdef _WIN32
+	// the region stays writable through its own handle while mapped
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)size.QuadPart;
+#else
+	int file = open(filePath.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file); // the mapping holds on to the file
+	if (view == MAP_FAILED)
+		return false;
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!m_data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap((void*)m_data, m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+RegionFile::~RegionFile()
+{
+	Close();
+}
+
+bool RegionFile::Open(const std::string& filePath, bool create)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_filePath = filePath;
+	for (RegionEntry& entry : m_entries)
+		entry = RegionEntry();
+
+	m_file = OpenFile(filePath, "r+b");
+	if (!m_file)
+	{
+		if (!create)
+			return false;
+
+		// an empty header, every chunk missing
+		m_file = OpenFile(filePath, "w+b");
+		if (!m_file)
+			return false;
+		std::vector<unsigned char> header(REGION_HEADER_SECTORS * REGION_SECTOR_SIZE, 0);
+		memcpy(header.data(), REGION_FILE_MAGIC, 4);
+		memcpy(header.data() + 4, &REGION_FILE_VERSION, sizeof(REGION_FILE_VERSION));
+		if (fwrite(header.data(), 1, header.size(), m_file) != header.size() || fflush(m_file) != 0)
+		{
+			fclose(m_file);
+			m_file = nullptr;
+			return false;
+		}
+		m_fileSectors = REGION_HEADER_SECTORS;
+		m_usedSectors.assign(m_fileSectors, true);
+		return true;
+	}
+
+	unsigned char preamble[REGION_PREAMBLE_SIZE];
+	unsigned int version = 0;
+	bool valid = fread(preamble, 1, REGION_PREAMBLE_SIZE, m_file) == REGION_PREAMBLE_SIZE && memcmp(preamble, REGION_FILE_MAGIC, 4) == 0;
+	if (valid)
+		memcpy(&version, preamble + 4, sizeof(version));
+	valid = valid && version == REGION_FILE_VERSION && fread(m_entries, sizeof(RegionEntry), REGION_CHUNK_COUNT, m_file) == REGION_CHUNK_COUNT;
+	if (!valid || !SeekFile(m_file, 0, SEEK_END))
+	{
+		fclose(m_file); // not a region file, left alone rather than overwritten
+		m_file = nullptr;
+		return false;
+	}
+	m_fileSectors = GetSectorCount((size_t)TellFile(m_file));
+
+	// entries reaching past the end of a truncated file read as missing chunks
+	m_usedSectors.assign(m_fileSectors, false);
+	for (unsigned int sector = 0; sector < REGION_HEADER_SECTORS && sector < m_fileSectors; sector++)
+		m_usedSectors[sector] = true;
+	for (RegionEntry& entry : m_entries)
+	{
+		if (entry.m_sector != 0 && !IsEntryValid(entry))
+			entry = RegionEntry();
+		MarkSectors(entry, true);
+	}
+	return true;
+}
+
+void RegionFile::Close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_file)
+		fclose(m_file);
+	m_file = nullptr;
+	m_mapping = nullptr;
+	m_oldMappings.clear();
+	m_usedSectors.clear();
+	m_staged.clear(); // never synced, dropped as a crash would
+	m_fileSectors = 0;
+}
+
+bool RegionFile::Read(int chunkIndex, std::vector<unsigned char>& data)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const RegionEntry& entry = m_entries[chunkIndex];
+	if (!m_file || entry.m_sector == 0)
+		return false;
+
+	data.resize(entry.m_length);
+	if (!SeekFile(m_file, (long long)entry.m_sector * REGION_SECTOR_SIZE, SEEK_SET) || fread(data.data(), 1, entry.m_length, m_file) != entry.m_length)
+		return false;
+	return Checksum(data.data(), data.size()) == entry.m_checksum;
+}
+
+bool RegionFile::ReadMapped(int chunkIndex, std::shared_ptr<const MappedFile>& mapping, const unsigned char*& data, size_t& size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const RegionEntry& entry = m_entries[chunkIndex];
+	if (!m_file || entry.m_sector == 0)
+		return false;
+
+	// writes are flushed as they happen, a mapping sees them unless the payload was appended past its end
+	size_t end = (size_t)entry.m_sector * REGION_SECTOR_SIZE + entry.m_length;
+	if (!m_mapping || m_mapping->GetSize() < end)
+	{
+		std::shared_ptr<MappedFile> remapped = std::make_shared<MappedFile>();
+		if (!remapped->Open(m_filePath) || remapped->GetSize() < end)
+			return false;
+		if (m_mapping)
+			m_oldMappings.push_back(m_mapping); // readers still holding it keep it until they are done
+		m_mapping = remapped;
+	}
+
+	mapping = m_mapping;
+	data = m_mapping->GetData() + (size_t)entry.m_sector * REGION_SECTOR_SIZE;
+	size = entry.m_length;
+	return Checksum(data, size) == entry.m_checksum;
+}
+
+bool RegionFile::Write(int chunkIndex, const unsigned char* data, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_file || size == 0)
+		return false;
+
+	// a copy staged before and never published is not needed anymore
+	auto staged = m_staged.find(chunkIndex);
+	if (staged != m_staged.end())
+		MarkSectors(staged->second, false);
+
+	unsigned int sectors = GetSectorCount(size);
+	unsigned int sector = AllocateSectors(sectors);
+	if (!SeekFile(m_file, (long long)sector * REGION_SECTOR_SIZE, SEEK_SET) || fwrite(data, 1, size, m_file) != size)
+		return false;
+	if (sector + sectors > m_fileSectors)
+	{
+		// pad the last sector, the file stays a whole number of sectors
+		static const unsigned char zeros[REGION_SECTOR_SIZE] = {};
+		size_t padding = sectors * REGION_SECTOR_SIZE - size;
+		if (padding > 0 && fwrite(zeros, 1, padding, m_file) != padding)
+			return false;
+		m_fileSectors = sector + sectors;
+		m_usedSectors.resize(m_fileSectors, false);
+		m_appended++;
+	}
+	else
+	{
+		m_reusedGaps++;
+	}
+
+	RegionEntry entry;
+	entry.m_sector = sector;
+	entry.m_length = (unsigned int)size;
+	entry.m_checksum = Checksum(data, size);
+	MarkSectors(entry, true);
+	m_staged[chunkIndex] = entry;
+	return true;
+}
+
+bool RegionFile::Erase(int chunkIndex)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_file)
+		return false;
+
+	auto staged = m_staged.find(chunkIndex);
+	if (staged != m_staged.end())
+		MarkSectors(staged->second, false);
+	if (m_entries[chunkIndex].m_sector == 0)
+	{
+		if (staged != m_staged.end())
+			m_staged.erase(staged);
+		return true;
+	}
+	m_staged[chunkIndex] = RegionEntry();
+	return true;
+}
+
+bool RegionFile::Sync()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_file || !SyncFile(m_file))
+		return false;
+	if (m_staged.empty())
+		return true;
+
+	// the payloads are on disk, now the entries. the sectors they replace stay taken until those are on disk as well
+	std::vector<RegionEntry> replaced;
+	bool written = true;
+	for (auto& staged : m_staged)
+	{
+		replaced.push_back(m_entries[staged.first]);
+		m_entries[staged.first] = staged.second;
+		written = WriteEntry(staged.first) && written;
+	}
+	m_staged.clear();
+	if (!written || !SyncFile(m_file))
+		return false; // the old sectors stay taken, a crash may still need them
+
+	for (const RegionEntry& entry : replaced)
+		MarkSectors(entry, false);
+	return true;
+}
+
+bool RegionFile::HasChunk(int chunkIndex) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries[chunkIndex].m_sector != 0;
+}
+
+size_t RegionFile::GetChunkCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t count = 0;
+	for (const RegionEntry& entry : m_entries)
+		if (entry.m_sector != 0)
+			count++;
+	return count;
+}
+
+size_t RegionFile::GetUsedSectorCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t sectors = REGION_HEADER_SECTORS;
+	for (const RegionEntry& entry : m_entries)
+		if (entry.m_sector != 0)
+			sectors += GetSectorCount(entry.m_length);
+	return sectors;
+}
+
+size_t RegionFile::GetFileSectorCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_fileSectors;
+}
+
+IntVec2 RegionFile::GetRegionCoords(const ChunkCoords& chunkCoords)
+{
+	return IntVec2(chunkCoords.x >> REGION_SIZE_BITWIDTH, chunkCoords.y >> REGION_SIZE_BITWIDTH);
+}
+
+int RegionFile::GetChunkIndex(const ChunkCoords& chunkCoords)
+{
+	return (chunkCoords.x & (REGION_SIZE_CHUNKS - 1)) | ((chunkCoords.y & (REGION_SIZE_CHUNKS - 1)) << REGION_SIZE_BITWIDTH);
+}
+
+// Checksum: 32 bit FNV-1a
+unsigned int RegionFile::Checksum(const unsigned char* data, size_t size)
+{
+	unsigned int hash = 2166136261u;
+	for (size_t index = 0; index < size; index++)
+		hash = (hash ^ data[index]) * 16777619u;
+	return hash;
+}
+
+bool RegionFile::Compact(const std::string& filePath, RegionCompactStats& stats)
+{
+	RegionFile source;
+	if (!source.Open(filePath, false))
+		return false;
+
+	std::string packedPath = filePath + ".tmp";
+	std::error_code error;
+	std::filesystem::remove(std::filesystem::path(packedPath), error);
+	RegionFile packed;
+	if (!packed.Open(packedPath, true))
+		return false;
+
+	// payloads in index order, neighboring chunks end up next to each other. a chunk failing its checksum is dropped
+	bool success = true;
+	size_t chunks = 0;
+	std::vector<unsigned char> data;
+	for (int chunkIndex = 0; chunkIndex < REGION_CHUNK_COUNT && success; chunkIndex++)
+	{
+		if (!source.HasChunk(chunkIndex) || !source.Read(chunkIndex, data))
+			continue;
+		success = packed.Write(chunkIndex, data.data(), data.size());
+		chunks++;
+	}
+	success = success && packed.Sync();
+
+	size_t bytesBefore = source.GetFileSectorCount() * REGION_SECTOR_SIZE;
+	size_t bytesAfter = packed.GetFileSectorCount() * REGION_SECTOR_SIZE;
+	packed.Close();
+	source.Close();
+
+	if (success)
+		std::filesystem::rename(std::filesystem::path(packedPath), std::filesystem::path(filePath), error);
+	if (!success || error)
+	{
+		std::filesystem::remove(std::filesystem::path(packedPath), error);
+		return false;
+	}
+
+	stats.m_chunks += chunks;
+	stats.m_bytesBefore += bytesBefore;
+	stats.m_bytesAfter += bytesAfter;
+	return true;
+}
+
+bool RegionFile::WriteEntry(int chunkIndex)
+{
+	long long offset = (long long)(REGION_PREAMBLE_SIZE + chunkIndex * sizeof(RegionEntry));
+	return SeekFile(m_file, offset, SEEK_SET) && fwrite(&m_entries[chunkIndex], sizeof(RegionEntry), 1, m_file) == 1;
+}
+
+bool RegionFile::IsEntryValid(const RegionEntry& entry) const
+{
+	return entry.m_sector >= REGION_HEADER_SECTORS && entry.m_length > 0 && entry.m_sector + GetSectorCount(entry.m_length) <= m_fileSectors;
+}
+
+// AllocateSectors: First gap long enough, the end of the file when there is none
+unsigned int RegionFile::AllocateSectors(unsigned int sectors)
+{
+	// a reader may still decode a freed payload through a mapping, gaps wait until every mapping handed out is released
+	if (HasMappedReaders())
+		return m_fileSectors;
+
+	unsigned int run = 0;
+	for (unsigned int sector = REGION_HEADER_SECTORS; sector < m_fileSectors; sector++)
+	{
+		run = m_usedSectors[sector] ? 0 : run + 1;
+		if (run == sectors)
+			return sector + 1 - sectors;
+	}
+	return m_fileSectors;
+}
+
+void RegionFile::MarkSectors(const RegionEntry& entry, bool used)
+{
+	if (entry.m_sector == 0)
+		return;
+	unsigned int end = std::min(entry.m_sector + GetSectorCount(entry.m_length), (unsigned int)m_usedSectors.size());
+	for (unsigned int sector = entry.m_sector; sector < end; sector++)
+		m_usedSectors[sector] = used;
+}
+
+bool RegionFile::HasMappedReaders()
+{
+	m_oldMappings.erase(std::remove_if(m_oldMappings.begin(), m_oldMappings.end(), [](const std::weak_ptr<MappedFile>& mapping) {
+		return mapping.expired();
+	}), m_oldMappings.end());
+	return !m_oldMappings.empty() || (m_mapping && m_mapping.use_count() > 1);
+}
+
+RegionCache::RegionCache(const std::string& folderPath, size_t maxOpenFiles)
+	: m_folderPath(folderPath)
+	, m_maxOpenFiles(maxOpenFiles)
+{
+}
+
+std::shared_ptr<RegionFile> RegionCache::Get(const IntVec2& regionCoords, bool create)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto ite = m_files.find(regionCoords);
+	if (ite != m_files.end() && (ite->second || !create))
+		return ite->second;
+
+	// close files nobody holds once too many are open, missing regions are forgotten as well
+	for (auto closeIte = m_files.begin(); closeIte != m_files.end() && m_files.size() >= m_maxOpenFiles;)
+	{
+		if (!closeIte->second || closeIte->second.use_count() == 1)
+			closeIte = m_files.erase(closeIte);
+		else
+			++closeIte;
+	}
+
+	std::shared_ptr<RegionFile> region = std::make_shared<RegionFile>();
+	if (!region->Open(GetRegionFilePath(regionCoords), create))
+		region = nullptr; // remembered, loads in a region without a file do not look for it again
+	m_files[regionCoords] = region;
+	return region;
+}
+
+void RegionCache::CloseAll()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_files.clear();
+}
+
+std::string RegionCache::GetRegionFilePath(const IntVec2& regionCoords) const
+{
+	return Stringf("%s/Region(%d,%d).region", m_folderPath.c_str(), regionCoords.x, regionCoords.y);
+}
+
+std::string RegionCache::GetChunkFilePath(const ChunkCoords& chunkCoords) const
+{
+	return Stringf("%s/Chunk(%d,%d).chunk", m_folderPath.c_str(), chunkCoords.x, chunkCoords.y);
+}
+
+bool RegionCache::HasLooseChunkFiles() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_hasLooseFiles < 0)
+	{
+		m_hasLooseFiles = 0;
+		std::error_code error;
+		for (std::filesystem::directory_iterator ite(std::filesystem::path(m_folderPath), error); !error && ite != std::filesystem::directory_iterator(); ite.increment(error))
+		{
+			if (ite->path().extension() == ".chunk")
+			{
+				m_hasLooseFiles = 1;
+				break;
+			}
+		}
+	}
+	return m_hasLooseFiles == 1;
+}
+
+size_t RegionCache::GetOpenCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t count = 0;
+	for (auto& entry : m_files)
+		if (entry.second)
+			count++;
+	return count;
+}
+
+// ParseChunkFileName: Chunk coords of a loose "Chunk(x,y).chunk" file
+static bool ParseChunkFileName(const std::string& fileName, ChunkCoords& coords)
+{
+	const char* prefix = "Chunk(";
+	const char* suffix = ").chunk";
+	size_t prefixLength = strlen(prefix);
+	size_t suffixLength = strlen(suffix);
+	if (fileName.size() <= prefixLength + suffixLength || fileName.compare(0, prefixLength, prefix) != 0
+		|| fileName.compare(fileName.size() - suffixLength, suffixLength, suffix) != 0)
+		return false;
+
+	const char* text = fileName.c_str() + prefixLength;
+	char* end = nullptr;
+	coords.x = (int)strtol(text, &end, 10);
+	if (end == text || *end != ',')
+		return false;
+	text = end + 1;
+	coords.y = (int)strtol(text, &end, 10);
+	return end != text && *end == ')';
+}
+
+bool CompactRegionFolder(const std::string& folderPath, RegionCompactStats& stats)
+{
+	std::error_code error;
+	std::map<IntVec2, std::vector<std::pair<ChunkCoords, std::filesystem::path>>> looseFiles;
+	for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(folderPath), error))
+	{
+		ChunkCoords coords;
+		if (ParseChunkFileName(entry.path().filename().string(), coords))
+			looseFiles[RegionFile::GetRegionCoords(coords)].emplace_back(coords, entry.path());
+	}
+	if (error)
+		return false;
+
+	// loose files go into their region unless it holds a newer copy, and are removed once the region is synced.
+	// a file that cannot be read or written is kept for a later run
+	bool success = true;
+	RegionCache regions(folderPath);
+	for (auto& regionFiles : looseFiles)
+	{
+		std::shared_ptr<RegionFile> region = regions.Get(regionFiles.first, true);
+		if (!region)
+		{
+			stats.m_failedFiles += regionFiles.second.size();
+			success = false;
+			continue;
+		}
+
+		std::vector<const std::filesystem::path*> imported;
+		for (auto& looseFile : regionFiles.second)
+		{
+			int chunkIndex = RegionFile::GetChunkIndex(looseFile.first);
+			ByteBuffer buffer;
+			if (region->HasChunk(chunkIndex) || (FileReadToBuffer(buffer, looseFile.second.string()) > 0 &&
+				region->Write(chunkIndex, (const unsigned char*)buffer.GetData(), buffer.GetSize())))
+			{
+				imported.push_back(&looseFile.second);
+				continue;
+			}
+			stats.m_failedFiles++;
+			success = false;
+		}
+		if (!region->Sync())
+		{
+			stats.m_failedFiles += imported.size();
+			success = false;
+			continue;
+		}
+
+		for (const std::filesystem::path* filePath : imported)
+			if (std::filesystem::remove(*filePath, error))
+				stats.m_importedFiles++;
+	}
+	regions.CloseAll();
+
+	for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(folderPath), error))
+		if (entry.path().extension() == ".region")
+			success = RegionFile::Compact(entry.path().string(), stats) && success;
+	return success && !error;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Game/Chunk.hpp"
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr int    REGION_SIZE_BITWIDTH = 5;
+constexpr int    REGION_SIZE_CHUNKS   = 1 << REGION_SIZE_BITWIDTH; // 32x32 chunks per file
+constexpr int    REGION_CHUNK_COUNT   = REGION_SIZE_CHUNKS * REGION_SIZE_CHUNKS;
+constexpr size_t REGION_SECTOR_SIZE   = 4096;
+constexpr size_t REGION_CACHE_MAX_OPEN = 64; // open region files kept around, idle ones past it are closed
+
+// where a chunk lives in its region file, all zero for a chunk not stored
+struct RegionEntry
+{
+	unsigned int m_sector   = 0; // first sector of the payload, payloads never start inside the header
+	unsigned int m_length   = 0; // payload bytes, the last sector is padded
+	unsigned int m_checksum = 0; // of the payload, a torn write reads as a missing chunk
+};
+static_assert(sizeof(RegionEntry) == 12, "region entries are written as they are laid out");
+
+constexpr size_t REGION_PREAMBLE_SIZE = 16; // magic, version, reserved
+constexpr size_t REGION_HEADER_SIZE   = REGION_PREAMBLE_SIZE + REGION_CHUNK_COUNT * sizeof(RegionEntry);
+constexpr unsigned int REGION_HEADER_SECTORS = (unsigned int)((REGION_HEADER_SIZE + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE);
+
+struct RegionCompactStats
+{
+	size_t m_chunks        = 0;
+	size_t m_importedFiles = 0; // loose chunk files moved into a region
+	size_t m_failedFiles   = 0; // loose chunk files left in place, unreadable or not written
+	size_t m_bytesBefore   = 0;
+	size_t m_bytesAfter    = 0;
+};
+
+// read only view of a whole file, pages are read in by the OS on first access
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool Open(const std::string& filePath);
+	void Close();
+	const unsigned char* GetData() const { return m_data; }
+	size_t               GetSize() const { return m_size; }
+
+private:
+	const unsigned char* m_data = nullptr;
+	size_t               m_size = 0;
+#ifdef _WIN32
+	void* m_file    = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
+
+// chunks of a 32x32 area in one file: a header table of sector, length and checksum per chunk, then payloads
+// aligned to 4KB sectors. a live payload is never overwritten: a write goes to a free gap or the end of the file
+// and its entry is published by the next sync, after the payload itself is on disk. the old sectors become a gap
+// once the new entry is synced too, so a crash at any point leaves one of the two copies. every call locks
+class RegionFile
+{
+public:
+	RegionFile() = default;
+	RegionFile(const RegionFile&) = delete;
+	RegionFile& operator=(const RegionFile&) = delete;
+	~RegionFile();
+
+	bool Open(const std::string& filePath, bool create); // false for a missing file unless created, or a foreign one
+	void Close();
+
+	bool Read(int chunkIndex, std::vector<unsigned char>& data);  // buffered read into data
+	bool ReadMapped(int chunkIndex, std::shared_ptr<const MappedFile>& mapping, const unsigned char*& data, size_t& size); // points into the mapping, which the caller keeps alive
+	bool Write(int chunkIndex, const unsigned char* data, size_t size); // staged, reads see the old copy until synced
+	bool Erase(int chunkIndex); // staged as well
+	bool Sync(); // payloads to disk, then the entries pointing at them
+
+	bool   HasChunk(int chunkIndex) const;
+	size_t GetChunkCount() const;
+	size_t GetUsedSectorCount() const; // header and payloads, the rest are gaps
+	size_t GetFileSectorCount() const;
+	size_t GetReusedGapCount() const        { return m_reusedGaps; }
+	size_t GetAppendedCount() const         { return m_appended; }
+
+	static IntVec2      GetRegionCoords(const ChunkCoords& chunkCoords);
+	static int          GetChunkIndex(const ChunkCoords& chunkCoords); // within its region
+	static unsigned int Checksum(const unsigned char* data, size_t size);
+	static bool         Compact(const std::string& filePath, RegionCompactStats& stats); // payloads packed in a new file renamed over the old one
+
+private:
+	bool         WriteEntry(int chunkIndex);
+	bool         IsEntryValid(const RegionEntry& entry) const;
+	unsigned int AllocateSectors(unsigned int sectors);
+	void         MarkSectors(const RegionEntry& entry, bool used);
+	bool         HasMappedReaders();
+
+private:
+	mutable std::mutex          m_mutex;
+	std::string                 m_filePath;
+	FILE*                       m_file = nullptr;
+	RegionEntry                 m_entries[REGION_CHUNK_COUNT];
+	unsigned int                m_fileSectors = 0;
+	std::shared_ptr<MappedFile> m_mapping; // remapped once a payload lies past its end
+	std::vector<std::weak_ptr<MappedFile>> m_oldMappings; // replaced ones readers may still decode from
+	std::vector<bool>           m_usedSectors;   // header and payloads, the published and the staged ones
+	std::map<int, RegionEntry>  m_staged;        // written since the last sync, the header still holds the old entry
+	size_t                      m_reusedGaps = 0;
+	size_t                      m_appended = 0;
+};
+
+// region files of one world folder, shared by the loading jobs and the chunk writer. loose chunk files of older
+// saves are still read for chunks their region does not hold
+class RegionCache
+{
+public:
+	RegionCache(const std::string& folderPath, size_t maxOpenFiles = REGION_CACHE_MAX_OPEN);
+
+	std::shared_ptr<RegionFile> Get(const IntVec2& regionCoords, bool create); // nullptr when there is no file and none is created
+	void                        CloseAll();
+
+	std::string GetRegionFilePath(const IntVec2& regionCoords) const;
+	std::string GetChunkFilePath(const ChunkCoords& chunkCoords) const; // loose file of older saves
+	bool        HasLooseChunkFiles() const; // the folder is looked through once, a new world never looks for loose files
+	size_t      GetOpenCount() const;
+
+private:
+	mutable std::mutex                                  m_mutex;
+	std::string                                         m_folderPath;
+	size_t                                              m_maxOpenFiles;
+	std::map<IntVec2, std::shared_ptr<RegionFile>>      m_files; // nullptr for a region known to have no file
+	mutable int                                         m_hasLooseFiles = -1; // unknown until first asked
+};
+
+FILE* OpenFile(const std::string& filePath, const char* mode); // nullptr when it cannot be opened
+bool  SyncFile(FILE* file);
+bool CompactRegionFolder(const std::string& folderPath, RegionCompactStats& stats); // loose chunk files go into regions first
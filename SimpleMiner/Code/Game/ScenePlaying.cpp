@@ -77,6 +77,7 @@ void ScenePlaying::Shutdown()
 	m_map->Shutdown();
 	delete m_map;
 	m_map = nullptr;
+	m_game->SetCurrentMap(nullptr);
 
 	DebugRenderClear();
 }
@@ -63,6 +63,7 @@ bool SpawnInfo::LoadFromXmlElement(const XmlElement& element)
 
 extern RandomNumberGenerator rng;
 constexpr int ENV_CONSTANT_BUFFER_SLOT = CUSTOM_CONSTANT_BUFFER_SLOT_START + 1;
+constexpr int SPAWN_SEARCH_RADIUS = 64; // columns around the origin searched for dry ground
 
 int InitializeShaderConsts()
 {
@@ -108,6 +109,10 @@ void World::Initialize()
 	{
 		m_chunkManager = new ChunkProvider(this, "Map/SkyBlock", new SkyBlockWorldGenerator());
 	}
+	else if (g_gameConfigBlackboard.GetValue("worldGenerator", "Overworld") == "Density")
+	{
+		m_chunkManager = new ChunkProvider(this, "Map/Density", new DensityWorldGenerator());
+	}
 	else
 	{
 		m_chunkManager = new ChunkProvider(this, "Map/World", new OverworldWorldGenerator());
@@ -117,13 +122,24 @@ void World::Initialize()
 
 	SpawnInfo info;
 	info.m_definition = ActorDefinition::GetByName("Player");
-	info.m_position = Vec3(0, 0, 80);
+	info.m_position = FindSpawnPosition();
 	m_player[0]->Possess(AddEntity(info));
 
 	m_chunkManager->SetHotspotSize(1);
 	m_chunkManager->SetHotspot(0, m_player[0]->GetEyePosition());
 }
 
+// FindSpawnPosition: Stand on the dry ground nearest to the origin, asked from the generator before any chunk loads
+Vec3 World::FindSpawnPosition() const
+{
+	IntVec2 column;
+	ColumnInfo info;
+	if (!m_chunkManager->GetGenerator()->FindDryColumn(IntVec2(0, 0), SPAWN_SEARCH_RADIUS, column, info))
+		return Vec3(0, 0, 80); // ocean or void all around, drop in from above
+
+	return Vec3((float)column.x + 0.5f, (float)column.y + 0.5f, (float)(info.m_groundZ + 1));
+}
+
 void World::Shutdown()
 {
 	delete m_player[0];
@@ -146,6 +162,18 @@ void World::Shutdown()
 	}
 }
 
+void World::InitializeHeadless(const char* folderPath, WorldGenerator* generator)
+{
+	m_chunkManager = new ChunkProvider(this, folderPath, generator);
+}
+
+void World::ShutdownHeadless()
+{
+	m_chunkManager->UnloadAllChunks();
+	delete m_chunkManager;
+	m_chunkManager = nullptr;
+}
+
 void World::Update(float deltaSeconds)
 {
 // 	if (g_theInput->WasKeyJustPressed(KEYCODE_N))
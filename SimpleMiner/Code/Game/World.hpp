@@ -39,6 +39,7 @@ class Clock;
 class SpawnInfo;
 struct PlayerJoin;
 class Chunk;
+class WorldGenerator;
 
 namespace tinyxml2
 {
@@ -106,6 +107,8 @@ public:
 	// lifecycle handlers
 	void                         Initialize();
 	void                         Shutdown();
+	void                         InitializeHeadless(const char* folderPath, WorldGenerator* generator); // chunks only, no rendering or entities
+	void                         ShutdownHeadless();
 	void                         Update(float deltaSeconds);
 	void                         Render() const;
 	void                         RenderPost() const;
@@ -176,6 +179,7 @@ protected:
 
 private:
 	void UpdateEnvVariables() const;
+	Vec3 FindSpawnPosition() const;
 	int  GetSaltForEntity();
 	void DoCollisionForActors();
 	void PushOutOfBlockHorizontal(Vec3& position, float halfSizeXY, const WorldCoords& blockPos);
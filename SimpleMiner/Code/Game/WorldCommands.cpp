@@ -0,0 +1,246 @@
+#include "Game/WorldCommands.hpp"
+
+#include "Game/BlockDef.hpp"
+#include "Game/ChunkProvider.hpp"
+#include "Game/Game.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/World.hpp"
+#include "Game/WorldGenerator.hpp"
+#include "Game/WorldPregenerator.hpp"
+
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <climits>
+
+extern bool g_useSkyBlock;
+
+HeadlessWorld::HeadlessWorld(int chunkRadius, WorldGenerator* generator)
+{
+	m_world = new World();
+	m_world->InitializeHeadless(HEADLESS_WORLD_PATH, generator ? generator : new OverworldWorldGenerator());
+
+	m_provider = m_world->GetChunkManager();
+	m_provider->SetDiskIOEnabled(false);
+	m_provider->GetFeatureQueue().Clear(); // read from what an earlier command with disk IO saved
+	m_provider->SetHotspotSize(1);
+	LoadChunks(chunkRadius);
+}
+
+HeadlessWorld::~HeadlessWorld()
+{
+	m_provider->SetDiskIOEnabled(false);
+	m_world->ShutdownHeadless();
+	delete m_world;
+}
+
+void HeadlessWorld::LoadChunks(int chunkRadius)
+{
+	for (int y = -chunkRadius; y <= chunkRadius; y++)
+		for (int x = -chunkRadius; x <= chunkRadius; x++)
+			m_provider->LoadChunk(ChunkCoords(x, y));
+	m_provider->FinishUpChunkGeneration();
+}
+
+void HeadlessWorld::DeleteChunkFiles(int chunkRadius)
+{
+	for (int y = -chunkRadius; y <= chunkRadius; y++)
+		for (int x = -chunkRadius; x <= chunkRadius; x++)
+			m_provider->DeleteChunkFile(ChunkCoords(x, y));
+}
+
+int FindSurfaceHeight(const ChunkProvider* provider, int x, int y)
+{
+	for (int z = CHUNK_MAX_Z; z > 0; z--)
+		if (provider->GetBlockId(WorldCoords(x, y, z)) != Blocks::BLOCK_AIR)
+			return z;
+	return 0;
+}
+
+std::map<ChunkCoords, std::vector<BlockId>> SnapshotBlocks(const ChunkProvider* provider)
+{
+	std::map<ChunkCoords, std::vector<BlockId>> blocks;
+	for (auto& entry : provider->GetLoadedChunks())
+	{
+		std::vector<BlockId>& chunkBlocks = blocks[entry.first];
+		chunkBlocks.resize(CHUNK_SIZE_BLOCKS);
+		for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+			chunkBlocks[index] = entry.second->m_blockArray[index].GetBlockId();
+	}
+	return blocks;
+}
+
+bool Command_ChunkLoadQueueTest(EventArgs& args)
+{
+	int frames = args.GetValue("frames", 200);
+
+	// hotspot in chunk (0, 0) facing +x, the first activation builds the queue and spends this frame's tickets
+	HeadlessWorld world(0);
+	ChunkProvider* provider = world.GetProvider();
+	provider->SetHotspot(0, Vec3(8.0f, 8.0f, 80.0f), Vec3(1.0f, 0.0f, 0.0f));
+	provider->BeginFrame();
+	std::vector<ChunkCoords> order(provider->GetLoadQueue().rbegin(), provider->GetLoadQueue().rend());
+
+	// nearest first within the view cone and outside of it, the cone ahead of the rest
+	size_t outOfOrder = 0;
+	size_t aheadEarly = 0;
+	size_t behindEarly = 0;
+	int lastAhead = 0;
+	int lastOther = 0;
+	for (size_t index = 0; index < order.size(); index++)
+	{
+		int distanceSquared = order[index].GetLengthSquared();
+		bool ahead = order[index].x > 0 && 4 * order[index].x * order[index].x >= distanceSquared; // within 60 degrees of +x
+		int& last = ahead ? lastAhead : lastOther;
+		if (distanceSquared < last)
+			outOfOrder++;
+		last = distanceSquared;
+
+		if (index < order.size() / 4)
+		{
+			if (order[index].x > 0)
+				aheadEarly++;
+			else if (order[index].x < 0)
+				behindEarly++;
+		}
+	}
+
+	// moving and turning a little inside the chunk keeps the queue, crossing into the next chunk rebuilds it once
+	size_t rebuilds = provider->GetLoadQueueRebuildCount();
+	double activationTime = 0.0;
+	double slowestFrame = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		provider->SetHotspot(0, Vec3(1.0f + 14.0f * (float)(frame % 8) / 8.0f, 8.0f, 80.0f), Vec3(1.0f, 0.1f * (float)(frame % 3), 0.0f));
+		double start = GetCurrentTimeSeconds();
+		provider->BeginFrame();
+		double elapsed = GetCurrentTimeSeconds() - start;
+		activationTime += elapsed;
+		slowestFrame = Max(slowestFrame, elapsed);
+	}
+	size_t stillRebuilds = provider->GetLoadQueueRebuildCount() - rebuilds;
+	provider->SetHotspot(0, Vec3(24.0f, 8.0f, 80.0f), Vec3(1.0f, 0.0f, 0.0f));
+	provider->BeginFrame();
+	size_t movedRebuilds = provider->GetLoadQueueRebuildCount() - rebuilds - stillRebuilds;
+
+	bool pass = outOfOrder == 0 && aheadEarly > behindEarly && stillRebuilds == 0 && movedRebuilds == 1;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Chunk load queue: %s (%d queued, %d out of order, first quarter %d ahead / %d behind, %d rebuilds standing, %d after crossing a chunk)",
+		pass ? "PASS" : "FAIL", (int)order.size(), (int)outOfOrder, (int)aheadEarly, (int)behindEarly, (int)stillRebuilds, (int)movedRebuilds));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Chunk activation: %.3fms/frame average, %.3fms slowest over %d frames",
+		activationTime * 1000.0 / frames, slowestFrame * 1000.0, frames));
+	return true;
+}
+
+// GetGameWorldFolder: Save folder of the game world, the sky block one or that of the configured generator
+std::string GetGameWorldFolder(bool skyBlock)
+{
+	if (skyBlock)
+		return "Map/SkyBlock";
+	return g_gameConfigBlackboard.GetValue("worldGenerator", "Overworld") == "Density" ? "Map/Density" : "Map/World";
+}
+
+// PregenerateWorld radius=16 [x=0 y=0] or minX= minY= maxX= maxY=, in chunks, skyblock=true for the sky block world,
+// otherwise the world of the configured generator.
+// writes into the save folder of the game world, run it from the title screen
+bool Command_PregenerateWorld(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 16);
+	int centerX = args.GetValue("x", 0);
+	int centerY = args.GetValue("y", 0);
+	bool skyBlock = args.GetValue("skyblock", g_useSkyBlock);
+
+	PregenerationSettings settings;
+	settings.m_folderPath = GetGameWorldFolder(skyBlock);
+	settings.m_mins = ChunkCoords(args.GetValue("minX", centerX - radius), args.GetValue("minY", centerY - radius));
+	settings.m_maxs = ChunkCoords(args.GetValue("maxX", centerX + radius), args.GetValue("maxY", centerY + radius));
+	settings.m_radius = args.GetValue("minX", INT_MAX) == INT_MAX ? radius : -1; // a box given by its corners is filled whole
+	settings.m_batchSize = args.GetValue("batch", settings.m_batchSize);
+
+	WorldGenerator* generator = nullptr;
+	if (skyBlock)
+		generator = new SkyBlockWorldGenerator();
+	else if (settings.m_folderPath == "Map/Density")
+		generator = new DensityWorldGenerator();
+	else
+		generator = new OverworldWorldGenerator();
+	WorldPregenerator pregenerator(settings, generator);
+	pregenerator.Run();
+
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Pregeneration of %s done: %d chunks generated, %d already on disk, %d reopened for trees, %.2fs, %.1f chunks/s",
+		settings.m_folderPath.c_str(), pregenerator.GetGeneratedChunkCount(), pregenerator.GetSkippedChunkCount(), pregenerator.GetPatchedChunkCount(),
+		pregenerator.GetElapsedSeconds(), pregenerator.GetChunksPerSecond()));
+	return true;
+}
+
+// CompactRegions [folder=Map/World] or skyblock=true, moves loose chunk files of older saves into region files and
+// squeezes out the gaps rewrites left behind. the world must not be loaded, run it from the title screen
+bool Command_CompactRegions(EventArgs& args)
+{
+	// a loaded world keeps its region files open and writes them from the chunk writer
+	if (g_theGame && g_theGame->GetCurrentMap())
+	{
+		g_theConsole->AddLine(DevConsole::LOG_WARN, "CompactRegions needs the world unloaded, leave the game first");
+		return false;
+	}
+
+	std::string folder = args.GetValue("folder", GetGameWorldFolder(args.GetValue("skyblock", g_useSkyBlock)));
+
+	double start = GetCurrentTimeSeconds();
+	RegionCompactStats stats;
+	bool success = CompactRegionFolder(folder, stats);
+	double seconds = GetCurrentTimeSeconds() - start;
+
+	std::string result = Stringf("Compaction of %s %s: %d chunks, %d loose files imported, %d kept, %.2fMB to %.2fMB, %.2fs", folder.c_str(), success ? "done" : "FAILED",
+		(int)stats.m_chunks, (int)stats.m_importedFiles, (int)stats.m_failedFiles, (double)stats.m_bytesBefore / (1024.0 * 1024.0), (double)stats.m_bytesAfter / (1024.0 * 1024.0), seconds);
+	g_theConsole->AddLine(success ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, result);
+	DebuggerPrintf("%s\n", result.c_str());
+	return true;
+}
+
+struct WorldCommand
+{
+	const char*           m_name;
+	EventCallbackFunction m_function;
+};
+
+static const WorldCommand WORLD_COMMANDS[] =
+{
+	{ "LightingDeterminismTest",  Command_LightingDeterminismTest },
+	{ "LightingRemovalBenchmark", Command_LightingRemovalBenchmark },
+	{ "WorldGenBenchmark",        Command_WorldGenBenchmark },
+	{ "WorldGenDeterminismTest",  Command_WorldGenDeterminismTest },
+	{ "ColumnRunTerrainTest",     Command_ColumnRunTerrainTest },
+	{ "CoarseSamplingBenchmark",  Command_CoarseSamplingBenchmark },
+	{ "ChunkSaveTest",            Command_ChunkSaveTest },
+	{ "NoiseEquivalenceTest",     Command_NoiseEquivalenceTest },
+	{ "NoiseBenchmark",           Command_NoiseBenchmark },
+	{ "DensityGenBenchmark",      Command_DensityGenBenchmark },
+	{ "PregenerateWorld",         Command_PregenerateWorld },
+	{ "SurfaceQueryTest",         Command_SurfaceQueryTest },
+	{ "ChunkLoadQueueTest",       Command_ChunkLoadQueueTest },
+	{ "ChunkAsyncLoadTest",       Command_ChunkAsyncLoadTest },
+	{ "ChunkWriterTest",          Command_ChunkWriterTest },
+	{ "RegionFileTest",           Command_RegionFileTest },
+	{ "CompactRegions",           Command_CompactRegions },
+	{ "ChunkLoadBenchmark",       Command_ChunkLoadBenchmark },
+	{ "ChunkCodecBenchmark",      Command_ChunkCodecBenchmark },
+	{ "AutosaveTest",             Command_AutosaveTest },
+};
+
+bool InitializeWorldCommands()
+{
+	for (const WorldCommand& command : WORLD_COMMANDS)
+		g_theEventSystem->SubscribeEventCallbackFunction(command.m_name, command.m_function);
+	return true;
+}
+
+bool IsWorldCommand(const std::string& name)
+{
+	for (const WorldCommand& command : WORLD_COMMANDS)
+		if (name == command.m_name)
+			return true;
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Game/Chunk.hpp"
+#include "Engine/Core/EventSystem.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class ChunkProvider;
+class World;
+class WorldGenerator;
+
+constexpr const char* HEADLESS_WORLD_PATH = "Map/Headless";
+
+// world tooling commands (tests, benchmarks & pregeneration), these run on their own headless world
+bool InitializeWorldCommands();
+bool IsWorldCommand(const std::string& name);
+
+//------------------------------------------------------------------------------------------------
+// world of a tooling command, the chunks around the origin generated with disk IO off.
+// disk IO is off again before the world shuts down with it, so nothing is saved
+class HeadlessWorld
+{
+public:
+	explicit HeadlessWorld(int chunkRadius, WorldGenerator* generator = nullptr); // takes the generator, an overworld one if none
+	~HeadlessWorld();
+	HeadlessWorld(const HeadlessWorld&) = delete;
+	HeadlessWorld& operator=(const HeadlessWorld&) = delete;
+
+	void LoadChunks(int chunkRadius); // every chunk in the square around the origin, waits for all of them
+	void DeleteChunkFiles(int chunkRadius);
+
+	World*         GetWorld() const { return m_world; }
+	ChunkProvider* GetProvider() const { return m_provider; }
+
+private:
+	World*         m_world    = nullptr;
+	ChunkProvider* m_provider = nullptr;
+};
+
+int                                         FindSurfaceHeight(const ChunkProvider* provider, int x, int y);
+std::map<ChunkCoords, std::vector<BlockId>> SnapshotBlocks(const ChunkProvider* provider);
+std::string                                 GetGameWorldFolder(bool skyBlock);
+
+// WorldCommands.cpp
+bool Command_ChunkLoadQueueTest(EventArgs& args);
+bool Command_PregenerateWorld(EventArgs& args);
+bool Command_CompactRegions(EventArgs& args);
+
+// LightingCommands.cpp
+bool Command_LightingDeterminismTest(EventArgs& args);
+bool Command_LightingRemovalBenchmark(EventArgs& args);
+
+// WorldGenCommands.cpp
+bool Command_WorldGenBenchmark(EventArgs& args);
+bool Command_WorldGenDeterminismTest(EventArgs& args);
+bool Command_ColumnRunTerrainTest(EventArgs& args);
+bool Command_CoarseSamplingBenchmark(EventArgs& args);
+bool Command_NoiseEquivalenceTest(EventArgs& args);
+bool Command_NoiseBenchmark(EventArgs& args);
+bool Command_DensityGenBenchmark(EventArgs& args);
+bool Command_SurfaceQueryTest(EventArgs& args);
+
+// ChunkStorageCommands.cpp
+bool Command_ChunkSaveTest(EventArgs& args);
+bool Command_ChunkAsyncLoadTest(EventArgs& args);
+bool Command_ChunkWriterTest(EventArgs& args);
+bool Command_RegionFileTest(EventArgs& args);
+bool Command_ChunkLoadBenchmark(EventArgs& args);
+bool Command_ChunkCodecBenchmark(EventArgs& args);
+bool Command_AutosaveTest(EventArgs& args);
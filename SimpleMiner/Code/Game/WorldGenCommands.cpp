@@ -0,0 +1,640 @@
+#include "Game/WorldCommands.hpp"
+
+#include "Game/BlockDef.hpp"
+#include "Game/ChunkProvider.hpp"
+#include "Game/FeatureQueue.hpp"
+#include "Game/NoiseKernels.hpp"
+#include "Game/WorldGenerator.hpp"
+
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "ThirdParty/squirrel/SmoothNoise.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+double TimeChunkGeneration(WorldGenerator* generator, int chunkRadius, std::vector<BlockId>& blocks)
+{
+	blocks.clear();
+	double elapsed = 0.0;
+	for (int y = -chunkRadius; y <= chunkRadius; y++)
+		for (int x = -chunkRadius; x <= chunkRadius; x++)
+		{
+			Chunk chunk(nullptr, ChunkCoords(x, y));
+			double start = GetCurrentTimeSeconds();
+			generator->GenerateChunk(&chunk);
+			elapsed += GetCurrentTimeSeconds() - start;
+
+			for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+				blocks.push_back(chunk.m_blockArray[index].GetBlockId());
+		}
+	return elapsed;
+}
+
+bool Command_WorldGenBenchmark(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 8);
+	int chunks = (radius * 2 + 1) * (radius * 2 + 1);
+
+	OverworldWorldGenerator generator;
+	std::vector<BlockId> uncachedBlocks;
+	std::vector<BlockId> cachedBlocks;
+
+	generator.m_noiseCache.SetCapacity(0);
+	double uncachedTime = TimeChunkGeneration(&generator, radius, uncachedBlocks);
+
+	generator.m_noiseCache.SetCapacity(NOISE_TILE_CACHE_CAPACITY);
+	generator.m_noiseCache.Clear();
+	generator.m_noiseCache.ResetStats();
+	double cachedTime = TimeChunkGeneration(&generator, radius, cachedBlocks);
+
+	size_t mismatches = 0;
+	for (size_t index = 0; index < uncachedBlocks.size(); index++)
+		if (uncachedBlocks[index] != cachedBlocks[index])
+			mismatches++;
+
+	g_theConsole->AddLine(mismatches == 0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("World gen (%d chunks): uncached %.3fms/chunk, cached %.3fms/chunk, speedup %.2fx, terrain %s",
+		chunks, uncachedTime * 1000.0 / chunks, cachedTime * 1000.0 / chunks, uncachedTime / cachedTime, mismatches == 0 ? "matches" : "DIFFERS"));
+	double blocks = (double)chunks * (double)CHUNK_SIZE_BLOCKS;
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("World gen throughput: uncached %.2fM blocks/s, cached %.2fM blocks/s", blocks / uncachedTime * 1e-6, blocks / cachedTime * 1e-6));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Noise tile cache: %d hits, %d misses, hit rate %.1f%%",
+		(int)generator.m_noiseCache.GetHitCount(), (int)generator.m_noiseCache.GetMissCount(), generator.m_noiseCache.GetHitRate() * 100.0f));
+	return true;
+}
+
+bool IsTerrainBlock(BlockId blockId)
+{
+	return blockId != Blocks::BLOCK_AIR && blockId != Blocks::BLOCK_WATER && blockId != Blocks::BLOCK_ICE
+		&& blockId != Blocks::BLOCK_LOG && blockId != Blocks::BLOCK_LEAVES && blockId != Blocks::BLOCK_GLOWSTONE;
+}
+
+bool Command_WorldGenDeterminismTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 4);
+
+	// generation jobs on worker threads against a serial pass in a different order
+	OverworldWorldGenerator* parallelGenerator = new OverworldWorldGenerator();
+	HeadlessWorld world(radius, parallelGenerator);
+	ChunkProvider* provider = world.GetProvider();
+
+	OverworldWorldGenerator serialGenerator;
+	serialGenerator.m_seed = parallelGenerator->m_seed;
+
+	// features crossing chunk borders go through a queue of our own, applied once every chunk is generated
+	// the way the provider applies it to chunks as they load, sorted and into air only
+	FeatureQueue serialFeatures;
+	std::map<ChunkCoords, Chunk*> serialChunks;
+	for (auto ite = provider->GetLoadedChunks().rbegin(); ite != provider->GetLoadedChunks().rend(); ++ite)
+	{
+		Chunk* chunk = new Chunk(nullptr, ite->first);
+		serialGenerator.GenerateChunk(chunk, &serialFeatures);
+		serialChunks[ite->first] = chunk;
+	}
+	for (auto& entry : serialChunks)
+	{
+		std::vector<BlockEdit> queuedBlocks;
+		if (!serialFeatures.Take(entry.first, queuedBlocks))
+			continue;
+		std::sort(queuedBlocks.begin(), queuedBlocks.end(), [](const BlockEdit& a, const BlockEdit& b) {
+			return a.m_blockIndex != b.m_blockIndex ? a.m_blockIndex < b.m_blockIndex : a.m_blockId < b.m_blockId;
+		});
+		for (const BlockEdit& edit : queuedBlocks)
+			if (entry.second->m_blockArray[edit.m_blockIndex].GetBlockId() == Blocks::BLOCK_AIR)
+				entry.second->m_blockArray[edit.m_blockIndex].SetBlockId(edit.m_blockId);
+	}
+
+	size_t mismatches = 0;
+	for (auto& entry : serialChunks)
+	{
+		const Chunk* loadedChunk = provider->FindLoadedChunk(entry.first);
+		for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+			if (entry.second->m_blockArray[index].GetBlockId() != loadedChunk->m_blockArray[index].GetBlockId())
+				mismatches++;
+		delete entry.second;
+	}
+	size_t chunks = provider->GetLoadedChunks().size();
+	size_t pendingBlocks = provider->GetFeatureQueue().GetPendingBlockCount();
+
+	g_theConsole->AddLine(mismatches == 0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("World gen determinism: %s (%d chunks, %d blocks differ, %d feature blocks queued for unloaded chunks)",
+		mismatches == 0 ? "PASS" : "FAIL", (int)chunks, (int)mismatches, (int)pendingBlocks));
+	return true;
+}
+
+// runs the terrain stage alone, the maps it sampled are left in the context for a reference to read
+template <typename Generator>
+class TerrainStageGenerator : public Generator
+{
+public:
+	void GenerateTerrainStage(ChunkGenContext& context) { this->GenerateTerrain(context); }
+};
+
+typedef void (*TerrainReferenceFunc)(std::vector<BlockId>& blocks, const ChunkGenContext& context, unsigned int seed);
+
+static float GetContextMap(const float* extendedMap, const LocalCoords& coords)
+{
+	return extendedMap[coords.x + CHUNK_GEN_EXTEND + CHUNK_GEN_EXTENDED_SIZE_XY * (coords.y + CHUNK_GEN_EXTEND)];
+}
+
+static BlockId RollReferenceOre(const ChunkRandom& random, int index)
+{
+	float oreSeed = random.RollFloatZeroToOne(index);
+	if (oreSeed < 0.01f * 0.05f)
+		return Blocks::BLOCK_DIAMOND_ORE;
+	if (oreSeed < 0.01f * 0.25f)
+		return Blocks::BLOCK_GOLD_ORE;
+	if (oreSeed < 0.01f * 1.0f)
+		return Blocks::BLOCK_IRON_ORE;
+	if (oreSeed < 0.01f * 4.0f)
+		return Blocks::BLOCK_COAL_ORE;
+	return Blocks::BLOCK_STONE;
+}
+
+// the per block terrain loops the generators ran before column runs, every block decided on its own
+static void ReferencePerlinTerrain(std::vector<BlockId>& blocks, const ChunkGenContext& context, unsigned int seed)
+{
+	int heightMap[CHUNK_SIZE_XY * CHUNK_SIZE_XY] = {};
+	float noiseRow[CHUNK_SIZE_XY];
+	for (int y = 0; y < CHUNK_SIZE_XY; y++)
+	{
+		ComputePerlinNoise2dRow(noiseRow, context.m_origin.x, context.m_origin.y + y, CHUNK_SIZE_XY, 200.f, 5, 0.5f, 2.0f, false, seed);
+		for (int x = 0; x < CHUNK_SIZE_XY; x++)
+			heightMap[x + y * CHUNK_SIZE_XY] = 64 + int(30.f * noiseRow[x]);
+	}
+
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
+		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+			{
+				int index = Chunk::GetIndex(coords);
+				int height = heightMap[coords.x + coords.y * CHUNK_SIZE_XY];
+				BlockId blockId = Blocks::BLOCK_AIR;
+				if (coords.z == height)
+					blockId = Blocks::BLOCK_GRASS;
+				else if (coords.z < height)
+					blockId = height - coords.z < 5 ? Blocks::BLOCK_DIRT : RollReferenceOre(context.m_random, index);
+				if (blockId == Blocks::BLOCK_AIR && coords.z < 64)
+					blockId = Blocks::BLOCK_WATER;
+				blocks[index] = blockId;
+			}
+}
+
+static void ReferenceOverworldTerrain(std::vector<BlockId>& blocks, const ChunkGenContext& context, unsigned int)
+{
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
+		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+			{
+				int index = Chunk::GetIndex(coords);
+				int height = (int)GetContextMap(context.m_heightMap, coords);
+				float humidity = GetContextMap(context.m_humidityMap, coords);
+				float oceanness = GetContextMap(context.m_oceannessMap, coords);
+
+				BlockId blockId = Blocks::BLOCK_AIR;
+				if (coords.z == height)
+					blockId = Blocks::BLOCK_GRASS;
+				else if (coords.z < height)
+					blockId = height - coords.z < 5 ? Blocks::BLOCK_DIRT : RollReferenceOre(context.m_random, index);
+
+				if (humidity < 0.1f && oceanness > -0.05f && coords.z == CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_GRASS)
+					blockId = Blocks::BLOCK_SAND;
+				if (blockId == Blocks::BLOCK_AIR && coords.z <= CHUNK_WATER_LEVEL)
+					blockId = Blocks::BLOCK_WATER;
+
+				if (height <= CHUNK_WATER_LEVEL)
+				{
+					float sandLevel = RangeMap(humidity, -0.1f, -0.2f, 64.0f, 60.0f);
+					float iceLevel  = RangeMap(GetContextMap(context.m_temperatureMap, coords), -0.1f, -0.2f, 64.0f, 60.0f);
+					if (coords.z > iceLevel && blockId == Blocks::BLOCK_WATER)
+						blockId = Blocks::BLOCK_ICE;
+					if (sandLevel <= CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_WATER && oceanness <= 0)
+						blockId = Blocks::BLOCK_SAND;
+					if (coords.z > sandLevel && (blockId == Blocks::BLOCK_DIRT || blockId == Blocks::BLOCK_GRASS))
+						blockId = Blocks::BLOCK_SAND;
+				}
+				blocks[index] = blockId;
+			}
+}
+
+static void ReferenceSkyBlockTerrain(std::vector<BlockId>& blocks, const ChunkGenContext& context, unsigned int)
+{
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
+		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+			{
+				int index = Chunk::GetIndex(coords);
+				int height1 = (int)GetContextMap(context.m_heightMap, coords);
+				int height2 = (int)GetContextMap(context.m_height2Map, coords);
+				float humidity = GetContextMap(context.m_humidityMap, coords);
+				float oceanness = GetContextMap(context.m_oceannessMap, coords);
+
+				BlockId blockId = Blocks::BLOCK_AIR;
+				if (coords.z <= height1 && coords.z > height2)
+				{
+					if (coords.z == height1)
+						blockId = Blocks::BLOCK_GRASS;
+					else
+						blockId = height1 - coords.z < 5 ? Blocks::BLOCK_DIRT : RollReferenceOre(context.m_random, index);
+				}
+
+				if (humidity < 0.1f && oceanness > -0.05f && coords.z == CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_GRASS)
+					blockId = Blocks::BLOCK_SAND;
+				if (blockId == Blocks::BLOCK_AIR && coords.z <= CHUNK_WATER_LEVEL && coords.z > height2)
+				{
+					if (coords.z > height2 + 5)
+						blockId = Blocks::BLOCK_WATER;
+					else if (coords.z == CHUNK_WATER_LEVEL)
+						blockId = Blocks::BLOCK_GRASS;
+					else
+						blockId = Blocks::BLOCK_DIRT;
+				}
+
+				if (height1 <= CHUNK_WATER_LEVEL && coords.z <= height1 && coords.z > height2)
+				{
+					float sandLevel = RangeMap(humidity, -0.1f, -0.2f, 64.0f, 60.0f);
+					float iceLevel  = RangeMap(GetContextMap(context.m_temperatureMap, coords), -0.1f, -0.2f, 64.0f, 60.0f);
+					if (coords.z > iceLevel && blockId == Blocks::BLOCK_WATER)
+						blockId = Blocks::BLOCK_ICE;
+					if (sandLevel <= CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_WATER && oceanness <= 0)
+						blockId = Blocks::BLOCK_SAND;
+					if (coords.z > sandLevel && (blockId == Blocks::BLOCK_DIRT || blockId == Blocks::BLOCK_GRASS))
+						blockId = Blocks::BLOCK_SAND;
+				}
+				blocks[index] = blockId;
+			}
+
+	// water reaches down from the surface until the first opaque block, as the generator floods it
+	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+		{
+			BlockId blockId = Blocks::BLOCK_AIR;
+			for (coords.z = CHUNK_MAX_Z; coords.z >= 0; coords.z--)
+			{
+				BlockId& block = blocks[Chunk::GetIndex(coords)];
+				if (block == Blocks::BLOCK_WATER)
+					blockId = Blocks::BLOCK_WATER;
+				if (Block(block).IsOpaque())
+					blockId = Blocks::BLOCK_AIR;
+				if (block == Blocks::BLOCK_AIR)
+					block = blockId;
+			}
+		}
+}
+
+// CompareTerrainStage: Blocks of the terrain stage that differ from the per block reference, chunks spread apart to reach oceans and mountains
+template <typename Generator>
+size_t CompareTerrainStage(unsigned int seed, int chunkRadius, TerrainReferenceFunc reference, size_t& blockCount)
+{
+	TerrainStageGenerator<Generator> generator;
+	generator.m_seed = seed;
+	std::vector<BlockId> expected(CHUNK_SIZE_BLOCKS);
+	size_t mismatches = 0;
+	for (int y = -chunkRadius; y <= chunkRadius; y++)
+		for (int x = -chunkRadius; x <= chunkRadius; x++)
+		{
+			Chunk chunk(nullptr, ChunkCoords(x * 7, y * 7));
+			ChunkGenContext context(&chunk, seed);
+			generator.GenerateTerrainStage(context);
+			reference(expected, context, seed);
+			for (int index = 0; index < (int)CHUNK_SIZE_BLOCKS; index++)
+				if (chunk.m_blockArray[index].GetBlockId() != expected[index])
+					mismatches++;
+			blockCount += CHUNK_SIZE_BLOCKS;
+		}
+	return mismatches;
+}
+
+bool Command_ColumnRunTerrainTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 3);
+	static const unsigned int SEEDS[] = { 0, 7, 1234567 };
+
+	struct TerrainCase
+	{
+		const char* m_name;
+		size_t      m_mismatches;
+		size_t      m_blocks;
+	};
+	TerrainCase cases[] = { { "Perlin", 0, 0 }, { "Overworld", 0, 0 }, { "SkyBlock", 0, 0 } };
+	for (unsigned int seed : SEEDS)
+	{
+		cases[0].m_mismatches += CompareTerrainStage<PerlinWorldGenerator>(seed, radius, ReferencePerlinTerrain, cases[0].m_blocks);
+		cases[1].m_mismatches += CompareTerrainStage<OverworldWorldGenerator>(seed, radius, ReferenceOverworldTerrain, cases[1].m_blocks);
+		cases[2].m_mismatches += CompareTerrainStage<SkyBlockWorldGenerator>(seed, radius, ReferenceSkyBlockTerrain, cases[2].m_blocks);
+	}
+
+	for (const TerrainCase& terrainCase : cases)
+	{
+		bool pass = terrainCase.m_mismatches == 0;
+		g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Column run terrain, %s: %s (%d of %d blocks differ from the per block reference over %d seeds)",
+			terrainCase.m_name, pass ? "PASS" : "FAIL", (int)terrainCase.m_mismatches, (int)terrainCase.m_blocks, (int)(sizeof(SEEDS) / sizeof(SEEDS[0]))));
+	}
+	return true;
+}
+
+bool Command_CoarseSamplingBenchmark(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 8);
+	int chunks = (radius * 2 + 1) * (radius * 2 + 1);
+
+	OverworldWorldGenerator generator;
+	generator.m_noiseCache.SetCapacity(0);
+	std::vector<BlockId> exactBlocks;
+	std::vector<BlockId> coarseBlocks;
+
+	generator.SetCoarseSampling(false);
+	double exactTime = TimeChunkGeneration(&generator, radius, exactBlocks);
+	generator.SetCoarseSampling(true);
+	double coarseTime = TimeChunkGeneration(&generator, radius, coarseBlocks);
+
+	// the shaped height field both paths cut columns from, the lattice must stay within a block of exact noise
+	int columnsXY = (radius * 2 + 1) * CHUNK_SIZE_XY;
+	IntVec2 worldMins = IntVec2(-radius * CHUNK_SIZE_XY, -radius * CHUNK_SIZE_XY);
+	std::vector<ColumnInfo> exactColumns(columnsXY * columnsXY);
+	std::vector<ColumnInfo> coarseColumns(columnsXY * columnsXY);
+	generator.SetCoarseSampling(false);
+	generator.QueryColumns(exactColumns.data(), worldMins, IntVec2(columnsXY, columnsXY));
+	generator.SetCoarseSampling(true);
+	generator.QueryColumns(coarseColumns.data(), worldMins, IntVec2(columnsXY, columnsXY));
+	float maxFieldError = 0.0f;
+	double totalFieldError = 0.0;
+	for (size_t index = 0; index < exactColumns.size(); index++)
+	{
+		float error = fabsf(exactColumns[index].m_height - coarseColumns[index].m_height);
+		maxFieldError = Max(maxFieldError, error);
+		totalFieldError += (double)error;
+	}
+
+	// terrain surface per generated column, ignoring water, ice and trees on top. a sub-block field error
+	// still moves a column whenever it crosses a block boundary, so these are reported but not judged
+	int maxError = 0;
+	size_t mismatches = 0;
+	size_t columns = 0;
+	for (size_t chunkStart = 0; chunkStart < exactBlocks.size(); chunkStart += CHUNK_SIZE_BLOCKS)
+		for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+		{
+			int exactHeight = 0;
+			int coarseHeight = 0;
+			for (int z = CHUNK_MAX_Z; z > 0 && exactHeight == 0; z--)
+				if (IsTerrainBlock(exactBlocks[chunkStart + (column | (z << CHUNK_BITSHIFT_Z))]))
+					exactHeight = z;
+			for (int z = CHUNK_MAX_Z; z > 0 && coarseHeight == 0; z--)
+				if (IsTerrainBlock(coarseBlocks[chunkStart + (column | (z << CHUNK_BITSHIFT_Z))]))
+					coarseHeight = z;
+
+			int error = abs(exactHeight - coarseHeight);
+			maxError = Max(maxError, error);
+			if (error > 0)
+				mismatches++;
+			columns++;
+		}
+
+	bool pass = maxFieldError < 1.0f;
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Coarse sampling (%d chunks, lattice %d): exact %.3fms/chunk, coarse %.3fms/chunk, speedup %.2fx",
+		chunks, NOISE_LATTICE_STEP, exactTime * 1000.0 / chunks, coarseTime * 1000.0 / chunks, exactTime / coarseTime));
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Coarse sampling height field error: %s (max %.3f blocks, mean %.4f blocks)",
+		pass ? "PASS" : "FAIL", maxFieldError, totalFieldError / (double)exactColumns.size()));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Coarse sampling surface: %d of %d columns moved, max %d blocks",
+		(int)mismatches, (int)columns, maxError));
+	return true;
+}
+
+struct NoiseTestField
+{
+	float        m_scale;
+	unsigned int m_octaves;
+};
+
+static const NoiseTestField NOISE_TEST_FIELDS[] = { { 50.0f, 2 }, { 200.0f, 5 }, { 500.0f, 5 }, { 800.0f, 13 } }; // the generator fields
+
+void MakeNoiseTestPositions(std::vector<float>& posX, std::vector<float>& posY, int count)
+{
+	// block columns on both sides of the origin from a fixed lcg, every 16th on an exact lattice point
+	unsigned int state = 1;
+	auto nextInt = [&state](int range) {
+		state = state * 1664525u + 1013904223u;
+		return int(state >> 8) % (range * 2 + 1) - range;
+	};
+	posX.resize(count);
+	posY.resize(count);
+	for (int index = 0; index < count; index++)
+	{
+		posX[index] = float(nextInt(100000));
+		posY[index] = float(nextInt(100000));
+		if (index % 16 == 0)
+			posX[index] = float(800 * nextInt(100));
+	}
+}
+
+bool Command_NoiseEquivalenceTest(EventArgs& args)
+{
+	int count = args.GetValue("count", 100000);
+
+	std::vector<float> posX, posY;
+	MakeNoiseTestPositions(posX, posY, count);
+
+	std::vector<float> reference(count);
+	std::vector<float> results(count);
+	NoiseKernel best = GetBestNoiseKernel();
+	bool pass = true;
+	for (int kernel = 1; kernel <= (int)best; kernel++)
+	{
+		size_t mismatches = 0;
+		for (auto& field : NOISE_TEST_FIELDS)
+		{
+			ComputePerlinNoise2dBatch(NoiseKernel::SCALAR, reference.data(), posX.data(), posY.data(), count, field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+			ComputePerlinNoise2dBatch((NoiseKernel)kernel, results.data(), posX.data(), posY.data(), count, field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+			for (int index = 0; index < count; index++)
+				if (memcmp(&reference[index], &results[index], sizeof(float)) != 0)
+					mismatches++;
+		}
+		pass = pass && mismatches == 0;
+		g_theConsole->AddLine(mismatches == 0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Noise kernel %s vs scalar: %s (%d mismatches)", GetNoiseKernelName((NoiseKernel)kernel), mismatches == 0 ? "PASS" : "FAIL", (int)mismatches));
+	}
+
+	// the scalar kernel replaces the engine's Compute2dPerlinNoise in generation, terrain of existing worlds
+	// depends on every bit of it matching
+	size_t engineMismatches = 0;
+	float engineMaxError = 0.0f;
+	for (auto& field : NOISE_TEST_FIELDS)
+	{
+		ComputePerlinNoise2dBatch(NoiseKernel::SCALAR, reference.data(), posX.data(), posY.data(), count, field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+		for (int index = 0; index < count; index++)
+		{
+			float engine = Compute2dPerlinNoise(posX[index], posY[index], field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+			if (memcmp(&engine, &reference[index], sizeof(float)) != 0)
+				engineMismatches++;
+			engineMaxError = Max(engineMaxError, fabsf(engine - reference[index]));
+		}
+	}
+	pass = pass && engineMismatches == 0;
+	g_theConsole->AddLine(engineMismatches == 0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Noise scalar vs Compute2dPerlinNoise: %s (%d mismatches, max error %g)",
+		engineMismatches == 0 ? "PASS" : "FAIL", (int)engineMismatches, engineMaxError));
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Noise equivalence: %s", pass ? "PASS" : "FAIL"));
+	return true;
+}
+
+bool Command_NoiseBenchmark(EventArgs& args)
+{
+	int count = args.GetValue("count", 262144);
+
+	std::vector<float> posX, posY;
+	MakeNoiseTestPositions(posX, posY, count);
+	std::vector<float> results(count);
+
+	for (auto& field : NOISE_TEST_FIELDS)
+	{
+		double start = GetCurrentTimeSeconds();
+		for (int index = 0; index < count; index++)
+			results[index] = Compute2dPerlinNoise(posX[index], posY[index], field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+		double engineTime = GetCurrentTimeSeconds() - start;
+
+		std::string line = Stringf("Noise scale %.0f, %d octaves: engine %.1fns", field.m_scale, (int)field.m_octaves, engineTime * 1e9 / count);
+		for (int kernel = 0; kernel <= (int)GetBestNoiseKernel(); kernel++)
+		{
+			start = GetCurrentTimeSeconds();
+			ComputePerlinNoise2dBatch((NoiseKernel)kernel, results.data(), posX.data(), posY.data(), count, field.m_scale, field.m_octaves, 0.5f, 2.0f, true, 7);
+			double kernelTime = GetCurrentTimeSeconds() - start;
+			line += Stringf(", %s %.1fns (%.2fx)", GetNoiseKernelName((NoiseKernel)kernel), kernelTime * 1e9 / count, engineTime / kernelTime);
+		}
+		g_theConsole->AddLine(DevConsole::LOG_INFO, line + " per sample");
+	}
+	return true;
+}
+
+bool Command_DensityGenBenchmark(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 6);
+	int chunks = (radius * 2 + 1) * (radius * 2 + 1);
+
+	OverworldWorldGenerator overworld;
+	DensityWorldGenerator density;
+	std::vector<BlockId> overworldBlocks;
+	std::vector<BlockId> densityBlocks;
+	double overworldTime = TimeChunkGeneration(&overworld, radius, overworldBlocks);
+	double densityTime = TimeChunkGeneration(&density, radius, densityBlocks);
+
+	// overhangs: ground above air above sea level, only a 3d field makes them
+	size_t overhangs = 0;
+	for (size_t chunk = 0; chunk < densityBlocks.size(); chunk += CHUNK_SIZE_BLOCKS)
+		for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+			for (int z = 66; z < (int)CHUNK_SIZE_Z; z++)
+			{
+				BlockId below = densityBlocks[chunk + column + ((z - 1) << CHUNK_BITSHIFT_Z)];
+				BlockId above = densityBlocks[chunk + column + (z << CHUNK_BITSHIFT_Z)];
+				if (below == Blocks::BLOCK_AIR && above != Blocks::BLOCK_AIR && above != Blocks::BLOCK_WATER)
+					overhangs++;
+			}
+
+	size_t cells = density.GetSkippedCellCount() + density.GetInterpolatedCellCount();
+	double ratio = densityTime / overworldTime;
+	g_theConsole->AddLine(ratio <= 2.0 ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Density gen (%d chunks): overworld %.3fms/chunk, density %.3fms/chunk, %.2fx overworld time, %s",
+		chunks, overworldTime * 1000.0 / chunks, densityTime * 1000.0 / chunks, ratio, ratio <= 2.0 ? "PASS" : "FAIL"));
+	g_theConsole->AddLine(DevConsole::LOG_INFO, Stringf("Density cells: %.1f%% filled whole, %.1f%% interpolated, %d overhang blocks",
+		100.0 * density.GetSkippedCellCount() / cells, 100.0 * density.GetInterpolatedCellCount() / cells, (int)overhangs));
+	return true;
+}
+
+// ReadGeneratedSurface: Fill a ColumnInfo from a generated column, feature blocks count as air and ores as stone
+void ReadGeneratedSurface(const Chunk& chunk, int column, ColumnInfo& info)
+{
+	info = ColumnInfo();
+	for (int z = CHUNK_MAX_Z; z >= 0 && info.m_groundZ < 0; z--)
+	{
+		BlockId blockId = chunk.m_blockArray[column + (z << CHUNK_BITSHIFT_Z)].GetBlockId();
+		if (blockId == Blocks::BLOCK_AIR || blockId == Blocks::BLOCK_LOG || blockId == Blocks::BLOCK_LEAVES || blockId == Blocks::BLOCK_GLOWSTONE)
+			continue;
+		if (blockId == Blocks::BLOCK_COAL_ORE || blockId == Blocks::BLOCK_IRON_ORE || blockId == Blocks::BLOCK_GOLD_ORE || blockId == Blocks::BLOCK_DIAMOND_ORE)
+			blockId = Blocks::BLOCK_STONE;
+
+		if (info.m_surfaceZ < 0)
+		{
+			info.m_surfaceZ = z;
+			info.m_surfaceBlock = blockId;
+		}
+		if (blockId != Blocks::BLOCK_WATER)
+			info.m_groundZ = z;
+	}
+}
+
+bool IsSameSurface(const ColumnInfo& a, const ColumnInfo& b)
+{
+	return a.m_surfaceZ == b.m_surfaceZ && a.m_groundZ == b.m_groundZ && (a.m_surfaceZ < 0 || a.m_surfaceBlock == b.m_surfaceBlock);
+}
+
+void TestSurfaceQueries(WorldGenerator* generator, int radius)
+{
+	int chunks = (radius * 2 + 1) * (radius * 2 + 1);
+	IntVec2 mins = IntVec2(-radius * (int)CHUNK_SIZE_XY, -radius * (int)CHUNK_SIZE_XY);
+	IntVec2 size = IntVec2((radius * 2 + 1) * (int)CHUNK_SIZE_XY, (radius * 2 + 1) * (int)CHUNK_SIZE_XY);
+
+	// the whole region in one query, then every chunk generated and read back
+	std::vector<ColumnInfo> queried(size.x * size.y);
+	double start = GetCurrentTimeSeconds();
+	generator->QueryColumns(queried.data(), mins, size);
+	double queryTime = GetCurrentTimeSeconds() - start;
+
+	size_t mismatches = 0;
+	double generateTime = 0.0;
+	for (int chunkY = -radius; chunkY <= radius; chunkY++)
+		for (int chunkX = -radius; chunkX <= radius; chunkX++)
+		{
+			Chunk chunk(nullptr, ChunkCoords(chunkX, chunkY));
+			start = GetCurrentTimeSeconds();
+			generator->GenerateChunk(&chunk);
+			generateTime += GetCurrentTimeSeconds() - start;
+
+			for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+			{
+				int x = (chunkX + radius) * (int)CHUNK_SIZE_XY + (column & (CHUNK_SIZE_XY - 1));
+				int y = (chunkY + radius) * (int)CHUNK_SIZE_XY + (column / CHUNK_SIZE_XY);
+				ColumnInfo generated;
+				ReadGeneratedSurface(chunk, column, generated);
+				if (!IsSameSurface(generated, queried[x + y * size.x]))
+					mismatches++;
+			}
+		}
+
+	// single columns from several threads at once, through the tile cache the region query filled
+	constexpr int threadCount = 4;
+	size_t threadMismatches[threadCount] = {};
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < threadCount; thread++)
+		threads.emplace_back([&, thread]() {
+			for (int index = thread; index < size.x * size.y; index += threadCount * 7)
+				if (!IsSameSurface(generator->QueryColumn(IntVec2(mins.x + index % size.x, mins.y + index / size.x)), queried[index]))
+					threadMismatches[thread]++;
+		});
+	for (std::thread& thread : threads)
+		thread.join();
+	for (size_t threadMismatch : threadMismatches)
+		mismatches += threadMismatch;
+
+	bool pass = mismatches == 0;
+	g_theConsole->AddLine(pass ? DevConsole::LOG_INFO : DevConsole::LOG_WARN, Stringf("Surface query %s: %s (%d columns, %d differ), query %.3fms/chunk, generation %.3fms/chunk",
+		generator->GetName(), pass ? "PASS" : "FAIL", size.x * size.y, (int)mismatches, queryTime * 1000.0 / chunks, generateTime * 1000.0 / chunks));
+}
+
+bool Command_SurfaceQueryTest(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 4);
+
+	PlainWorldGenerator plain;
+	PerlinWorldGenerator perlin;
+	OverworldWorldGenerator overworld;
+	SkyBlockWorldGenerator skyBlock;
+	DensityWorldGenerator density;
+	WorldGenerator* generators[] = { &plain, &perlin, &overworld, &skyBlock, &density };
+	for (WorldGenerator* generator : generators)
+		TestSurfaceQueries(generator, radius);
+	return true;
+}
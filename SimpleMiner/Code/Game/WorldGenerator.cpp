@@ -1,216 +1,367 @@
 #include "Game/WorldGenerator.hpp"
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
-#include "Engine/Math/RandomNumberGenerator.hpp"
 #include "Engine/Math/Curves.hpp"
 #include "Game/Chunk.hpp"
 #include "Game/BlockDef.hpp"
+#include "Game/FeatureQueue.hpp"
+#include "Game/NoiseKernels.hpp"
 #include "ThirdParty/squirrel/SmoothNoise.hpp"
 
-extern RandomNumberGenerator rng;
+WorldGenerator::WorldGenerator()
+{
+	SetCoarseSampling(false);
+}
 
-void PlainWorldGenerator::GenerateChunk(Chunk* chunk)
+void WorldGenerator::SetCoarseSampling(bool enabled)
 {
-	LocalCoords coords = IntVec3::ZERO;
-	int index = Chunk::GetIndex(coords);
-	for (; coords.z < CHUNK_SIZE_Z; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_AIR);
-				index += 1;
-			}
+	// fields of scale 200 and above are smooth at block scale, hilliness (scale 50) amplifies height errors
+	// and tree placement picks local maxima of the 13 octave treeness, both stay exact
+	int step = enabled ? NOISE_LATTICE_STEP : 1;
+	m_fieldLatticeSteps[NOISE_FIELD_HEIGHT]      = step;
+	m_fieldLatticeSteps[NOISE_FIELD_HEIGHT2]     = step;
+	m_fieldLatticeSteps[NOISE_FIELD_HUMIDITY]    = step;
+	m_fieldLatticeSteps[NOISE_FIELD_TEMPERATURE] = step;
+	m_fieldLatticeSteps[NOISE_FIELD_HILLINESS]   = 1;
+	m_fieldLatticeSteps[NOISE_FIELD_OCEANNESS]   = step;
+	m_fieldLatticeSteps[NOISE_FIELD_TREENESS]    = 1;
+}
 
-	index = 0;
-	for (coords.z = 0; coords.z < 1; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_BEDROCK);
-				index += 1;
-			}
+unsigned int WorldGenerator::GetVersionHash() const
+{
+	unsigned int hash = GetRevision();
+	for (const char* name = GetName(); *name; name++)
+		hash = ChunkRandom::Hash((unsigned int)*name, hash);
+	for (int step : m_fieldLatticeSteps)
+		hash = ChunkRandom::Hash((unsigned int)step, hash);
+	return hash;
+}
 
-	coords - IntVec3(coords.z, 0, 0);
-	index = Chunk::GetIndex(coords);
-	for (; coords.z < 4; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_DIRT);
-				index += 1;
-			}
+void WorldGenerator::GenerateChunk(Chunk* chunk, FeatureQueue* featureQueue)
+{
+	ChunkGenContext context(chunk, m_seed);
+	GenerateTerrain(context);
+	GenerateSurface(context);
+	GenerateFeatures(context);
+
+	if (featureQueue)
+		featureQueue->Push(context.m_spilledBlocks);
+}
 
-	coords - IntVec3(coords.z, 0, 0);
-	index = Chunk::GetIndex(coords);
-	for (; coords.z < 5; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+// PlaceFeature: Place a template in world space, blocks outside of the chunk are kept for the chunk they fall in.
+// Features fill air only, so the result is the same whichever of two overlapping chunks generates first
+void WorldGenerator::PlaceFeature(ChunkGenContext& context, const BlockTemplate& feature, const LocalCoords& coords) const
+{
+	for (auto& entry : feature.m_blocks)
+	{
+		LocalCoords offset = coords + entry.m_offset;
+		if (offset.z < 0 || offset.z >= (int)CHUNK_SIZE_Z)
+			continue;
+
+		if (offset.x >= 0 && offset.x < (int)CHUNK_SIZE_XY && offset.y >= 0 && offset.y < (int)CHUNK_SIZE_XY)
+		{
+			Block& block = context.m_chunk->m_blockArray[Chunk::GetIndex(offset)];
+			if (block.GetBlockId() == Blocks::BLOCK_AIR)
+				block.SetBlockId(entry.m_blockId);
+			continue;
+		}
+
+		WorldCoords worldCoords = context.m_origin + offset;
+		BlockEdit edit;
+		edit.m_blockIndex = (unsigned short)Chunk::GetIndex(Chunk::GetLocalCoords(worldCoords));
+		edit.m_blockId = entry.m_blockId;
+		context.m_spilledBlocks[Chunk::GetChunkCoords(worldCoords)].push_back(edit);
+	}
+}
+
+ChunkGenContext::ChunkGenContext(Chunk* chunk, unsigned int seed)
+	: m_chunk(chunk)
+	, m_origin(chunk->GetChunkOrigin())
+	, m_random(seed, chunk->m_chunkCoords)
+{
+}
+
+ColumnInfo WorldGenerator::QueryColumn(const IntVec2& worldXY)
+{
+	ColumnInfo info;
+	QueryColumns(&info, worldXY, IntVec2(1, 1));
+	return info;
+}
+
+bool WorldGenerator::FindDryColumn(const IntVec2& worldXY, int searchRadius, IntVec2& column, ColumnInfo& info)
+{
+	int side = searchRadius * 2 + 1;
+	std::vector<ColumnInfo> columns(side * side);
+	QueryColumns(columns.data(), IntVec2(worldXY.x - searchRadius, worldXY.y - searchRadius), IntVec2(side, side));
+
+	int bestDistanceSquared = -1;
+	for (int y = 0; y < side; y++)
+		for (int x = 0; x < side; x++)
+		{
+			const ColumnInfo& candidate = columns[x + y * side];
+			if (candidate.m_groundZ < 0 || candidate.m_groundZ >= (int)CHUNK_MAX_Z || candidate.m_surfaceZ != candidate.m_groundZ)
+				continue; // empty, no headroom or under water
+
+			int distanceSquared = (x - searchRadius) * (x - searchRadius) + (y - searchRadius) * (y - searchRadius);
+			if (bestDistanceSquared < 0 || distanceSquared < bestDistanceSquared)
 			{
-				chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_GRASS);
-				index += 1;
+				bestDistanceSquared = distanceSquared;
+				column = IntVec2(worldXY.x - searchRadius + x, worldXY.y - searchRadius + y);
+				info = candidate;
 			}
+		}
+	return bestDistanceSquared >= 0;
 }
 
-void PerlinWorldGenerator::GenerateChunk(Chunk* chunk)
+// FirstAbove: Lowest block z strictly above a float level
+static int FirstAbove(float level)
 {
-	WorldCoords origin = chunk->GetChunkOrigin();
+	return (int)floorf(level) + 1;
+}
 
-	auto heightMapFunc = [](const WorldCoords& coords, unsigned int seed) {
-		return 64 + int(30.f * Compute2dPerlinNoise(float(coords.x), float(coords.y), 200.f, 5, 0.5f, 2.0f, false, seed));
-	};
+// FillColumn: Set the run [zMin, zMax] of one block column, clamped to the chunk
+void FillColumn(Chunk* chunk, int columnIndex, int zMin, int zMax, BlockId blockId)
+{
+	zMin = zMin < 0 ? 0 : zMin;
+	zMax = zMax > (int)CHUNK_MAX_Z ? (int)CHUNK_MAX_Z : zMax;
+	Block* block = chunk->m_blockArray + columnIndex + (zMin << CHUNK_BITSHIFT_Z);
+	for (int z = zMin; z <= zMax; z++, block += CHUNK_SIZE_COLUMNS)
+		block->SetBlockId(blockId);
+}
+
+// TopOfRun: Highest z of the run [zMin, zMax] left in the chunk by FillColumn, -1 if none
+int TopOfRun(int zMin, int zMax)
+{
+	zMin = zMin < 0 ? 0 : zMin;
+	zMax = zMax > (int)CHUNK_MAX_Z ? (int)CHUNK_MAX_Z : zMax;
+	return zMin <= zMax ? zMax : -1;
+}
+
+// FillOres: Turn stone of the run [zMin, zMax] into ores, rolled per block index
+void FillOres(Chunk* chunk, const ChunkRandom& random, int columnIndex, int zMin, int zMax)
+{
+	zMin = zMin < 0 ? 0 : zMin;
+	zMax = zMax > (int)CHUNK_MAX_Z ? (int)CHUNK_MAX_Z : zMax;
+	for (int z = zMin; z <= zMax; z++)
+	{
+		int index = columnIndex + (z << CHUNK_BITSHIFT_Z);
+		float oreSeed = random.RollFloatZeroToOne(index);
+		if (oreSeed >= 0.01f * 4.0f)
+			continue;
+
+		if (oreSeed < 0.01f * 0.05f)
+			chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_DIAMOND_ORE);
+		else if (oreSeed < 0.01f * 0.25f)
+			chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_GOLD_ORE);
+		else if (oreSeed < 0.01f * 1.0f)
+			chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_IRON_ORE);
+		else
+			chunk->m_blockArray[index].SetBlockId(Blocks::BLOCK_COAL_ORE);
+	}
+}
+
+void PlainWorldGenerator::GenerateTerrain(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
+	for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+	{
+		FillColumn(chunk, column, 0, 0, Blocks::BLOCK_BEDROCK);
+		FillColumn(chunk, column, 1, 3, Blocks::BLOCK_DIRT);
+		FillColumn(chunk, column, 4, 4, Blocks::BLOCK_GRASS);
+		FillColumn(chunk, column, 5, CHUNK_MAX_Z, Blocks::BLOCK_AIR);
+	}
+}
+
+void PlainWorldGenerator::QueryColumns(ColumnInfo* columns, const IntVec2&, const IntVec2& size)
+{
+	for (int index = 0; index < size.x * size.y; index++)
+	{
+		columns[index] = ColumnInfo();
+		columns[index].m_surfaceZ = 4;
+		columns[index].m_groundZ = 4;
+		columns[index].m_surfaceBlock = Blocks::BLOCK_GRASS;
+	}
+}
 
+void PerlinWorldGenerator::GenerateTerrain(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
+	const WorldCoords& origin = context.m_origin;
+	const ChunkRandom& random = context.m_random;
+
+	float noiseRow[CHUNK_SIZE_XY];
 	int heightMap[CHUNK_SIZE_XY * CHUNK_SIZE_XY] = {};
 
 	LocalCoords coords = IntVec3::ZERO;
 	int index = 0;
 	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+	{
+		ComputePerlinNoise2dRow(noiseRow, origin.x, origin.y + coords.y, CHUNK_SIZE_XY, 200.f, 5, 0.5f, 2.0f, false, m_seed);
 		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
 		{
-			heightMap[index] = heightMapFunc(origin + coords, m_seed);
+			heightMap[index] = 64 + int(30.f * noiseRow[coords.x]);
 			index += 1;
 		}
+	}
 
-	index = 0;
-	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				int height = heightMap[Chunk::GetIndex(IntVec3(coords.x, coords.y, 0))];
-
-				unsigned char blockId = Blocks::BLOCK_AIR;
-				if (coords.z <= height)
-				{
-					if (height - coords.z == 0)
-					{
-						blockId = Blocks::BLOCK_GRASS;
-					}
-					else if (height - coords.z < 5)
-					{
-						blockId = Blocks::BLOCK_DIRT;
-					}
-					else
-					{
-						blockId = Blocks::BLOCK_STONE;
-
-						float oreSeed = rng.RollRandomFloatZeroToOne();
-
-						if (oreSeed < 0.01f * 0.05f)
-							blockId = Blocks::BLOCK_DIAMOND_ORE;
-						else if (oreSeed < 0.01f * 0.25f)
-							blockId = Blocks::BLOCK_GOLD_ORE;
-						else if (oreSeed < 0.01f * 1.0f)
-							blockId = Blocks::BLOCK_IRON_ORE;
-						else if (oreSeed < 0.01f * 4.0f)
-							blockId = Blocks::BLOCK_COAL_ORE;
-					}
-				}
-				if (blockId == Blocks::BLOCK_AIR && coords.z < 64)
-					blockId = Blocks::BLOCK_WATER;
+	// column runs: stone, dirt and grass up to the height, water below sea level, air above
+	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+		{
+			int column = Chunk::GetIndex(IntVec3(coords.x, coords.y, 0));
+			int height = heightMap[column];
+
+			FillColumn(chunk, column, 0, height - 5, Blocks::BLOCK_STONE);
+			FillOres(chunk, random, column, 0, height - 5);
+			FillColumn(chunk, column, height - 4, height - 1, Blocks::BLOCK_DIRT);
+			FillColumn(chunk, column, height, height, Blocks::BLOCK_GRASS);
+			FillColumn(chunk, column, height + 1, 63, Blocks::BLOCK_WATER);
+			FillColumn(chunk, column, Max(height + 1, 64), CHUNK_MAX_Z, Blocks::BLOCK_AIR);
+		}
+}
 
-				chunk->m_blockArray[index].SetBlockId(blockId);
-				index++;
-			}
+void PerlinWorldGenerator::QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size)
+{
+	std::vector<float> noiseRow(size.x);
+	for (int y = 0; y < size.y; y++)
+	{
+		ComputePerlinNoise2dRow(noiseRow.data(), worldMins.x, worldMins.y + y, size.x, 200.f, 5, 0.5f, 2.0f, false, m_seed);
+		for (int x = 0; x < size.x; x++)
+		{
+			ColumnInfo& info = columns[x + y * size.x];
+			info = ColumnInfo();
+			int height = 64 + int(30.f * noiseRow[x]);
+			info.m_groundZ = height;
+			info.m_surfaceZ = height < 63 ? 63 : height; // water runs up to 63 here
+			info.m_surfaceBlock = height < 63 ? Blocks::BLOCK_WATER : Blocks::BLOCK_GRASS;
+		}
+	}
 }
 
 // =======================================================================================================
 // ==================================   ADVANCED MAP GENERATION   ========================================
 // =======================================================================================================
 
-constexpr int CHUNK_WATER_LEVEL = 64;
 constexpr int CHUNK_OCEAN_LEVEL = 35;
-constexpr int CHUNK_BIOME_EXTEND_TREE_SIZE = 2; // trees are maximum of 3x3 blocks wide
-constexpr int CHUNK_BIOME_EXTEND_TREE_FUNC = 2; // trees function compare width is 5x5
-constexpr int CHUNK_BIOME_EXTEND = CHUNK_BIOME_EXTEND_TREE_SIZE + CHUNK_BIOME_EXTEND_TREE_FUNC;
-constexpr int CHUNK_BIOME_EXTENDED_SIZE_XY = CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND * 2;
 
 OverworldWorldGenerator::OverworldWorldGenerator()
 {
 }
 
-float HeightFunc(const WorldCoords& coords, unsigned int seed, float heightScale = 30.0f, float heightBase = 60.0f)
+void HeightFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed, float heightScale = 30.0f, float heightBase = 60.0f)
 {
 	constexpr float          scale = 200.0f;
 	constexpr unsigned int   octaves = 5;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return heightBase + heightScale * Hesitate3(abs(Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed)));
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
+	for (int index = 0; index < count; index++)
+		values[index] = heightBase + heightScale * Hesitate3(abs(values[index]));
 }
 
-float HeightFunc2(const WorldCoords& coords, unsigned int seed, float heightScale = 30.0f, float heightBase = 60.0f)
+void HeightFunc2(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed, float heightScale = 30.0f, float heightBase = 60.0f)
 {
 	constexpr float          scale = 200.0f;
 	constexpr unsigned int   octaves = 5;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return heightBase + heightScale * Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed);
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
+	for (int index = 0; index < count; index++)
+		values[index] = heightBase + heightScale * values[index];
 }
 
-float HumidityFunc(const WorldCoords& coords, unsigned int seed)
+void HumidityFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
 {
 	constexpr float          scale = 500.0f;
 	constexpr unsigned int   octaves = 5;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed);
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
 }
 
-float TemperatureFunc(const WorldCoords& coords, unsigned int seed)
+void TemperatureFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
 {
 	constexpr float          scale = 500.0f;
 	constexpr unsigned int   octaves = 5;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed);
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
 }
 
-float HillinessFunc(const WorldCoords& coords, unsigned int seed)
+void HillinessFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
 {
 	constexpr float          scale = 50.0f;
 	constexpr unsigned int   octaves = 2;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return 5.0f * SmoothStart5(0.5f * (1.0f + Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed)));
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
+	for (int index = 0; index < count; index++)
+		values[index] = 5.0f * SmoothStart5(0.5f * (1.0f + values[index]));
 }
 
-float OceannessFunc(const WorldCoords& coords, unsigned int seed)
+void OceannessFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
 {
 	constexpr float          scale = 500.0f;
 	constexpr unsigned int   octaves = 5;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed);
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
 }
 
-float TreenessFunc(const WorldCoords& coords, unsigned int seed)
+void TreenessFunc(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
 {
 	constexpr float          scale = 800.0f;
 	constexpr unsigned int   octaves = 13;
 	constexpr float          octResist = 0.5f;
 	constexpr float          octScale = 2.0f;
 
-	return Compute2dPerlinNoise(float(coords.x), float(coords.y), scale, octaves, octResist, octScale, true, seed);
+	ComputePerlinNoise2dRow(values, rowStart.x, rowStart.y, count, scale, octaves, octResist, octScale, true, seed, step);
 }
 
 // GetRef: Get reference for extended 2d heat map for biome generation
 float& GetRef(float* extendedMap, const LocalCoords& coords)
 {
-	int index = coords.x + CHUNK_BIOME_EXTEND + CHUNK_BIOME_EXTENDED_SIZE_XY * (coords.y + CHUNK_BIOME_EXTEND);
-	// ASSERT_OR_DIE(index >= 0 && index < CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY, "Access violation");
+	int index = coords.x + CHUNK_GEN_EXTEND + CHUNK_GEN_EXTENDED_SIZE_XY * (coords.y + CHUNK_GEN_EXTEND);
+	// ASSERT_OR_DIE(index >= 0 && index < CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY, "Access violation");
 	return extendedMap[index];
 }
 
+// SampleExtendedMap: Fill extended 2d heat map of a chunk from cached noise tiles
+void WorldGenerator::SampleExtendedMap(float* extendedMap, const IntVec3& chunkOrigin, NoiseField field, unsigned int seed, NoiseFieldFunc func)
+{
+	IntVec2 mins = IntVec2(chunkOrigin.x - CHUNK_GEN_EXTEND, chunkOrigin.y - CHUNK_GEN_EXTEND);
+	IntVec2 size = IntVec2(CHUNK_GEN_EXTENDED_SIZE_XY, CHUNK_GEN_EXTENDED_SIZE_XY);
+	m_noiseCache.Sample(extendedMap, CHUNK_GEN_EXTENDED_SIZE_XY, mins, size, field, seed, func, m_fieldLatticeSteps[field]);
+}
+
+// SampleColumnMap: Fill a row major 2d map of arbitrary world columns from the same cached noise tiles
+void WorldGenerator::SampleColumnMap(float* columnMap, const IntVec2& worldMins, const IntVec2& size, NoiseField field, unsigned int seed, NoiseFieldFunc func)
+{
+	m_noiseCache.Sample(columnMap, size.x, worldMins, size, field, seed, func, m_fieldLatticeSteps[field]);
+}
+
+void HeightFuncDefault(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
+{
+	HeightFunc(values, count, rowStart, step, seed);
+}
+
+void HeightFunc2Default(float* values, int count, const WorldCoords& rowStart, int step, unsigned int seed)
+{
+	HeightFunc2(values, count, rowStart, step, seed);
+}
+
 bool IsTree(float* treenessMap, const LocalCoords& coords)
 {
 	int treeSelf = (int)GetRef(treenessMap, coords);
 
-	for (int offsetY = -CHUNK_BIOME_EXTEND_TREE_FUNC; offsetY <= CHUNK_BIOME_EXTEND_TREE_FUNC; offsetY++)
-		for (int offsetX = -CHUNK_BIOME_EXTEND_TREE_FUNC; offsetX <= CHUNK_BIOME_EXTEND_TREE_FUNC; offsetX++)
+	for (int offsetY = -CHUNK_GEN_EXTEND; offsetY <= CHUNK_GEN_EXTEND; offsetY++)
+		for (int offsetX = -CHUNK_GEN_EXTEND; offsetX <= CHUNK_GEN_EXTEND; offsetX++)
 		{
 			if (offsetX == 0 && offsetY == 0) // ignore self
 				continue;
@@ -221,6 +372,41 @@ bool IsTree(float* treenessMap, const LocalCoords& coords)
 	return true;
 }
 
+// ShapeOverworldHeight: Stretch the height above sea level by hilliness and pull it down to the ocean floor by oceanness
+float ShapeOverworldHeight(float height, float hilliness, float oceanness)
+{
+	height = (height > 64.0f) ? ((height - 64.0f) * hilliness + 64.0f) : height;
+
+	float oceanBlend = RangeMapClamped(oceanness, 0.0f, 0.5f, 0.0f, 1.0f);
+	return Lerp(height, (float)CHUNK_OCEAN_LEVEL, oceanBlend);
+}
+
+// block runs of one overworld column, shared by generation and surface queries
+struct OverworldColumn
+{
+	OverworldColumn(int height, float humidity, float temperature, float oceanness);
+
+	int  m_height;
+	int  m_sandFrom = CHUNK_SIZE_Z; // shores below sea level turn sand above the sand level and ice above the ice level
+	int  m_iceFrom = CHUNK_SIZE_Z;
+	bool m_sandFloor = false;
+	bool m_beach = false;
+};
+
+OverworldColumn::OverworldColumn(int height, float humidity, float temperature, float oceanness)
+	: m_height(height)
+{
+	if (height <= CHUNK_WATER_LEVEL)
+	{
+		float sandLevel = RangeMap(humidity, -0.1f, -0.2f, 64.0f, 60.0f);
+		float iceLevel  = RangeMap(temperature, -0.1f, -0.2f, 64.0f, 60.0f);
+		m_sandFrom = FirstAbove(sandLevel);
+		m_iceFrom = FirstAbove(iceLevel);
+		m_sandFloor = sandLevel <= CHUNK_WATER_LEVEL && oceanness <= 0;
+	}
+	m_beach = humidity < 0.1f && oceanness > -0.05f && height == CHUNK_WATER_LEVEL;
+}
+
 BlockTemplate TEMPLATE_TREE;
 
 bool InitTree()
@@ -240,9 +426,11 @@ bool InitTree()
 	return true;
 }
 
-void OverworldWorldGenerator::GenerateChunk(Chunk* chunk)
+void OverworldWorldGenerator::GenerateTerrain(ChunkGenContext& context)
 {
-	WorldCoords origin = chunk->GetChunkOrigin();
+	Chunk* chunk = context.m_chunk;
+	const WorldCoords& origin = context.m_origin;
+	const ChunkRandom& random = context.m_random;
 
 	unsigned int seed_Height      = m_seed + 0;
 	unsigned int seed_Humidity    = m_seed + 1;
@@ -252,146 +440,142 @@ void OverworldWorldGenerator::GenerateChunk(Chunk* chunk)
 	unsigned int seed_Oceanness   = m_seed + 5;
 	unsigned int seed_Lampness    = m_seed + 6;
 
-	float heightMap      [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float humidityMap    [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float temperatureMap [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float hillinessMap   [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float treenessMap    [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float lampnessMap    [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float oceannessMap   [CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
+	float* heightMap      = context.m_heightMap;
+	float* humidityMap    = context.m_humidityMap;
+	float* temperatureMap = context.m_temperatureMap;
+	float* hillinessMap   = context.m_hillinessMap;
+	float* treenessMap    = context.m_treenessMap;
+	float* lampnessMap    = context.m_lampnessMap;
+	float* oceannessMap   = context.m_oceannessMap;
+
+	SampleExtendedMap(heightMap,      origin, NOISE_FIELD_HEIGHT,      seed_Height,      HeightFuncDefault);
+	SampleExtendedMap(humidityMap,    origin, NOISE_FIELD_HUMIDITY,    seed_Humidity,    HumidityFunc);
+	SampleExtendedMap(temperatureMap, origin, NOISE_FIELD_TEMPERATURE, seed_Temperature, TemperatureFunc);
+	SampleExtendedMap(hillinessMap,   origin, NOISE_FIELD_HILLINESS,   seed_Hilliness,   HillinessFunc);
+	SampleExtendedMap(oceannessMap,   origin, NOISE_FIELD_OCEANNESS,   seed_Oceanness,   OceannessFunc);
+	SampleExtendedMap(treenessMap,    origin, NOISE_FIELD_TREENESS,    seed_Treeness,    TreenessFunc);
+	SampleExtendedMap(lampnessMap,    origin, NOISE_FIELD_TREENESS,    seed_Lampness,    TreenessFunc);
 
 	LocalCoords coords = IntVec3::ZERO;
-	int index = 0;
-	for (coords.y = -CHUNK_BIOME_EXTEND; coords.y < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND; coords.y++)
-		for (coords.x = -CHUNK_BIOME_EXTEND; coords.x < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND; coords.x++)
+	for (coords.y = -CHUNK_GEN_EXTEND; coords.y < (int)CHUNK_SIZE_XY + CHUNK_GEN_EXTEND; coords.y++)
+		for (coords.x = -CHUNK_GEN_EXTEND; coords.x < (int)CHUNK_SIZE_XY + CHUNK_GEN_EXTEND; coords.x++)
 		{
-			float height      = HeightFunc(origin + coords, seed_Height);
-			float humidity    = HumidityFunc(origin + coords, seed_Humidity);
-			float temperature = TemperatureFunc(origin + coords, seed_Temperature);
-			float hilliness   = HillinessFunc(origin + coords, seed_Hilliness);
-			float oceanness   = OceannessFunc(origin + coords, seed_Oceanness);
-
-			// process height with hilliness
-			height = (height > 64.0f) ? ((height - 64.0f) * hilliness + 64.0f) : height;
-
-			// process height with oceanness
-			float oceanBlend = RangeMapClamped(oceanness, 0.0f, 0.5f, 0.0f, 1.0f);
-			height = Lerp(height, (float)CHUNK_OCEAN_LEVEL, oceanBlend);
-			
-			GetRef(heightMap, coords) = height;
-			GetRef(hillinessMap, coords) = hilliness;
-			GetRef(oceannessMap, coords) = oceanness;
-			GetRef(humidityMap, coords) = humidity;
-			GetRef(temperatureMap, coords) = temperature;
-			GetRef(treenessMap, coords) = TreenessFunc(origin + coords, seed_Treeness) * 1000.0f;
-			GetRef(lampnessMap, coords) = TreenessFunc(origin + coords, seed_Lampness) * 1000.0f;
+			GetRef(heightMap, coords) = ShapeOverworldHeight(GetRef(heightMap, coords), GetRef(hillinessMap, coords), GetRef(oceannessMap, coords));
+			GetRef(treenessMap, coords) *= 1000.0f;
+			GetRef(lampnessMap, coords) *= 1000.0f;
 		}
 
-	index = 0;
-	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				int height = (int)GetRef(heightMap, coords);
-
-				unsigned char blockId = Blocks::BLOCK_AIR;
-				if (coords.z <= height)
-				{
-					// generate grass
-					if (height - coords.z == 0)
-					{
-						blockId = Blocks::BLOCK_GRASS;
-					}
-					// generate dirt
-					else if (height - coords.z < 5)
-					{
-						blockId = Blocks::BLOCK_DIRT;
-					}
-					// generate stone
-					else
-					{
-						blockId = Blocks::BLOCK_STONE;
-
-						// generate ores (stone -> ores)
-						float oreSeed = rng.RollRandomFloatZeroToOne();
-
-						if (oreSeed < 0.01f * 0.05f)
-							blockId = Blocks::BLOCK_DIAMOND_ORE;
-						else if (oreSeed < 0.01f * 0.25f)
-							blockId = Blocks::BLOCK_GOLD_ORE;
-						else if (oreSeed < 0.01f * 1.0f)
-							blockId = Blocks::BLOCK_IRON_ORE;
-						else if (oreSeed < 0.01f * 4.0f)
-							blockId = Blocks::BLOCK_COAL_ORE;
-					}
-				}
-
-
-				// generate beach
-				if (GetRef(humidityMap, coords) < 0.1f)
-				{
-					if (GetRef(oceannessMap, coords) > -0.05f)
-					{
-						if (coords.z == CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_GRASS)
-							blockId = Blocks::BLOCK_SAND;
-					}
-				}
-
-				// replace air to water below water level
-				if (blockId == Blocks::BLOCK_AIR && coords.z <= CHUNK_WATER_LEVEL)
-					blockId = Blocks::BLOCK_WATER; // GetRef(oceannessMap, coords) > 0 ? Blocks::BLOCK_RED_BRICK : Blocks::BLOCK_WATER;
-
-				// sand & ice
-				if (height <= CHUNK_WATER_LEVEL)
-				{
-					float sandLevel = RangeMap(GetRef(humidityMap, coords), -0.1f, -0.2f, 64.0f, 60.0f);
-					float iceLevel  = RangeMap(GetRef(temperatureMap , coords), -0.1f, -0.2f, 64.0f, 60.0f); ;
-
-					// water ->ice
-					if (coords.z > iceLevel && blockId == Blocks::BLOCK_WATER)
-						blockId = Blocks::BLOCK_ICE;
-
-					// water -> sand
-					if (sandLevel <= CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_WATER && GetRef(oceannessMap, coords) <= 0)
-						blockId = Blocks::BLOCK_SAND;
-
-					// grass & dirt -> sand
-					if (coords.z > sandLevel && (blockId == Blocks::BLOCK_DIRT || blockId == Blocks::BLOCK_GRASS))
-						blockId = Blocks::BLOCK_SAND;
-				}
+	// column runs: stone, dirt and surface up to the height, water up to sea level, air above
+	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+		{
+			int column = Chunk::GetIndex(IntVec3(coords.x, coords.y, 0));
+			OverworldColumn runs((int)GetRef(heightMap, coords), GetRef(humidityMap, coords), GetRef(temperatureMap, coords), GetRef(oceannessMap, coords));
+			int height = runs.m_height;
+			int sandFrom = runs.m_sandFrom;
+			int iceFrom = runs.m_iceFrom;
+			bool sandFloor = runs.m_sandFloor;
+			bool beach = runs.m_beach;
+
+			FillColumn(chunk, column, 0, height - 5, Blocks::BLOCK_STONE);
+			FillOres(chunk, random, column, 0, height - 5);
+			FillColumn(chunk, column, height - 4, Min(height - 1, sandFrom - 1), Blocks::BLOCK_DIRT);
+			FillColumn(chunk, column, Max(height - 4, sandFrom), height - 1, Blocks::BLOCK_SAND);
+			FillColumn(chunk, column, height, height, (beach || height >= sandFrom) ? Blocks::BLOCK_SAND : Blocks::BLOCK_GRASS);
+			FillColumn(chunk, column, height + 1, Min(CHUNK_WATER_LEVEL, iceFrom - 1), sandFloor ? Blocks::BLOCK_SAND : Blocks::BLOCK_WATER);
+			FillColumn(chunk, column, Max(height + 1, iceFrom), CHUNK_WATER_LEVEL, Blocks::BLOCK_ICE);
+			FillColumn(chunk, column, Max(height + 1, CHUNK_WATER_LEVEL + 1), CHUNK_MAX_Z, Blocks::BLOCK_AIR);
+		}
+}
 
-				chunk->m_blockArray[index].SetBlockId(blockId);
-				index++;
-			}
+void OverworldWorldGenerator::QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size)
+{
+	unsigned int seed_Height      = m_seed + 0;
+	unsigned int seed_Humidity    = m_seed + 1;
+	unsigned int seed_Temperature = m_seed + 2;
+	unsigned int seed_Hilliness   = m_seed + 3;
+	unsigned int seed_Oceanness   = m_seed + 5;
 
+	int count = size.x * size.y;
+	std::vector<float> heightMap(count);
+	std::vector<float> humidityMap(count);
+	std::vector<float> temperatureMap(count);
+	std::vector<float> hillinessMap(count);
+	std::vector<float> oceannessMap(count);
+	SampleColumnMap(heightMap.data(),      worldMins, size, NOISE_FIELD_HEIGHT,      seed_Height,      HeightFuncDefault);
+	SampleColumnMap(humidityMap.data(),    worldMins, size, NOISE_FIELD_HUMIDITY,    seed_Humidity,    HumidityFunc);
+	SampleColumnMap(temperatureMap.data(), worldMins, size, NOISE_FIELD_TEMPERATURE, seed_Temperature, TemperatureFunc);
+	SampleColumnMap(hillinessMap.data(),   worldMins, size, NOISE_FIELD_HILLINESS,   seed_Hilliness,   HillinessFunc);
+	SampleColumnMap(oceannessMap.data(),   worldMins, size, NOISE_FIELD_OCEANNESS,   seed_Oceanness,   OceannessFunc);
+
+	for (int index = 0; index < count; index++)
+	{
+		ColumnInfo& info = columns[index];
+		info.m_humidity = humidityMap[index];
+		info.m_temperature = temperatureMap[index];
+		info.m_hilliness = hillinessMap[index];
+		info.m_oceanness = oceannessMap[index];
+
+		float height = ShapeOverworldHeight(heightMap[index], hillinessMap[index], oceannessMap[index]);
+		OverworldColumn runs((int)height, info.m_humidity, info.m_temperature, info.m_oceanness);
+		info.m_height = height;
+
+		info.m_groundZ = TopOfRun(0, runs.m_height);
+		info.m_surfaceZ = info.m_groundZ;
+		if (runs.m_height > (int)CHUNK_MAX_Z) // mountains cut off at the top of the world
+			info.m_surfaceBlock = runs.m_height - 5 >= (int)CHUNK_MAX_Z ? Blocks::BLOCK_STONE : Blocks::BLOCK_DIRT;
+		else
+			info.m_surfaceBlock = (runs.m_beach || runs.m_height >= runs.m_sandFrom) ? Blocks::BLOCK_SAND : Blocks::BLOCK_GRASS;
+
+		if (runs.m_height < CHUNK_WATER_LEVEL) // water up to sea level, under ice or filled with sand
+		{
+			info.m_surfaceZ = CHUNK_WATER_LEVEL;
+			if (runs.m_iceFrom <= CHUNK_WATER_LEVEL)
+				info.m_surfaceBlock = Blocks::BLOCK_ICE;
+			else
+				info.m_surfaceBlock = runs.m_sandFloor ? Blocks::BLOCK_SAND : Blocks::BLOCK_WATER;
+			if (info.m_surfaceBlock != Blocks::BLOCK_WATER)
+				info.m_groundZ = CHUNK_WATER_LEVEL;
+		}
+	}
+}
 
-	// generate trees
-	static const bool initTree = InitTree(); // thread safe
+void OverworldWorldGenerator::GenerateSurface(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
 
-	for (coords.y = -CHUNK_BIOME_EXTEND_TREE_SIZE; coords.y < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND_TREE_SIZE; coords.y++)
-		for (coords.x = -CHUNK_BIOME_EXTEND_TREE_SIZE; coords.x < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND_TREE_SIZE; coords.x++)
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.y = 0; coords.y < (int)CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < (int)CHUNK_SIZE_XY; coords.x++)
 		{
-			if (IsTree(treenessMap, coords) && GetRef(humidityMap, coords) > 0.0f && GetRef(temperatureMap, coords) > 0.0f)
+			if (IsTree(context.m_lampnessMap, coords) && GetRef(context.m_humidityMap, coords) < 0.0f && GetRef(context.m_oceannessMap, coords) < -0.05f)
 			{
-				coords.z = (int)GetRef(heightMap, coords);
-				if (coords.z >= CHUNK_WATER_LEVEL)
+				coords.z = (int)GetRef(context.m_heightMap, coords);
+				if (chunk->GetBlockId(coords) == Blocks::BLOCK_GRASS && coords.z >= CHUNK_WATER_LEVEL)
 				{
 					coords.z++;
-					TEMPLATE_TREE.PlaceOn(chunk, coords);
+					chunk->m_blockArray[Chunk::GetIndex(coords)].SetBlockId(Blocks::BLOCK_GLOWSTONE);
 				}
 			}
 		}
+}
 
+void OverworldWorldGenerator::GenerateFeatures(ChunkGenContext& context)
+{
+	static const bool initTree = InitTree(); // thread safe
+
+	// trees rooted in this chunk, leaves over the border go to the neighbor through the feature queue
+	LocalCoords coords = IntVec3::ZERO;
 	for (coords.y = 0; coords.y < (int)CHUNK_SIZE_XY; coords.y++)
 		for (coords.x = 0; coords.x < (int)CHUNK_SIZE_XY; coords.x++)
 		{
-			if (IsTree(lampnessMap, coords) && GetRef(humidityMap, coords) < 0.0f && GetRef(oceannessMap, coords) < -0.05f)
+			if (IsTree(context.m_treenessMap, coords) && GetRef(context.m_humidityMap, coords) > 0.0f && GetRef(context.m_temperatureMap, coords) > 0.0f)
 			{
-				coords.z = (int)GetRef(heightMap, coords);
-				if (chunk->GetBlockId(coords) == Blocks::BLOCK_GRASS && coords.z >= CHUNK_WATER_LEVEL)
+				coords.z = (int)GetRef(context.m_heightMap, coords);
+				if (coords.z >= CHUNK_WATER_LEVEL)
 				{
 					coords.z++;
-					chunk->m_blockArray[Chunk::GetIndex(coords)].SetBlockId(Blocks::BLOCK_GLOWSTONE);
+					PlaceFeature(context, TEMPLATE_TREE, coords);
 				}
 			}
 		}
@@ -437,9 +621,28 @@ SkyBlockWorldGenerator::SkyBlockWorldGenerator()
 
 }
 
-void SkyBlockWorldGenerator::GenerateChunk(Chunk* chunk)
+// ShapeSkyBlockHeights: Turn the two height fields into the top of the terrain and the bottom of the islands
+void ShapeSkyBlockHeights(float& height1, float& height2, float hilliness)
+{
+	// process height with hilliness
+	height1 = (height1 > 64.0f) ? ((height1 - 64.0f) * hilliness + 64.0f) : height1;
+	height2 = (height2 > 64.0f) ? ((height2 - 64.0f) * 5.0f + 64.0f) : height2;
+	height2 = 64.0f + -(height2 - 64.0f);
+
+	height1 = 64.0f + Clamp(height1 - 64.0f, height1 - 64.0f, Clamp(64.0f - height2, 0.0f, 64.0f - height2));
+
+	if (height2 >= 60.0f)
+		height1 -= height2 - 60;
+
+	if (height2 >= 64.0f)
+		height2 += 50;
+}
+
+void SkyBlockWorldGenerator::GenerateTerrain(ChunkGenContext& context)
 {
-	WorldCoords origin = chunk->GetChunkOrigin();
+	Chunk* chunk = context.m_chunk;
+	const WorldCoords& origin = context.m_origin;
+	const ChunkRandom& random = context.m_random;
 
 	unsigned int seed_Height1 = m_seed + 0;
 	unsigned int seed_Height2 = m_seed + 20;
@@ -448,189 +651,434 @@ void SkyBlockWorldGenerator::GenerateChunk(Chunk* chunk)
 	unsigned int seed_Hilliness = m_seed + 3;
 	unsigned int seed_Treeness = m_seed + 4;
 	unsigned int seed_Lampness = m_seed + 6;
-
-	float height1Map[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float height2Map[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float humidityMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float temperatureMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float hillinessMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float treenessMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float lampnessMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
-	float oceannessMap[CHUNK_BIOME_EXTENDED_SIZE_XY * CHUNK_BIOME_EXTENDED_SIZE_XY];
+	unsigned int seed_Oceanness = m_seed + 5;
+
+	float* height1Map = context.m_heightMap;
+	float* height2Map = context.m_height2Map;
+	float* humidityMap = context.m_humidityMap;
+	float* temperatureMap = context.m_temperatureMap;
+	float* hillinessMap = context.m_hillinessMap;
+	float* treenessMap = context.m_treenessMap;
+	float* lampnessMap = context.m_lampnessMap;
+	float* oceannessMap = context.m_oceannessMap;
+
+	SampleExtendedMap(height1Map,     origin, NOISE_FIELD_HEIGHT,      seed_Height1,     HeightFuncDefault);
+	SampleExtendedMap(height2Map,     origin, NOISE_FIELD_HEIGHT2,     seed_Height2,     HeightFunc2Default);
+	SampleExtendedMap(humidityMap,    origin, NOISE_FIELD_HUMIDITY,    seed_Humidity,    HumidityFunc);
+	SampleExtendedMap(temperatureMap, origin, NOISE_FIELD_TEMPERATURE, seed_Temperature, TemperatureFunc);
+	SampleExtendedMap(hillinessMap,   origin, NOISE_FIELD_HILLINESS,   seed_Hilliness,   HillinessFunc);
+	SampleExtendedMap(treenessMap,    origin, NOISE_FIELD_TREENESS,    seed_Treeness,    TreenessFunc);
+	SampleExtendedMap(lampnessMap,    origin, NOISE_FIELD_TREENESS,    seed_Lampness,    TreenessFunc);
+	SampleExtendedMap(oceannessMap,   origin, NOISE_FIELD_OCEANNESS,   seed_Oceanness,   OceannessFunc); // shores and lamps
 
 	LocalCoords coords = IntVec3::ZERO;
 	int index = 0;
-	for (coords.y = -CHUNK_BIOME_EXTEND; coords.y < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND; coords.y++)
-		for (coords.x = -CHUNK_BIOME_EXTEND; coords.x < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND; coords.x++)
+	for (coords.y = -CHUNK_GEN_EXTEND; coords.y < (int)CHUNK_SIZE_XY + CHUNK_GEN_EXTEND; coords.y++)
+		for (coords.x = -CHUNK_GEN_EXTEND; coords.x < (int)CHUNK_SIZE_XY + CHUNK_GEN_EXTEND; coords.x++)
 		{
-			float height1 = HeightFunc(origin + coords, seed_Height1);
-			float height2 = HeightFunc2(origin + coords, seed_Height2);
-			float humidity = HumidityFunc(origin + coords, seed_Humidity);
-			float temperature = TemperatureFunc(origin + coords, seed_Temperature);
-			float hilliness = HillinessFunc(origin + coords, seed_Hilliness);
+			ShapeSkyBlockHeights(GetRef(height1Map, coords), GetRef(height2Map, coords), GetRef(hillinessMap, coords));
+			GetRef(treenessMap, coords) *= 1000.0f;
+			GetRef(lampnessMap, coords) *= 1000.0f;
+		}
 
-			// process height with hilliness
-			height1 = (height1 > 64.0f) ? ((height1 - 64.0f) * hilliness + 64.0f) : height1;
-			height2 = (height2 > 64.0f) ? ((height2 - 64.0f) * 5.0f + 64.0f) : height2;
-			height2 = 64.0f + -(height2 - 64.0f);
+	// column runs: terrain between the two heights, shallow fill and water up to sea level above the lower one
+	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+		{
+			int column = Chunk::GetIndex(IntVec3(coords.x, coords.y, 0));
+			int height1 = (int)GetRef(height1Map, coords);
+			int height2 = (int)GetRef(height2Map, coords);
+			int terrainMin = height2 + 1;
+			int fillMin = Max(height1, height2) + 1;
+
+			int sandFrom = CHUNK_SIZE_Z;
+			if (height1 <= CHUNK_WATER_LEVEL)
+				sandFrom = FirstAbove(RangeMap(GetRef(humidityMap, coords), -0.1f, -0.2f, 64.0f, 60.0f));
+			bool beach = GetRef(humidityMap, coords) < 0.1f && GetRef(oceannessMap, coords) > -0.05f && height1 == CHUNK_WATER_LEVEL;
+
+			FillColumn(chunk, column, 0, height2, Blocks::BLOCK_AIR);
+			FillColumn(chunk, column, terrainMin, height1 - 5, Blocks::BLOCK_STONE);
+			FillOres(chunk, random, column, terrainMin, height1 - 5);
+			FillColumn(chunk, column, Max(terrainMin, height1 - 4), Min(height1 - 1, sandFrom - 1), Blocks::BLOCK_DIRT);
+			FillColumn(chunk, column, Max(terrainMin, Max(height1 - 4, sandFrom)), height1 - 1, Blocks::BLOCK_SAND);
+			if (height1 >= terrainMin)
+				FillColumn(chunk, column, height1, height1, (beach || height1 >= sandFrom) ? Blocks::BLOCK_SAND : Blocks::BLOCK_GRASS);
+
+			// five blocks of ground over the lower terrain, grass at sea level
+			FillColumn(chunk, column, fillMin, Min(height2 + 5, CHUNK_WATER_LEVEL - 1), Blocks::BLOCK_DIRT);
+			if (fillMin <= CHUNK_WATER_LEVEL && CHUNK_WATER_LEVEL <= height2 + 5)
+				FillColumn(chunk, column, CHUNK_WATER_LEVEL, CHUNK_WATER_LEVEL, Blocks::BLOCK_GRASS);
+			FillColumn(chunk, column, Max(fillMin, height2 + 6), CHUNK_WATER_LEVEL, Blocks::BLOCK_WATER);
+			FillColumn(chunk, column, Max(fillMin, CHUNK_WATER_LEVEL + 1), CHUNK_MAX_Z, Blocks::BLOCK_AIR);
+		}
 
-			height2 += 0;
 
-			height1 = 64.0f + Clamp(height1 - 64.0f, height1 - 64.0f, Clamp(64.0f - height2, 0.0f, 64.0f - height2));
+	index = 0;
+	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
+		{
+			BlockId blockId = Blocks::BLOCK_AIR;
 
-			if (height2 >= 60.0f)
-				height1 -= height2 - 60;
+			for (coords.z = CHUNK_MAX_Z; coords.z >= 0; coords.z--)
+			{
+				index = Chunk::GetIndex(coords);
 
-			if (height2 >= 64.0f)
-				height2 += 50;
+				if (chunk->m_blockArray[index].GetBlockId() == Blocks::BLOCK_WATER)
+					blockId = Blocks::BLOCK_WATER;
+				if (chunk->m_blockArray[index].IsOpaque())
+					blockId = Blocks::BLOCK_AIR;
 
+				if (chunk->m_blockArray[index].GetBlockId() == Blocks::BLOCK_AIR)
+					chunk->m_blockArray[index].SetBlockId(blockId);
+			}
+		}
+}
 
-			GetRef(height1Map, coords) = height1;
-			GetRef(height2Map, coords) = height2 - 0.0f;
-			GetRef(hillinessMap, coords) = hilliness;
-			GetRef(humidityMap, coords) = humidity;
-			GetRef(temperatureMap, coords) = temperature;
-			GetRef(treenessMap, coords) = TreenessFunc(origin + coords, seed_Treeness) * 1000.0f;
-			GetRef(lampnessMap, coords) = TreenessFunc(origin + coords, seed_Lampness) * 1000.0f;
+void SkyBlockWorldGenerator::QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size)
+{
+	unsigned int seed_Height1 = m_seed + 0;
+	unsigned int seed_Height2 = m_seed + 20;
+	unsigned int seed_Humidity = m_seed + 1;
+	unsigned int seed_Temperature = m_seed + 2;
+	unsigned int seed_Hilliness = m_seed + 3;
+	unsigned int seed_Oceanness = m_seed + 5;
+
+	int count = size.x * size.y;
+	std::vector<float> height1Map(count);
+	std::vector<float> height2Map(count);
+	std::vector<float> humidityMap(count);
+	std::vector<float> temperatureMap(count);
+	std::vector<float> hillinessMap(count);
+	std::vector<float> oceannessMap(count);
+	SampleColumnMap(height1Map.data(),     worldMins, size, NOISE_FIELD_HEIGHT,      seed_Height1,     HeightFuncDefault);
+	SampleColumnMap(height2Map.data(),     worldMins, size, NOISE_FIELD_HEIGHT2,     seed_Height2,     HeightFunc2Default);
+	SampleColumnMap(humidityMap.data(),    worldMins, size, NOISE_FIELD_HUMIDITY,    seed_Humidity,    HumidityFunc);
+	SampleColumnMap(temperatureMap.data(), worldMins, size, NOISE_FIELD_TEMPERATURE, seed_Temperature, TemperatureFunc);
+	SampleColumnMap(hillinessMap.data(),   worldMins, size, NOISE_FIELD_HILLINESS,   seed_Hilliness,   HillinessFunc);
+	SampleColumnMap(oceannessMap.data(),   worldMins, size, NOISE_FIELD_OCEANNESS,   seed_Oceanness,   OceannessFunc);
+
+	for (int index = 0; index < count; index++)
+	{
+		ColumnInfo& info = columns[index];
+		info = ColumnInfo();
+		info.m_humidity = humidityMap[index];
+		info.m_temperature = temperatureMap[index];
+		info.m_hilliness = hillinessMap[index];
+		info.m_oceanness = oceannessMap[index];
+
+		info.m_surfaceBlock = Blocks::BLOCK_AIR;
+
+		ShapeSkyBlockHeights(height1Map[index], height2Map[index], hillinessMap[index]);
+		int height1 = (int)height1Map[index];
+		int height2 = (int)height2Map[index];
+		int terrainMin = height2 + 1;
+		int fillMin = Max(height1, height2) + 1;
+
+		// terrain between the two heights, topped with grass or sand unless cut off at the top of the world
+		int terrainTop = height1 >= terrainMin ? TopOfRun(terrainMin, height1) : -1;
+		if (terrainTop >= 0)
+		{
+			int sandFrom = CHUNK_SIZE_Z;
+			if (height1 <= CHUNK_WATER_LEVEL)
+				sandFrom = FirstAbove(RangeMap(info.m_humidity, -0.1f, -0.2f, 64.0f, 60.0f));
+			bool beach = info.m_humidity < 0.1f && info.m_oceanness > -0.05f && height1 == CHUNK_WATER_LEVEL;
+
+			info.m_groundZ = terrainTop;
+			if (terrainTop < height1)
+				info.m_surfaceBlock = terrainTop <= height1 - 5 ? Blocks::BLOCK_STONE : Blocks::BLOCK_DIRT;
+			else
+				info.m_surfaceBlock = (beach || height1 >= sandFrom) ? Blocks::BLOCK_SAND : Blocks::BLOCK_GRASS;
 		}
 
-	index = 0;
-	for (coords.z = 0; coords.z < CHUNK_SIZE_Z; coords.z++)
-		for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-			for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-			{
-				int height1 = (int)GetRef(height1Map, coords);
-				int height2 = (int)GetRef(height2Map, coords);
+		// ground over the lower terrain reaches sea level as grass, water above it
+		int fillTop = TopOfRun(fillMin, Min(height2 + 5, CHUNK_WATER_LEVEL));
+		if (fillTop >= 0)
+		{
+			info.m_groundZ = fillTop;
+			info.m_surfaceBlock = fillTop == CHUNK_WATER_LEVEL ? Blocks::BLOCK_GRASS : Blocks::BLOCK_DIRT;
+		}
+		info.m_surfaceZ = info.m_groundZ;
+		if (TopOfRun(Max(fillMin, height2 + 6), CHUNK_WATER_LEVEL) >= 0)
+		{
+			info.m_surfaceZ = CHUNK_WATER_LEVEL;
+			info.m_surfaceBlock = Blocks::BLOCK_WATER;
+		}
+	}
+}
 
-				unsigned char blockId = Blocks::BLOCK_AIR;
+void SkyBlockWorldGenerator::GenerateSurface(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
 
-				if (coords.z <= height1 && coords.z > height2)
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.y = 0; coords.y < (int)CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < (int)CHUNK_SIZE_XY; coords.x++)
+		{
+			int height2 = (int)GetRef(context.m_height2Map, coords);
+			if (IsTree(context.m_lampnessMap, coords) && GetRef(context.m_humidityMap, coords) < 0.0f && GetRef(context.m_oceannessMap, coords) < -0.05f && height2 <= 64.0f)
+			{
+				coords.z = (int)GetRef(context.m_heightMap, coords);
+				if (chunk->GetBlockId(coords) == Blocks::BLOCK_GRASS && coords.z >= CHUNK_WATER_LEVEL)
 				{
-					// generate grass
-					if (height1 - coords.z == 0)
-					{
-						blockId = Blocks::BLOCK_GRASS;
-					}
-					// generate dirt
-					else if (height1 - coords.z < 5)
-					{
-						blockId = Blocks::BLOCK_DIRT;
-					}
-					// generate stone
-					else
-					{
-						blockId = Blocks::BLOCK_STONE;
-
-						// generate ores (stone -> ores)
-						float oreSeed = rng.RollRandomFloatZeroToOne();
-
-						if (oreSeed < 0.01f * 0.05f)
-							blockId = Blocks::BLOCK_DIAMOND_ORE;
-						else if (oreSeed < 0.01f * 0.25f)
-							blockId = Blocks::BLOCK_GOLD_ORE;
-						else if (oreSeed < 0.01f * 1.0f)
-							blockId = Blocks::BLOCK_IRON_ORE;
-						else if (oreSeed < 0.01f * 4.0f)
-							blockId = Blocks::BLOCK_COAL_ORE;
-					}
+					coords.z++;
+					chunk->m_blockArray[Chunk::GetIndex(coords)].SetBlockId(Blocks::BLOCK_GLOWSTONE);
 				}
+			}
+		}
+}
 
+void SkyBlockWorldGenerator::GenerateFeatures(ChunkGenContext& context)
+{
+	static const bool initTree = InitTree(); // thread safe
 
-				// generate beach
-				if (GetRef(humidityMap, coords) < 0.1f)
+	LocalCoords coords = IntVec3::ZERO;
+	for (coords.y = 0; coords.y < (int)CHUNK_SIZE_XY; coords.y++)
+		for (coords.x = 0; coords.x < (int)CHUNK_SIZE_XY; coords.x++)
+		{
+			int height2 = (int)GetRef(context.m_height2Map, coords);
+			if (IsTree(context.m_treenessMap, coords) && GetRef(context.m_humidityMap, coords) > 0.0f && GetRef(context.m_temperatureMap, coords) > 0.0f && height2 <= 64.0f)
+			{
+				coords.z = (int)GetRef(context.m_heightMap, coords);
+				if (coords.z >= CHUNK_WATER_LEVEL)
 				{
-					if (GetRef(oceannessMap, coords) > -0.05f)
-					{
-						if (coords.z == CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_GRASS)
-							blockId = Blocks::BLOCK_SAND;
-					}
+					coords.z++;
+					PlaceFeature(context, TEMPLATE_TREE, coords);
 				}
+			}
+		}
+}
 
-				// replace air to water below water level
-				if (blockId == Blocks::BLOCK_AIR && coords.z <= CHUNK_WATER_LEVEL && coords.z > height2)
-				{
-					if (coords.z > height2 + 5)
-						blockId = Blocks::BLOCK_WATER;
-					else if (coords.z == CHUNK_WATER_LEVEL)
-						blockId = Blocks::BLOCK_GRASS;
-					else
-						blockId = Blocks::BLOCK_DIRT;
-				}
+// =======================================================================================================
+// ====================================   DENSITY GENERATION   ===========================================
+// =======================================================================================================
 
-				// sand & ice
-				if (height1 <= CHUNK_WATER_LEVEL && coords.z <= height1 && coords.z > height2)
-				{
-					float sandLevel = RangeMap(GetRef(humidityMap, coords), -0.1f, -0.2f, 64.0f, 60.0f);
-					float iceLevel = RangeMap(GetRef(temperatureMap, coords), -0.1f, -0.2f, 64.0f, 60.0f); ;
+constexpr int   DENSITY_CELL_XY        = 4;
+constexpr int   DENSITY_CELL_Z         = 8;
+constexpr int   DENSITY_LATTICE_XY     = CHUNK_SIZE_XY / DENSITY_CELL_XY + 1;
+constexpr int   DENSITY_LATTICE_Z      = CHUNK_SIZE_Z / DENSITY_CELL_Z + 1;
+constexpr float DENSITY_HEIGHT_SQUASH  = 12.0f; // blocks over which the height gradient cancels full noise
+constexpr float DENSITY_NOISE_STRENGTH = 0.9f;
+constexpr float DENSITY_CAVE_WIDTH     = 0.08f; // tunnels follow the zero set of the cave field
+constexpr float DENSITY_CAVE_STRENGTH  = 2.5f;
+
+// SampleDensity: Positive is ground, the heightmap surface bent by 3d noise and cut by tunnels
+float SampleDensity(const WorldCoords& coords, float surface, unsigned int seed)
+{
+	float x = (float)coords.x;
+	float y = (float)coords.y;
+	float z = (float)coords.z;
+
+	float density = (surface - z) / DENSITY_HEIGHT_SQUASH;
+	if (density + DENSITY_NOISE_STRENGTH <= 0.0f)
+		return density; // high above the surface no noise lifts it to ground and tunnels only carve
+	density += DENSITY_NOISE_STRENGTH * Compute3dPerlinNoise(x, y, z, 64.0f, 3, 0.5f, 2.0f, true, seed);
+
+	float cave = fabsf(Compute3dPerlinNoise(x, y, z * 1.5f, 48.0f, 2, 0.5f, 2.0f, true, seed + 1));
+	if (cave < DENSITY_CAVE_WIDTH)
+		density -= DENSITY_CAVE_STRENGTH * (1.0f - cave / DENSITY_CAVE_WIDTH);
+	return density;
+}
+
+void DensityWorldGenerator::GenerateTerrain(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
+	const WorldCoords& origin = context.m_origin;
+	const ChunkRandom& random = context.m_random;
+
+	unsigned int seed_Height  = m_seed + 0;
+	unsigned int seed_Density = m_seed + 30;
 
-					// water ->ice
-					if (coords.z > iceLevel && blockId == Blocks::BLOCK_WATER)
-						blockId = Blocks::BLOCK_ICE;
+	SampleExtendedMap(context.m_heightMap, origin, NOISE_FIELD_HEIGHT, seed_Height, HeightFuncDefault);
 
-					// water -> sand
-					if (sandLevel <= CHUNK_WATER_LEVEL && blockId == Blocks::BLOCK_WATER && GetRef(oceannessMap, coords) <= 0)
-						blockId = Blocks::BLOCK_SAND;
+	float density[DENSITY_LATTICE_Z][DENSITY_LATTICE_XY][DENSITY_LATTICE_XY];
+	for (int latticeZ = 0; latticeZ < DENSITY_LATTICE_Z; latticeZ++)
+		for (int latticeY = 0; latticeY < DENSITY_LATTICE_XY; latticeY++)
+			for (int latticeX = 0; latticeX < DENSITY_LATTICE_XY; latticeX++)
+			{
+				LocalCoords coords = IntVec3(latticeX * DENSITY_CELL_XY, latticeY * DENSITY_CELL_XY, latticeZ * DENSITY_CELL_Z);
+				float surface = GetRef(context.m_heightMap, coords); // the far lattice row lies in the extended border
+				density[latticeZ][latticeY][latticeX] = SampleDensity(origin + coords, surface, seed_Density);
+			}
 
-					// grass & dirt -> sand
-					if (coords.z > sandLevel && (blockId == Blocks::BLOCK_DIRT || blockId == Blocks::BLOCK_GRASS))
-						blockId = Blocks::BLOCK_SAND;
+	size_t skippedCells = 0;
+	size_t interpolatedCells = 0;
+	for (int cellZ = 0; cellZ < DENSITY_LATTICE_Z - 1; cellZ++)
+		for (int cellY = 0; cellY < DENSITY_LATTICE_XY - 1; cellY++)
+			for (int cellX = 0; cellX < DENSITY_LATTICE_XY - 1; cellX++)
+			{
+				float d000 = density[cellZ    ][cellY    ][cellX    ];
+				float d100 = density[cellZ    ][cellY    ][cellX + 1];
+				float d010 = density[cellZ    ][cellY + 1][cellX    ];
+				float d110 = density[cellZ    ][cellY + 1][cellX + 1];
+				float d001 = density[cellZ + 1][cellY    ][cellX    ];
+				float d101 = density[cellZ + 1][cellY    ][cellX + 1];
+				float d011 = density[cellZ + 1][cellY + 1][cellX    ];
+				float d111 = density[cellZ + 1][cellY + 1][cellX + 1];
+				float lowest  = Min(Min(Min(d000, d100), Min(d010, d110)), Min(Min(d001, d101), Min(d011, d111)));
+				float highest = Max(Max(Max(d000, d100), Max(d010, d110)), Max(Max(d001, d101), Max(d011, d111)));
+
+				int zMin = cellZ * DENSITY_CELL_Z;
+				int zMax = zMin + DENSITY_CELL_Z - 1;
+				if (lowest > 0.0f || highest <= 0.0f)
+				{
+					for (int y = 0; y < DENSITY_CELL_XY; y++)
+						for (int x = 0; x < DENSITY_CELL_XY; x++)
+						{
+							int column = Chunk::GetIndex(IntVec3(cellX * DENSITY_CELL_XY + x, cellY * DENSITY_CELL_XY + y, 0));
+							FillColumn(chunk, column, zMin, zMax, lowest > 0.0f ? Blocks::BLOCK_STONE : Blocks::BLOCK_AIR);
+							if (lowest > 0.0f)
+								FillOres(chunk, random, column, zMin, zMax);
+						}
+					skippedCells++;
+					continue;
 				}
 
-				chunk->m_blockArray[index].SetBlockId(blockId);
-				index++;
+				for (int y = 0; y < DENSITY_CELL_XY; y++)
+				{
+					float ty = (float)y / (float)DENSITY_CELL_XY;
+					float bottom0 = Lerp(d000, d010, ty);
+					float bottom1 = Lerp(d100, d110, ty);
+					float top0    = Lerp(d001, d011, ty);
+					float top1    = Lerp(d101, d111, ty);
+					for (int x = 0; x < DENSITY_CELL_XY; x++)
+					{
+						float tx = (float)x / (float)DENSITY_CELL_XY;
+						float bottom = Lerp(bottom0, bottom1, tx);
+						float top    = Lerp(top0, top1, tx);
+						int column = Chunk::GetIndex(IntVec3(cellX * DENSITY_CELL_XY + x, cellY * DENSITY_CELL_XY + y, 0));
+						float step = (top - bottom) / (float)DENSITY_CELL_Z;
+						float value = bottom;
+						for (int z = zMin; z <= zMax; z++, value += step)
+						{
+							chunk->m_blockArray[column + (z << CHUNK_BITSHIFT_Z)].SetBlockId(value > 0.0f ? Blocks::BLOCK_STONE : Blocks::BLOCK_AIR);
+							if (value > 0.0f)
+								FillOres(chunk, random, column, z, z);
+						}
+					}
+				}
+				interpolatedCells++;
 			}
 
+	m_skippedCells += skippedCells;
+	m_interpolatedCells += interpolatedCells;
+}
 
-	index = 0;
-	for (coords.y = 0; coords.y < CHUNK_SIZE_XY; coords.y++)
-		for (coords.x = 0; coords.x < CHUNK_SIZE_XY; coords.x++)
-		{
-			BlockId blockId = Blocks::BLOCK_AIR;
+void DensityWorldGenerator::GenerateSurface(ChunkGenContext& context)
+{
+	Chunk* chunk = context.m_chunk;
 
-			for (coords.z = CHUNK_MAX_Z; coords.z >= 0; coords.z--)
+	// top down per column: open air below sea level floods, the first ground under the sky gets grass or sand and dirt
+	for (int column = 0; column < (int)CHUNK_SIZE_COLUMNS; column++)
+	{
+		int groundDepth = -1;
+		BlockId topBlock = Blocks::BLOCK_GRASS;
+		for (int z = CHUNK_MAX_Z; z >= 0 && groundDepth < 3; z--)
+		{
+			Block& block = chunk->m_blockArray[column + (z << CHUNK_BITSHIFT_Z)];
+			if (block.GetBlockId() == Blocks::BLOCK_AIR)
 			{
-				index = Chunk::GetIndex(coords);
-
-				if (chunk->m_blockArray[index].GetBlockId() == Blocks::BLOCK_WATER)
-					blockId = Blocks::BLOCK_WATER;
-				if (chunk->m_blockArray[index].IsOpaque())
-					blockId = Blocks::BLOCK_AIR;
+				if (groundDepth < 0 && z <= CHUNK_WATER_LEVEL)
+					block.SetBlockId(Blocks::BLOCK_WATER);
+				continue;
+			}
 
-				if (chunk->m_blockArray[index].GetBlockId() == Blocks::BLOCK_AIR)
-					chunk->m_blockArray[index].SetBlockId(blockId);
+			groundDepth++;
+			if (groundDepth == 0)
+			{
+				topBlock = z >= CHUNK_WATER_LEVEL ? Blocks::BLOCK_GRASS : Blocks::BLOCK_SAND;
+				block.SetBlockId(topBlock);
+			}
+			else
+			{
+				block.SetBlockId(topBlock == Blocks::BLOCK_SAND ? Blocks::BLOCK_SAND : Blocks::BLOCK_DIRT);
 			}
 		}
+	}
+}
 
-	// generate trees
-	static const bool initTree = InitTree(); // thread safe
+void DensityWorldGenerator::QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size)
+{
+	unsigned int seed_Height  = m_seed + 0;
+	unsigned int seed_Density = m_seed + 30;
+
+	// lattice columns around the query, density sampled top down on demand since most columns stop high up
+	constexpr int mask = DENSITY_CELL_XY - 1;
+	IntVec2 latticeMins = IntVec2(worldMins.x & ~mask, worldMins.y & ~mask);
+	int latticeSizeX = (worldMins.x + size.x - 1 - latticeMins.x) / DENSITY_CELL_XY + 2;
+	int latticeSizeY = (worldMins.y + size.y - 1 - latticeMins.y) / DENSITY_CELL_XY + 2;
+
+	IntVec2 heightMapSize = IntVec2((latticeSizeX - 1) * DENSITY_CELL_XY + 1, (latticeSizeY - 1) * DENSITY_CELL_XY + 1);
+	std::vector<float> heightMap(heightMapSize.x * heightMapSize.y);
+	SampleColumnMap(heightMap.data(), latticeMins, heightMapSize, NOISE_FIELD_HEIGHT, seed_Height, HeightFuncDefault);
+
+	std::vector<float> density(latticeSizeX * latticeSizeY * DENSITY_LATTICE_Z);
+	std::vector<bool> sampled(density.size(), false);
+	auto getDensity = [&](int latticeX, int latticeY, int latticeZ)
+	{
+		int index = latticeX + latticeSizeX * (latticeY + latticeSizeY * latticeZ);
+		if (!sampled[index])
+		{
+			WorldCoords coords = WorldCoords(latticeMins.x + latticeX * DENSITY_CELL_XY, latticeMins.y + latticeY * DENSITY_CELL_XY, latticeZ * DENSITY_CELL_Z);
+			float surface = heightMap[latticeX * DENSITY_CELL_XY + latticeY * DENSITY_CELL_XY * heightMapSize.x];
+			density[index] = SampleDensity(coords, surface, seed_Density);
+			sampled[index] = true;
+		}
+		return density[index];
+	};
 
-	for (coords.y = -CHUNK_BIOME_EXTEND_TREE_SIZE; coords.y < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND_TREE_SIZE; coords.y++)
-		for (coords.x = -CHUNK_BIOME_EXTEND_TREE_SIZE; coords.x < (int)CHUNK_SIZE_XY + CHUNK_BIOME_EXTEND_TREE_SIZE; coords.x++)
+	for (int y = 0; y < size.y; y++)
+		for (int x = 0; x < size.x; x++)
 		{
-			int height2 = (int)GetRef(height2Map, coords);
-			if (IsTree(treenessMap, coords) && GetRef(humidityMap, coords) > 0.0f && GetRef(temperatureMap, coords) > 0.0f && height2 <= 64.0f)
+			ColumnInfo& info = columns[x + y * size.x];
+			info = ColumnInfo();
+
+			int offsetX = worldMins.x + x - latticeMins.x;
+			int offsetY = worldMins.y + y - latticeMins.y;
+			int cellX = offsetX / DENSITY_CELL_XY;
+			int cellY = offsetY / DENSITY_CELL_XY;
+			float tx = (float)(offsetX & mask) / (float)DENSITY_CELL_XY;
+			float ty = (float)(offsetY & mask) / (float)DENSITY_CELL_XY;
+
+			// the cells of GenerateTerrain from the top, interpolated in the same order for the same rounding
+			for (int cellZ = DENSITY_LATTICE_Z - 2; cellZ >= 0 && info.m_groundZ < 0; cellZ--)
 			{
-				coords.z = (int)GetRef(height1Map, coords);
-				if (coords.z >= CHUNK_WATER_LEVEL)
+				float d000 = getDensity(cellX,     cellY,     cellZ    );
+				float d100 = getDensity(cellX + 1, cellY,     cellZ    );
+				float d010 = getDensity(cellX,     cellY + 1, cellZ    );
+				float d110 = getDensity(cellX + 1, cellY + 1, cellZ    );
+				float d001 = getDensity(cellX,     cellY,     cellZ + 1);
+				float d101 = getDensity(cellX + 1, cellY,     cellZ + 1);
+				float d011 = getDensity(cellX,     cellY + 1, cellZ + 1);
+				float d111 = getDensity(cellX + 1, cellY + 1, cellZ + 1);
+				float lowest  = Min(Min(Min(d000, d100), Min(d010, d110)), Min(Min(d001, d101), Min(d011, d111)));
+				float highest = Max(Max(Max(d000, d100), Max(d010, d110)), Max(Max(d001, d101), Max(d011, d111)));
+
+				int zMin = cellZ * DENSITY_CELL_Z;
+				int zMax = zMin + DENSITY_CELL_Z - 1;
+				if (lowest > 0.0f)
 				{
-					coords.z++;
-					TEMPLATE_TREE.PlaceOn(chunk, coords);
+					info.m_groundZ = zMax;
+					break;
 				}
+				if (highest <= 0.0f)
+					continue;
+
+				float bottom = Lerp(Lerp(d000, d010, ty), Lerp(d100, d110, ty), tx);
+				float top    = Lerp(Lerp(d001, d011, ty), Lerp(d101, d111, ty), tx);
+				float step = (top - bottom) / (float)DENSITY_CELL_Z;
+				float value = bottom;
+				for (int z = zMin; z <= zMax; z++, value += step)
+					if (value > 0.0f)
+						info.m_groundZ = z;
 			}
-		}
 
-	for (coords.y = 0; coords.y < (int)CHUNK_SIZE_XY; coords.y++)
-		for (coords.x = 0; coords.x < (int)CHUNK_SIZE_XY; coords.x++)
-		{
-			int height2 = (int)GetRef(height2Map, coords);
-			if (IsTree(lampnessMap, coords) && GetRef(humidityMap, coords) < 0.0f && GetRef(oceannessMap, coords) < -0.05f && height2 <= 64.0f)
+			// GenerateSurface: grass or sand on the first ground under the sky, flooded below sea level
+			info.m_surfaceZ = info.m_groundZ;
+			info.m_surfaceBlock = info.m_groundZ >= CHUNK_WATER_LEVEL ? Blocks::BLOCK_GRASS : Blocks::BLOCK_SAND;
+			if (info.m_groundZ < CHUNK_WATER_LEVEL)
 			{
-				coords.z = (int)GetRef(height1Map, coords);
-				if (chunk->GetBlockId(coords) == Blocks::BLOCK_GRASS && coords.z >= CHUNK_WATER_LEVEL)
-				{
-					coords.z++;
-					chunk->m_blockArray[Chunk::GetIndex(coords)].SetBlockId(Blocks::BLOCK_GLOWSTONE);
-				}
+				info.m_surfaceZ = CHUNK_WATER_LEVEL;
+				info.m_surfaceBlock = Blocks::BLOCK_WATER;
 			}
 		}
 }
@@ -1,28 +1,140 @@
+#pragma once
 
-class Chunk;
+#include "Game/NoiseTileCache.hpp"
+#include "Game/Chunk.hpp"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class BlockTemplate;
+class FeatureQueue;
+
+enum NoiseField
+{
+	NOISE_FIELD_HEIGHT,
+	NOISE_FIELD_HEIGHT2,
+	NOISE_FIELD_HUMIDITY,
+	NOISE_FIELD_TEMPERATURE,
+	NOISE_FIELD_HILLINESS,
+	NOISE_FIELD_OCEANNESS,
+	NOISE_FIELD_TREENESS,
+	NOISE_FIELD_COUNT,
+};
+
+constexpr int NOISE_LATTICE_STEP = 4; // coarse sampling spacing in blocks
+constexpr int CHUNK_GEN_EXTEND = 2;   // tree placement compares treeness 5x5 columns around
+constexpr int CHUNK_GEN_EXTENDED_SIZE_XY = CHUNK_SIZE_XY + CHUNK_GEN_EXTEND * 2;
+constexpr int CHUNK_WATER_LEVEL = 64;  // sea level of the overworld and skyblock generators
+
+// counter based rng for generation, every roll is a pure function of (seed, chunk coords, block index, channel),
+// so a chunk generates the same on any thread in any order
+class ChunkRandom
+{
+public:
+	inline ChunkRandom(unsigned int seed, const IntVec2& chunkCoords);
+
+	inline unsigned int RollUint(int blockIndex, unsigned int channel = 0) const;
+	inline float        RollFloatZeroToOne(int blockIndex, unsigned int channel = 0) const;
+
+	static inline unsigned int Hash(unsigned int bits, unsigned int seed);
+
+private:
+	unsigned int m_chunkSeed;
+};
+
+// terrain surface of one world column as GenerateChunk builds it, features (trees, lamps) left out
+struct ColumnInfo
+{
+	int     m_surfaceZ     = -1;    // topmost terrain or water block, -1 for an empty column
+	int     m_groundZ      = -1;    // topmost block that is not water, what a player stands on
+	BlockId m_surfaceBlock = 0;     // block at m_surfaceZ, air for an empty column
+	float   m_height       = 0.0f;  // shaped terrain height before it is cut to whole blocks, left 0 by generators without one
+	float   m_humidity     = 0.0f;  // biome fields, left 0 by generators not using them
+	float   m_temperature  = 0.0f;
+	float   m_hilliness    = 0.0f;
+	float   m_oceanness    = 0.0f;
+};
+
+// per chunk state handed from stage to stage, extended maps cover CHUNK_GEN_EXTEND columns around the chunk
+struct ChunkGenContext
+{
+	ChunkGenContext(Chunk* chunk, unsigned int seed);
+
+	Chunk*      m_chunk;
+	WorldCoords m_origin;
+	ChunkRandom m_random;
+
+	float m_heightMap      [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_height2Map     [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_humidityMap    [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_temperatureMap [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_hillinessMap   [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_oceannessMap   [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_treenessMap    [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+	float m_lampnessMap    [CHUNK_GEN_EXTENDED_SIZE_XY * CHUNK_GEN_EXTENDED_SIZE_XY] = {};
+
+	std::map<ChunkCoords, std::vector<BlockEdit>> m_spilledBlocks; // feature blocks outside of the chunk
+};
 
 class WorldGenerator
 {
 public:
-	WorldGenerator() {};
+	WorldGenerator();
 	virtual ~WorldGenerator() {};
 
-	virtual void GenerateChunk(Chunk* chunk) = 0;
+	// terrain, surface and features. feature blocks reaching out of the chunk are pushed to the queue for the chunk
+	// they fall in, which fills them into air once it is generated or loaded. without a queue they are dropped
+	void GenerateChunk(Chunk* chunk, FeatureQueue* featureQueue = nullptr);
+	virtual const char* GetName() const = 0;
+	virtual unsigned int GetRevision() const = 0; // bump whenever the output for a seed changes
+
+	unsigned int GetVersionHash() const; // name, revision and sampling config, delta saves of another one are rewritten over the new output
+	void SetCoarseSampling(bool enabled); // low frequency fields on the lattice, the rest exact
+	void SetFieldLatticeStep(NoiseField field, int step) { m_fieldLatticeSteps[field] = step; }
+
+	// surface queries without generating chunks, same fields and height shaping as terrain generation.
+	// callable from any thread, noise comes from the tile cache generation jobs share
+	ColumnInfo   QueryColumn(const IntVec2& worldXY);
+	virtual void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) = 0; // size.x columns per row
+	bool         FindDryColumn(const IntVec2& worldXY, int searchRadius, IntVec2& column, ColumnInfo& info); // nearest ground not under water
+
+protected:
+	virtual void GenerateTerrain(ChunkGenContext& context) = 0; // every block of the chunk
+	virtual void GenerateSurface(ChunkGenContext&) {}            // decoration within the chunk
+	virtual void GenerateFeatures(ChunkGenContext&) {}           // structures rooted in this chunk, blocks past its border spill to their chunk
+
+	void SampleExtendedMap(float* extendedMap, const IntVec3& chunkOrigin, NoiseField field, unsigned int seed, NoiseFieldFunc func);
+	void SampleColumnMap(float* columnMap, const IntVec2& worldMins, const IntVec2& size, NoiseField field, unsigned int seed, NoiseFieldFunc func);
+	void PlaceFeature(ChunkGenContext& context, const BlockTemplate& feature, const LocalCoords& coords) const; // coords may reach out of the chunk
 
 public:
 	unsigned int m_seed = 0;
+	NoiseTileCache m_noiseCache; // 2d fields shared between neighboring chunks
+	int m_fieldLatticeSteps[NOISE_FIELD_COUNT] = {};
 };
 
 class PlainWorldGenerator : public WorldGenerator
 {
 public:
-	void GenerateChunk(Chunk* chunk) override;
+	const char* GetName() const override { return "Plain"; }
+	unsigned int GetRevision() const override { return 2; }
+	void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) override;
+
+protected:
+	void GenerateTerrain(ChunkGenContext& context) override;
 };
 
 class PerlinWorldGenerator : public WorldGenerator
 {
 public:
-	void GenerateChunk(Chunk* chunk) override;
+	const char* GetName() const override { return "Perlin"; }
+	unsigned int GetRevision() const override { return 1; }
+	void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) override;
+
+protected:
+	void GenerateTerrain(ChunkGenContext& context) override;
 };
 
 class OverworldWorldGenerator : public WorldGenerator
@@ -30,8 +142,14 @@ class OverworldWorldGenerator : public WorldGenerator
 public:
 	OverworldWorldGenerator();
 
-	void GenerateChunk(Chunk* chunk) override;
+	const char* GetName() const override { return "Overworld"; }
+	unsigned int GetRevision() const override { return 2; }
+	void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) override;
 
+protected:
+	void GenerateTerrain(ChunkGenContext& context) override;
+	void GenerateSurface(ChunkGenContext& context) override;
+	void GenerateFeatures(ChunkGenContext& context) override;
 };
 
 class SkyBlockWorldGenerator : public WorldGenerator
@@ -39,15 +157,41 @@ class SkyBlockWorldGenerator : public WorldGenerator
 public:
 	SkyBlockWorldGenerator();
 
-	void GenerateChunk(Chunk* chunk) override;
+	const char* GetName() const override { return "SkyBlock"; }
+	unsigned int GetRevision() const override { return 2; }
+	void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) override;
+
+protected:
+	void GenerateTerrain(ChunkGenContext& context) override;
+	void GenerateSurface(ChunkGenContext& context) override;
+	void GenerateFeatures(ChunkGenContext& context) override;
+};
+
+// 3d density terrain with overhangs and caves. density is sampled on a 4x8x4 block lattice and interpolated
+// trilinearly, a cell whose corners agree in sign is filled whole since the interpolation stays between them
+class DensityWorldGenerator : public WorldGenerator
+{
+public:
+	const char* GetName() const override { return "Density"; }
+	unsigned int GetRevision() const override { return 1; }
+	void QueryColumns(ColumnInfo* columns, const IntVec2& worldMins, const IntVec2& size) override;
+
+	size_t GetSkippedCellCount() const { return m_skippedCells; }
+	size_t GetInterpolatedCellCount() const { return m_interpolatedCells; }
+	void   ResetStats() { m_skippedCells = 0; m_interpolatedCells = 0; }
 
+protected:
+	void GenerateTerrain(ChunkGenContext& context) override;
+	void GenerateSurface(ChunkGenContext& context) override;
+
+private:
+	std::atomic<size_t> m_skippedCells = 0;
+	std::atomic<size_t> m_interpolatedCells = 0;
 };
 
 
 #include "Engine/Math/IntVec3.hpp"
 #include "Game/BlockDef.hpp"
-#include "Game/Chunk.hpp"
-#include <vector>
 
 class BlockTemplate
 {
@@ -69,3 +213,29 @@ public:
 	std::vector<Entry> m_blocks;
 };
 
+
+ChunkRandom::ChunkRandom(unsigned int seed, const IntVec2& chunkCoords)
+	: m_chunkSeed(Hash((unsigned int)chunkCoords.y, Hash((unsigned int)chunkCoords.x, seed)))
+{
+}
+
+unsigned int ChunkRandom::RollUint(int blockIndex, unsigned int channel) const
+{
+	return Hash((unsigned int)blockIndex, m_chunkSeed + channel * 0x9E3779B9);
+}
+
+float ChunkRandom::RollFloatZeroToOne(int blockIndex, unsigned int channel) const
+{
+	return float(RollUint(blockIndex, channel) >> 8) * (1.0f / 16777216.0f); // 24 bits, never reaches 1
+}
+
+unsigned int ChunkRandom::Hash(unsigned int bits, unsigned int seed)
+{
+	bits = bits * 0x9E3779B1 + seed;
+	bits ^= bits >> 16;
+	bits *= 0x7FEB352D;
+	bits ^= bits >> 15;
+	bits *= 0x846CA68B;
+	bits ^= bits >> 16;
+	return bits;
+}
@@ -0,0 +1,156 @@
+#include "Game/WorldPregenerator.hpp"
+
+#include "Game/ChunkProvider.hpp"
+#include "Game/World.hpp"
+#include "Game/WorldGenerator.hpp"
+
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+WorldPregenerator::WorldPregenerator(const PregenerationSettings& settings, WorldGenerator* generator)
+	: m_settings(settings)
+{
+	m_settings.m_batchSize = m_settings.m_batchSize < 1 ? 1 : m_settings.m_batchSize;
+
+	m_world = new World();
+	m_world->InitializeHeadless(m_settings.m_folderPath.c_str(), generator);
+
+	// chunks still matching the generator are not written by delta saves, here the point is to skip generation on load
+	ChunkProvider* provider = m_world->GetChunkManager();
+	provider->SetDeltaSaveEnabled(false);
+	provider->SetHotspotSize(1);
+
+	for (int y = m_settings.m_mins.y; y <= m_settings.m_maxs.y; y++)
+		for (int x = m_settings.m_mins.x; x <= m_settings.m_maxs.x; x++)
+			if (IsInRegion(ChunkCoords(x, y)))
+				m_regionChunks++;
+}
+
+WorldPregenerator::~WorldPregenerator()
+{
+	m_world->ShutdownHeadless();
+	delete m_world;
+}
+
+void WorldPregenerator::Run()
+{
+	m_startTime = GetCurrentTimeSeconds();
+	m_lastReportTime = m_startTime;
+
+	int batchSize = m_settings.m_batchSize;
+	for (int y = m_settings.m_mins.y; y <= m_settings.m_maxs.y; y += batchSize)
+		for (int x = m_settings.m_mins.x; x <= m_settings.m_maxs.x; x += batchSize)
+		{
+			ChunkCoords batchMaxs(Min(x + batchSize - 1, m_settings.m_maxs.x), Min(y + batchSize - 1, m_settings.m_maxs.y));
+			RunBatch(ChunkCoords(x, y), batchMaxs);
+			ReportProgress(false);
+		}
+
+	ApplyLeftoverFeatures();
+	m_elapsedSeconds = GetCurrentTimeSeconds() - m_startTime;
+	ReportProgress(true);
+}
+
+bool WorldPregenerator::IsInRegion(const ChunkCoords& coords) const
+{
+	if (coords.x < m_settings.m_mins.x || coords.x > m_settings.m_maxs.x || coords.y < m_settings.m_mins.y || coords.y > m_settings.m_maxs.y)
+		return false;
+	if (m_settings.m_radius < 0)
+		return true;
+
+	// center of the box, doubled to stay on integers
+	int offsetX = coords.x * 2 - (m_settings.m_mins.x + m_settings.m_maxs.x);
+	int offsetY = coords.y * 2 - (m_settings.m_mins.y + m_settings.m_maxs.y);
+	return offsetX * offsetX + offsetY * offsetY <= 4 * m_settings.m_radius * m_settings.m_radius;
+}
+
+int WorldPregenerator::GetRegionChunkCount() const
+{
+	return m_regionChunks;
+}
+
+double WorldPregenerator::GetChunksPerSecond() const
+{
+	return m_elapsedSeconds > 0.0 ? (double)m_generatedChunks / m_elapsedSeconds : 0.0;
+}
+
+// RunBatch: Generate every missing chunk of the batch on the job workers, settle light, then save and drop them all
+void WorldPregenerator::RunBatch(const ChunkCoords& mins, const ChunkCoords& maxs)
+{
+	ChunkProvider* provider = m_world->GetChunkManager();
+
+	int queued = 0;
+	for (int y = mins.y; y <= maxs.y; y++)
+		for (int x = mins.x; x <= maxs.x; x++)
+		{
+			ChunkCoords coords(x, y);
+			if (!IsInRegion(coords))
+				continue;
+			if (provider->HasChunkFile(coords))
+			{
+				m_skippedChunks++;
+				continue;
+			}
+			provider->LoadChunk(coords);
+			queued++;
+		}
+	if (queued == 0)
+		return;
+
+	provider->FinishUpChunkGeneration();
+	provider->ProcessAllDirtyLighting(true);
+	provider->UnloadAllChunks();
+	m_generatedChunks += queued;
+}
+
+// ApplyLeftoverFeatures: Trees of later batches reach into chunks already saved, reopen those and save them again
+void WorldPregenerator::ApplyLeftoverFeatures()
+{
+	ChunkProvider* provider = m_world->GetChunkManager();
+
+	std::vector<ChunkCoords> targets;
+	provider->GetFeatureQueue().GetPendingTargets(targets);
+
+	size_t batchChunks = (size_t)(m_settings.m_batchSize * m_settings.m_batchSize);
+	size_t loaded = 0;
+	for (const ChunkCoords& coords : targets)
+	{
+		if (!IsInRegion(coords) || !provider->HasChunkFile(coords))
+			continue; // outside of the region, kept in the queue file until the chunk loads
+
+		provider->LoadChunk(coords); // queued blocks land as the chunk loads
+		m_patchedChunks++;
+		if (++loaded == batchChunks)
+		{
+			provider->FinishUpChunkGeneration();
+			provider->ProcessAllDirtyLighting(true);
+			provider->UnloadAllChunks();
+			loaded = 0;
+		}
+	}
+
+	provider->FinishUpChunkGeneration();
+	provider->ProcessAllDirtyLighting(true);
+	provider->UnloadAllChunks();
+}
+
+void WorldPregenerator::ReportProgress(bool force)
+{
+	double now = GetCurrentTimeSeconds();
+	if (!force && now - m_lastReportTime < m_settings.m_reportInterval)
+		return;
+	m_lastReportTime = now;
+	m_elapsedSeconds = now - m_startTime;
+
+	int done = m_skippedChunks + m_generatedChunks;
+	double rate = GetChunksPerSecond();
+	double secondsLeft = rate > 0.0 ? (double)(m_regionChunks - done) / rate : 0.0;
+	std::string line = Stringf("Pregeneration: %d/%d chunks (%.1f%%), %d generated, %d already on disk, %.1f chunks/s, %.0fs left",
+		done, m_regionChunks, m_regionChunks > 0 ? 100.0 * done / m_regionChunks : 100.0, m_generatedChunks, m_skippedChunks, rate, secondsLeft);
+
+	g_theConsole->AddLine(DevConsole::LOG_INFO, line);
+	DebuggerPrintf("%s\n", line.c_str()); // the console is not drawn until the run returns
+}
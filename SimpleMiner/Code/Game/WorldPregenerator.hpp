@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Game/Chunk.hpp"
+#include "Engine/Math/IntVec2.hpp"
+
+#include <string>
+
+class World;
+class WorldGenerator;
+
+struct PregenerationSettings
+{
+	std::string m_folderPath;
+	ChunkCoords m_mins;                     // chunk coords, inclusive
+	ChunkCoords m_maxs;
+	int         m_radius = -1;              // when set, only chunks this far from the center of the box
+	int         m_batchSize = 16;           // chunks per side of a batch held in memory at once
+	double      m_reportInterval = 1.0;     // seconds between progress lines
+};
+
+// generates a region of a world ahead of play on every job worker and saves it in full.
+// chunks already on disk are skipped, so an interrupted run picks up where it stopped
+class WorldPregenerator
+{
+public:
+	WorldPregenerator(const PregenerationSettings& settings, WorldGenerator* generator); // takes the generator
+	~WorldPregenerator();
+
+	void Run();
+
+	bool   IsInRegion(const ChunkCoords& coords) const;
+	int    GetRegionChunkCount() const;
+	int    GetSkippedChunkCount() const   { return m_skippedChunks; }
+	int    GetGeneratedChunkCount() const { return m_generatedChunks; }
+	int    GetPatchedChunkCount() const   { return m_patchedChunks; }
+	double GetElapsedSeconds() const      { return m_elapsedSeconds; }
+	double GetChunksPerSecond() const;
+
+private:
+	void RunBatch(const ChunkCoords& mins, const ChunkCoords& maxs);
+	void ApplyLeftoverFeatures();
+	void ReportProgress(bool force);
+
+private:
+	PregenerationSettings m_settings;
+	World* m_world = nullptr;
+	int    m_regionChunks = 0;
+	int    m_skippedChunks = 0;
+	int    m_generatedChunks = 0;
+	int    m_patchedChunks = 0;    // chunks on disk reopened for feature blocks of later batches
+	double m_startTime = 0.0;
+	double m_elapsedSeconds = 0.0;
+	double m_lastReportTime = 0.0;
+};